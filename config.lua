@@ -4,3 +4,9 @@ height = 720
 
 -- define framerate
 framerate = 60
+
+-- define audio buffer size in samples, a power of two from 64 to 4096
+audio_buffer_size = 256
+
+-- grow the audio buffer from audio_buffer_size while the audio glitches
+audio_adaptive = true
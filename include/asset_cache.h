@@ -0,0 +1,66 @@
+#ifndef SDL_BITS_INCLUDE_ASSET_CACHE_H
+#define SDL_BITS_INCLUDE_ASSET_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bmp.h"
+
+/// A cache entry mapped into memory.
+///
+/// The pixels point into the mapping and are valid until asset_cache_close()
+/// is called.
+typedef struct asset_cache_entry
+{
+    void *base;                // Start of the mapping
+    size_t size;               // Size of the mapping in bytes
+    bmp_pixel32 const *pixels; // Top-down BGRA pixels, ready for SDL_PIXELFORMAT_BGRA32
+    size_t width;              // Image width in pixels
+    size_t height;             // Image height in pixels
+} asset_cache_entry;
+
+/// Creates the cache directory if it does not exist.
+///
+/// @param dir Path to the cache directory.
+/// @return 0 on success, -1 on error.
+int asset_cache_init(char const *dir);
+
+/// Gets the path of the cache entry for a source file.
+///
+/// Entries are named after a hash of the source path; the header records the
+/// size and modification time of the source so that stale entries can be
+/// detected.
+///
+/// @param dir Path to the cache directory.
+/// @param source Path to the source file.
+/// @return The path, to be freed by the caller, or NULL on error.
+char *asset_cache_path(char const *dir, char const *source);
+
+/// Maps the cache entry for a source file.
+///
+/// @param dir Path to the cache directory.
+/// @param source Path to the source file.
+/// @param entry The entry to be filled.
+/// @return 0 on success, 1 if there is no entry or it is stale or corrupt, or -1 on error.
+/// @see asset_cache_close()
+int asset_cache_open(char const *dir, char const *source, asset_cache_entry *entry);
+
+/// Unmaps a cache entry mapped with asset_cache_open().
+///
+/// @param entry The entry to release.
+void asset_cache_close(asset_cache_entry *entry);
+
+/// Stores decoded pixels as the cache entry for a source file.
+///
+/// The entry is written to a temporary file and renamed into place, so that
+/// concurrent readers and writers never see a partial entry.
+///
+/// @param dir Path to the cache directory.
+/// @param source Path to the source file the pixels were decoded from.
+/// @param pixels Top-down BGRA pixels.
+/// @param width Image width in pixels.
+/// @param height Image height in pixels.
+/// @return 0 on success, -1 on error.
+int asset_cache_store(char const *dir, char const *source, bmp_pixel32 const *pixels, size_t width, size_t height);
+
+#endif // SDL_BITS_INCLUDE_ASSET_CACHE_H
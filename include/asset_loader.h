@@ -0,0 +1,82 @@
+#ifndef SDL_BITS_INCLUDE_ASSET_LOADER_H
+#define SDL_BITS_INCLUDE_ASSET_LOADER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "asset_cache.h"
+#include "bmp.h"
+
+/// A decoded asset.
+struct asset
+{
+    intptr_t id;               ///< Identifier passed to asset_loader_submit()
+    int status;                ///< 0 on success, -1 if the file could not be loaded
+    size_t width;              ///< Image width in pixels
+    size_t height;             ///< Image height in pixels
+    bmp_pixel32 const *pixels; ///< Top-down BGRA pixels, valid until asset_release()
+    bmp_pixel32 *decoded;      ///< Pixels decoded by bmp_load(), or NULL if they came from the cache
+    asset_cache_entry cached;  ///< Cache entry the pixels are mapped from, if any
+};
+
+/// Decodes assets on a pool of worker threads.
+///
+/// Decoding happens on the workers; the decoded pixels are handed back to the
+/// thread calling asset_loader_get(), which should be the render thread so
+/// that it can upload them to textures.
+struct asset_loader;
+
+/// Creates an asset loader and starts its workers.
+///
+/// With a cache directory, workers map up-to-date cache entries instead of
+/// decoding, and store what they decode for the next run.
+///
+/// @param threads Number of worker threads, at least 1.
+/// @param capacity Maximum number of assets submitted but not yet collected.
+/// @param cache_dir Path to an existing cache directory, which is copied, or NULL to disable the cache.
+/// @return The loader, or NULL on failure.
+/// @see asset_cache_init()
+struct asset_loader *asset_loader_create(uint32_t threads, uint32_t capacity, char const *cache_dir);
+
+/// Stops the workers and destroys the loader.
+///
+/// Assets that have not been decoded yet are skipped, and decoded assets that
+/// have not been collected are freed.
+///
+/// @param loader The loader.
+void asset_loader_destroy(struct asset_loader *loader);
+
+/// Queues a BMP file for decoding.
+///
+/// @param loader The loader.
+/// @param path Path to the BMP file, which is copied.
+/// @param id Identifier returned with the decoded asset.
+/// @return 0 on success, 1 if capacity assets are outstanding, or a negative value on error.
+int asset_loader_submit(struct asset_loader *loader, char const *path, intptr_t id);
+
+/// Returns the next decoded asset, blocking until one is ready.
+///
+/// @param loader The loader.
+/// @param out The decoded asset.
+/// @return 0 on success, 1 if no assets are outstanding, or a negative value on error.
+int asset_loader_get(struct asset_loader *loader, struct asset *out);
+
+/// Returns the next decoded asset without blocking.
+///
+/// @param loader The loader.
+/// @param out The decoded asset.
+/// @return 0 on success, 1 if no asset is ready, or a negative value on error.
+int asset_loader_try_get(struct asset_loader *loader, struct asset *out);
+
+/// Releases the pixels of a collected asset.
+///
+/// @param asset The asset.
+void asset_release(struct asset *asset);
+
+/// Returns the number of assets submitted but not yet collected.
+///
+/// @param loader The loader.
+/// @return The number of outstanding assets.
+uint32_t asset_loader_pending(struct asset_loader *loader);
+
+#endif // SDL_BITS_INCLUDE_ASSET_LOADER_H
@@ -0,0 +1,91 @@
+#ifndef SDL_BITS_INCLUDE_ATLAS_H
+#define SDL_BITS_INCLUDE_ATLAS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// A rectangle to be packed into an atlas.
+typedef struct atlas_rect
+{
+    uint32_t width;  // Width (pixels), set by the caller
+    uint32_t height; // Height (pixels), set by the caller
+    uint32_t x;      // Left edge in the atlas (pixels), set by atlas_pack()
+    uint32_t y;      // Top edge in the atlas (pixels), set by atlas_pack()
+} atlas_rect;
+
+/// Placement and metrics of a glyph in an atlas.
+///
+/// The UV rectangle of the glyph is x, y, width and height divided by the
+/// size of the atlas.
+typedef struct atlas_glyph
+{
+    uint32_t code;     // Codepoint
+    uint16_t x;        // Left edge in the atlas (pixels)
+    uint16_t y;        // Top edge in the atlas (pixels)
+    uint16_t width;    // Width (pixels)
+    uint16_t height;   // Height (pixels)
+    int16_t bearing_x; // Offset from the pen position to the left edge (pixels)
+    int16_t bearing_y; // Offset from the baseline up to the top edge (pixels)
+    int16_t advance;   // Horizontal advance of the pen position (pixels)
+    uint16_t reserved; // Zero
+} atlas_glyph;
+
+/// The glyph metrics table of an atlas.
+typedef struct atlas_metrics
+{
+    uint32_t width;      // Atlas width (pixels)
+    uint32_t height;     // Atlas height (pixels)
+    int32_t line_height; // Distance between baselines (pixels)
+    int32_t ascent;      // Distance from the top of a line to its baseline (pixels)
+    uint32_t sdf_spread; // Distance at which the alpha of a distance field atlas saturates (pixels), 0 for coverage
+    size_t count;        // Number of glyphs
+    atlas_glyph *glyphs; // Glyphs, sorted by codepoint
+} atlas_metrics;
+
+/// Packs rectangles into a near-square power-of-two atlas.
+///
+/// Uses a bottom-left skyline packer over the rectangles sorted by height.
+/// Sizes are tried in increasing order, growing the smaller side first, until
+/// every rectangle fits.  Empty rectangles are placed at the origin.
+///
+/// @param rects The rectangles, whose positions are filled in.
+/// @param n Number of rectangles.
+/// @param padding Empty pixels kept between neighboring rectangles.
+/// @param max_size Maximum width and height of the atlas (pixels).
+/// @param width The atlas width.
+/// @param height The atlas height.
+/// @return 0 on success, -1 if the rectangles do not fit or on error.
+int atlas_pack(atlas_rect *rects, size_t n, uint32_t padding, uint32_t max_size, uint32_t *width, uint32_t *height);
+
+/// Sorts the glyphs of a metrics table by codepoint.
+///
+/// @param metrics The metrics table.
+void atlas_metrics_sort(atlas_metrics *metrics);
+
+/// Finds the glyph for a codepoint.
+///
+/// @param metrics The metrics table.
+/// @param code The codepoint.
+/// @return The glyph, or NULL if the atlas does not contain it.
+atlas_glyph const *atlas_metrics_find(atlas_metrics const *metrics, uint32_t code);
+
+/// Writes a metrics table to a file.
+///
+/// @param metrics The metrics table, sorted by codepoint.
+/// @param file Path to the file.
+/// @return 0 on success, -1 on error.
+int atlas_metrics_write(atlas_metrics const *metrics, char const *file);
+
+/// Reads a metrics table written by atlas_metrics_write().
+///
+/// @param file Path to the file.
+/// @param metrics The metrics table, to be freed with atlas_metrics_free().
+/// @return 0 on success, -1 on error.
+int atlas_metrics_read(char const *file, atlas_metrics *metrics);
+
+/// Frees the glyphs of a metrics table.
+///
+/// @param metrics The metrics table.
+void atlas_metrics_free(atlas_metrics *metrics);
+
+#endif // SDL_BITS_INCLUDE_ATLAS_H
@@ -0,0 +1,61 @@
+#ifndef SDL_BITS_INCLUDE_AUDIO_LATENCY_H
+#define SDL_BITS_INCLUDE_AUDIO_LATENCY_H
+
+#include <stdint.h>
+
+#include "audio_timing.h"
+
+/// What the caller should do after audio_latency_update().
+enum audio_latency_event
+{
+    AUDIO_LATENCY_STEADY = 0,  ///< Nothing
+    AUDIO_LATENCY_SETTLED = 1, ///< The buffer size has played cleanly for a while; log it
+    AUDIO_LATENCY_RESIZE = 2,  ///< Reopen the device with the new buffer size
+};
+
+/// Picks the smallest audio buffer that plays without glitches.
+///
+/// The caller feeds it the timing of the device every frame.  Once per
+/// second of audio it checks the callbacks played since the last check.  Any
+/// overrun or gap, or more than 1% of callbacks using over 80% of their
+/// deadline, doubles the buffer.  After a long clean run it halves the buffer
+/// again, waiting twice as long after each failure, so a device that cannot
+/// keep up stops being retried.
+///
+/// The fields are private to the audio_latency functions.
+struct audio_latency
+{
+    uint32_t frames;     // Current buffer size
+    uint32_t min_frames; // Smallest buffer size
+    uint32_t max_frames; // Largest buffer size
+    uint32_t failures;   // Times the buffer had to grow
+    uint32_t clean;      // Clean windows since the last resize
+    int warm;            // Non-zero once the first window after a resize has passed
+    uint32_t callbacks;  // Counters at the end of the last window
+    uint32_t trouble;
+    uint32_t busy;
+};
+
+/// Starts adapting from the smallest buffer size.
+///
+/// @param latency The latency to initialize.
+/// @param min_frames Smallest buffer size, and the first one used.
+/// @param max_frames Largest buffer size.
+void audio_latency_init(struct audio_latency *latency, uint32_t min_frames, uint32_t max_frames);
+
+/// Checks the timing of the device opened with audio_latency_frames().
+///
+/// The timing must be created anew each time the device is reopened.
+///
+/// @param latency The latency.
+/// @param stats The timing of the device since it was opened.
+/// @return What to do.  On AUDIO_LATENCY_RESIZE, audio_latency_frames() returns the new buffer size.
+enum audio_latency_event audio_latency_update(struct audio_latency *latency, struct audio_timing_stats const *stats);
+
+/// Returns the buffer size to open the device with.
+///
+/// @param latency The latency.
+/// @return Frames per buffer.
+uint32_t audio_latency_frames(struct audio_latency const *latency);
+
+#endif // SDL_BITS_INCLUDE_AUDIO_LATENCY_H
@@ -0,0 +1,75 @@
+#ifndef SDL_BITS_INCLUDE_AUDIO_TIMING_H
+#define SDL_BITS_INCLUDE_AUDIO_TIMING_H
+
+#include <stdint.h>
+
+enum
+{
+    AUDIO_TIMING_BUCKETS = 20, ///< Buckets in each histogram
+};
+
+/// Timing of the audio callback, recorded on the audio thread.
+///
+/// Each callback records how long it ran, the time since the previous
+/// callback started, and how much of its deadline it used, where the deadline
+/// is the time the buffer it fills takes to play.  Recording only increments
+/// atomic counters, so it never blocks, and any thread may read the counters
+/// while the callback runs.
+///
+/// audio_timing_record() must only be called from one thread at a time.
+struct audio_timing;
+
+/// A histogram of callback durations or intervals.
+///
+/// Bucket 0 counts times below 2 us, bucket i counts times from 2^i us up to
+/// 2^(i + 1) us, and the last bucket counts every longer time.
+struct audio_timing_histogram
+{
+    uint32_t counts[AUDIO_TIMING_BUCKETS];
+};
+
+/// A copy of the counters of an audio_timing.
+struct audio_timing_stats
+{
+    double deadline_us;                     ///< Time one buffer takes to play
+    uint32_t callbacks;                     ///< Callbacks recorded
+    uint32_t overruns;                      ///< Callbacks that ran longer than the deadline
+    uint32_t gaps;                          ///< Intervals over 1.5 deadlines, when the device may have run dry
+    uint32_t max_duration_us;               ///< Longest callback
+    uint32_t max_interval_us;               ///< Longest interval between callbacks
+    struct audio_timing_histogram duration; ///< Callback run times
+    struct audio_timing_histogram interval; ///< Times between the starts of callbacks
+    uint32_t load[AUDIO_TIMING_BUCKETS];    ///< Deadline used, 10% per bucket, the last one open-ended
+};
+
+/// Creates the timing of a callback filling buffers of a fixed size.
+///
+/// @param sample_rate Sample rate of the device (Hz).
+/// @param frames Frames per buffer.
+/// @param counter_frequency Ticks per second of the counter passed to audio_timing_record().
+/// @return The timing, or NULL on failure.
+/// @see audio_timing_destroy()
+struct audio_timing *audio_timing_create(int sample_rate, uint32_t frames, uint64_t counter_frequency);
+
+/// Frees an audio_timing.
+///
+/// @param timing The timing.
+void audio_timing_destroy(struct audio_timing *timing);
+
+/// Records one callback.  Called at the end of the callback.
+///
+/// @param timing The timing.
+/// @param begin Counter value when the callback started.
+/// @param end Counter value when the callback finished.
+void audio_timing_record(struct audio_timing *timing, uint64_t begin, uint64_t end);
+
+/// Copies the counters.
+///
+/// May be called from any thread.  Counters recorded during the copy may be
+/// missing from some fields.
+///
+/// @param timing The timing.
+/// @param stats Set to the counters.
+void audio_timing_read(struct audio_timing const *timing, struct audio_timing_stats *stats);
+
+#endif // SDL_BITS_INCLUDE_AUDIO_TIMING_H
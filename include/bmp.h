@@ -15,6 +15,15 @@ typedef enum bmp_header_size
     BITMAPV5HEADER = 124,
 } bmp_header_size;
 
+typedef enum bmp_compression
+{
+    BI_RGB = 0,
+    BI_RLE8 = 1,
+    BI_RLE4 = 2,
+    BI_BITFIELDS = 3,
+    BI_ALPHABITFIELDS = 6,
+} bmp_compression;
+
 typedef struct bmp_file_header
 {
     uint16_t file_type;
@@ -91,12 +100,60 @@ typedef struct bmp_pixel32
     uint8_t a;
 } __attribute__((packed)) bmp_pixel32;
 
+/// A BMP file mapped into memory.
+///
+/// The header and pixel pointers point into the mapping and are valid until
+/// bmp_unmap() is called.
+typedef struct bmp_mapping
+{
+    void *base;                          // Start of the mapping
+    size_t size;                         // Size of the mapping in bytes
+    bmp_file_header const *file_header;  // File header
+    bmp_info_header const *info_header;  // Leading BITMAPINFOHEADER fields of the DIB header
+    bmp_v4_header const *v4_header;      // V4 fields of the DIB header, or NULL if the header is smaller
+    void const *pixels;                  // Pixel data, bottom-up unless info_header->height is negative
+    size_t pixels_size;                  // Size of the pixel data in bytes
+} bmp_mapping;
+
+/// The layout of a BMP file, normalized across header versions.
+typedef struct bmp_layout
+{
+    uint32_t header_size;      // DIB header size (bytes)
+    size_t width;              // Image width (pixels)
+    size_t height;             // Image height (pixels)
+    int top_down;              // Non-zero if the first row in the file is the top row
+    uint16_t bits_per_pixel;   // Bits per pixel
+    uint32_t compression;      // Compression mode
+    uint32_t masks[4];         // Red, green, blue and alpha masks
+    size_t palette_offset;     // Offset of the color table from the start of the file
+    size_t palette_entry_size; // Size of a color table entry (bytes)
+    uint32_t palette_size;     // Number of color table entries
+    size_t offset;             // Offset of the pixel data from the start of the file
+    size_t row_size;           // Size of a row including padding (bytes)
+    size_t pixels_size;        // Size of the pixel data (bytes)
+    size_t decoded_size;       // Size of the image decoded to bmp_pixel32 (bytes)
+} bmp_layout;
+
+/// Calculates the number of bytes per row of a compile-time bit depth and width.
+#define BMP_ROW_SIZE(bits_per_pixel, width) (((((size_t)(width) * (bits_per_pixel)) + 31) / 32) * 4)
+
 /// Calculates the number of bytes per row.
 ///
 /// @param bits_per_pixel Bits per pixel.
 /// @param width Image width.
-/// @return Number of bytes per row.
-size_t bmp_row_size(double bits_per_pixel, double width);
+/// @return Number of bytes per row, or 0 if bits_per_pixel is 0 or the size overflows.
+size_t bmp_row_size(uint16_t bits_per_pixel, size_t width);
+
+/// Validates the headers of a BMP file held in memory and computes its layout.
+///
+/// Every size and offset is checked for overflow and against the size of the
+/// file, so the layout can be trusted before allocating or decoding.
+///
+/// @param data The start of the file.
+/// @param size The size of the file in bytes.
+/// @param layout The layout to be filled.
+/// @return 0 on success, -1 if the file is malformed or unsupported.
+int bmp_get_layout(void const *data, size_t size, bmp_layout *layout);
 
 /// Reads a BMP file.
 ///
@@ -116,6 +173,36 @@ int bmp_read(char const *file, bmp_file_header *file_header, bmp_info_header *in
 /// @return 0 on success, -1 on error.
 int bmp_v4_read(char const *file, bmp_file_header *file_header, bmp_v4_header *v4_header, char **image);
 
+/// Maps a BMP file into memory and validates its headers in place.
+///
+/// The pixel data is not copied.
+///
+/// @param file Path to the BMP file.
+/// @param mapping The mapping to be filled.
+/// @return 0 on success, -1 on error.
+/// @see bmp_unmap()
+int bmp_map(char const *file, bmp_mapping *mapping);
+
+/// Unmaps a BMP file mapped with bmp_map().
+///
+/// @param mapping The mapping to release.
+void bmp_unmap(bmp_mapping *mapping);
+
+/// Loads a BMP file of any supported header version and bit depth.
+///
+/// Supports every header in bmp_header_size, 1, 4 and 8 bits per pixel with a
+/// color table, RLE4 and RLE8 compression, and 16, 24 and 32 bits per pixel
+/// with default or BITFIELDS masks.  The pixels are decoded in a single pass
+/// into a tightly-packed, top-down buffer.  Images without an alpha mask are
+/// opaque.
+///
+/// @param file Path to the BMP file.
+/// @param pixels The decoded pixels, to be freed by the caller.
+/// @param width Image width in pixels.
+/// @param height Image height in pixels.
+/// @return 0 on success, -1 on error.
+int bmp_load(char const *file, bmp_pixel32 **pixels, size_t *width, size_t *height);
+
 /// Writes a BMP file with a V4 header.
 ///
 /// @param buffer The image data.
@@ -124,4 +211,50 @@ int bmp_v4_read(char const *file, bmp_file_header *file_header, bmp_v4_header *v
 /// @param file Path to the BMP file
 int bmp_v4_write(bmp_pixel32 const *buffer, size_t width, size_t height, char const *file);
 
+/// Writes a BMP file with 8-bit run-length encoding.
+///
+/// Takes the same bottom-up buffer as bmp_v4_write().  Alpha is dropped, as
+/// color tables have no alpha channel.  Flat images such as glyph atlases
+/// compress to a fraction of their 32-bit size.
+///
+/// @param buffer The image data.
+/// @param width Image width in pixels.
+/// @param height Image height in pixels.
+/// @param file Path to the BMP file
+/// @return 0 on success, -1 on error or if the image has more than 256 colors.
+int bmp_rle8_write(bmp_pixel32 const *buffer, size_t width, size_t height, char const *file);
+
+/// A BMP file being written row by row.
+typedef struct bmp_writer bmp_writer;
+
+/// Opens a BMP file for writing row by row.
+///
+/// The file has a V4 header and is stored top-down, so rows are written in
+/// display order.  Rows are padded with bmp_row_size() and staged in a large
+/// aligned buffer, so memory use does not depend on the image height.  Files
+/// too large for the 32-bit size fields have those fields set to zero.
+///
+/// @param file Path to the BMP file.
+/// @param width Image width in pixels.
+/// @param height Image height in pixels.
+/// @param bits_per_pixel 24 to drop alpha, or 32.
+/// @return The writer, or NULL on error.
+/// @see bmp_writer_write_rows()
+/// @see bmp_writer_close()
+bmp_writer *bmp_writer_open(char const *file, size_t width, size_t height, uint16_t bits_per_pixel);
+
+/// Writes the next rows of an image.
+///
+/// @param writer The writer.
+/// @param rows n tightly-packed rows of width pixels, top row first.
+/// @param n Number of rows.
+/// @return 0 on success, -1 on error or if more rows than the height are written.
+int bmp_writer_write_rows(bmp_writer *writer, bmp_pixel32 const *rows, size_t n);
+
+/// Flushes and closes a BMP file and frees the writer.
+///
+/// @param writer The writer.
+/// @return 0 on success, -1 on error or if fewer rows than the height were written.
+int bmp_writer_close(bmp_writer *writer);
+
 #endif // SDL_BITS_INCLUDE_BMP_H
@@ -0,0 +1,108 @@
+#ifndef SDL_BITS_INCLUDE_BMP_CONVERT_H
+#define SDL_BITS_INCLUDE_BMP_CONVERT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bmp.h"
+#include "cpu_isa.h"
+
+/// Pixel conversion kernels for one instruction set.
+///
+/// Every kernel produces bit-identical output on every instruction set.
+typedef struct bmp_convert_kernels
+{
+    /// Expands n BGR24 pixels to opaque BGRA32 pixels.
+    void (*bgr24_to_bgra32)(bmp_pixel32 *dst, bmp_pixel24 const *src, size_t n);
+    /// Swaps the red and blue channels of n pixels, converting BGRA to RGBA or back.
+    void (*swap_red_blue)(bmp_pixel32 *dst, bmp_pixel32 const *src, size_t n);
+    /// Extracts n 32-bit pixels with red, green, blue and alpha masks to BGRA32.
+    void (*extract_masked)(bmp_pixel32 *dst, void const *src, size_t n, uint32_t const masks[static 4]);
+    /// Multiplies the color channels of n pixels by their alpha.
+    void (*premultiply_alpha)(bmp_pixel32 *dst, bmp_pixel32 const *src, size_t n);
+    /// Exchanges the contents of two non-overlapping buffers of size bytes.
+    void (*swap_rows)(void *a, void *b, size_t size);
+} bmp_convert_kernels;
+
+/// Gets the kernels for an instruction set.
+///
+/// @param isa The instruction set.
+/// @return The kernels, or NULL if the build or the CPU does not support isa.
+bmp_convert_kernels const *bmp_convert_get_kernels(cpu_isa isa);
+
+/// Gets the kernels for the best instruction set supported by the CPU.
+///
+/// The CPU is only checked on the first call, so the bmp_convert_*
+/// functions below can be called once per row.
+///
+/// @return The kernels.
+bmp_convert_kernels const *bmp_convert_best_kernels(void);
+
+/// Expands BGR24 pixels to opaque BGRA32 pixels.
+///
+/// @param dst The destination pixels.
+/// @param src The source pixels.
+/// @param n Number of pixels.
+void bmp_convert_bgr24_to_bgra32(bmp_pixel32 *dst, bmp_pixel24 const *src, size_t n);
+
+/// Swaps the red and blue channels, converting BGRA to RGBA or back.
+///
+/// dst and src may be the same buffer.
+///
+/// @param dst The destination pixels.
+/// @param src The source pixels.
+/// @param n Number of pixels.
+void bmp_convert_swap_red_blue(bmp_pixel32 *dst, bmp_pixel32 const *src, size_t n);
+
+/// Extracts 32-bit pixels with arbitrary contiguous channel masks to BGRA32.
+///
+/// Channels narrower than 8 bits are scaled up by bit replication, wider
+/// channels keep their most significant bits.  Pixels are opaque if the alpha
+/// mask is empty.
+///
+/// @param dst The destination pixels.
+/// @param src The source pixels, which need not be aligned.
+/// @param n Number of pixels.
+/// @param masks The red, green, blue and alpha masks.
+void bmp_convert_extract_masked(bmp_pixel32 *dst, void const *src, size_t n, uint32_t const masks[static 4]);
+
+/// Multiplies the color channels by alpha, rounding to nearest.
+///
+/// dst and src may be the same buffer.
+///
+/// @param dst The destination pixels.
+/// @param src The source pixels.
+/// @param n Number of pixels.
+void bmp_convert_premultiply_alpha(bmp_pixel32 *dst, bmp_pixel32 const *src, size_t n);
+
+/// Lookup table expanding a byte of 1-bit pixels to eight 32-bit pixels.
+typedef struct bmp_convert_mono_table
+{
+    bmp_pixel32 pixels[256][8]; // Pixels of each byte, most significant bit first
+} bmp_convert_mono_table;
+
+/// Fills a 1-bit expansion table.
+///
+/// @param table The table.
+/// @param zero The pixel for clear bits.
+/// @param one The pixel for set bits.
+void bmp_convert_mono_table_init(bmp_convert_mono_table *table, bmp_pixel32 zero, bmp_pixel32 one);
+
+/// Expands 1-bit pixels, most significant bit first, to 32-bit pixels.
+///
+/// Each whole source byte is a single table lookup and a 32-byte copy.
+///
+/// @param dst The destination pixels.
+/// @param src The source bits.
+/// @param n Number of pixels.
+/// @param table The expansion table.
+void bmp_convert_expand_mono(bmp_pixel32 *dst, uint8_t const *src, size_t n, bmp_convert_mono_table const *table);
+
+/// Flips an image vertically in place.
+///
+/// @param pixels The image.
+/// @param row_size Size of a row including padding (bytes).
+/// @param height Number of rows.
+void bmp_convert_flip(void *pixels, size_t row_size, size_t height);
+
+#endif // SDL_BITS_INCLUDE_BMP_CONVERT_H
@@ -0,0 +1,37 @@
+#ifndef SDL_BITS_INCLUDE_CPU_ISA_H
+#define SDL_BITS_INCLUDE_CPU_ISA_H
+
+#if defined(__x86_64__) || defined(__i386__)
+/// Defined when the build has x86 kernels, which still need a CPU check.
+#    define CPU_ISA_X86
+#endif
+
+/// Instruction sets that kernels are written for, from the oldest to the newest.
+typedef enum cpu_isa
+{
+    CPU_ISA_SCALAR = 0,
+    CPU_ISA_SSE2 = 1,
+    CPU_ISA_AVX2 = 2,
+    CPU_ISA_MAX = 3,
+} cpu_isa;
+
+/// Checks whether the build and the CPU support an instruction set.
+///
+/// The CPU is only checked on the first call.
+///
+/// @param isa The instruction set.
+/// @return Nonzero if isa can run.
+int cpu_isa_supported(cpu_isa isa);
+
+/// Gets the newest instruction set supported by the build and the CPU.
+///
+/// @return The instruction set, at least CPU_ISA_SCALAR.
+cpu_isa cpu_isa_best(void);
+
+/// Gets the name of an instruction set.
+///
+/// @param isa The instruction set.
+/// @return The name, such as "sse2", or "unknown".
+char const *cpu_isa_name(cpu_isa isa);
+
+#endif // SDL_BITS_INCLUDE_CPU_ISA_H
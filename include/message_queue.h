@@ -15,7 +15,10 @@ enum message_queue_failure
     MSGQ_FAILURE_MUTEX_CREATE = 7,
     MSGQ_FAILURE_MUTEX_LOCK = 8,
     MSGQ_FAILURE_MUTEX_UNLOCK = 9,
-    MSGQ_FAILURE_MIN = 10,
+    MSGQ_FAILURE_CLOSED = 10,
+    MSGQ_FAILURE_TOO_LARGE = 11,
+    MSGQ_FAILURE_NOT_PENDING = 12,
+    MSGQ_FAILURE_MIN = 13,
 };
 
 static inline char const *message_queue_failure_str(enum message_queue_failure failure)
@@ -40,6 +43,12 @@ static inline char const *message_queue_failure_str(enum message_queue_failure f
         return "lock mutex failed";
     case MSGQ_FAILURE_MUTEX_UNLOCK:
         return "unlock mutex failed";
+    case MSGQ_FAILURE_CLOSED:
+        return "queue closed";
+    case MSGQ_FAILURE_TOO_LARGE:
+        return "message too large";
+    case MSGQ_FAILURE_NOT_PENDING:
+        return "no reservation or read pending";
     case MSGQ_FAILURE_MIN:
     default:
         return NULL;
@@ -74,7 +83,18 @@ struct message
     intptr_t value;
 };
 
+/// A variable-length message, read in place from a message_ring.
+struct message_payload
+{
+    enum message_tag tag;
+    uint32_t size;    ///< Size of data in bytes
+    void const *data; ///< Points into the ring, valid until message_ring_release()
+};
+
 /// A thread-safe bounded message queue
+///
+/// Any number of threads may put and get concurrently.  Slots are claimed
+/// without locks; consumers only sleep when the queue is empty.
 struct message_queue;
 
 /// Returns the error message associated with a return code.
@@ -91,9 +111,10 @@ char const *message_queue_tag(int tag);
 
 /// Creates a new bounded queue with the given capacity.
 ///
-/// Allocates memory for the queue and initializes it.
+/// Allocates memory for the queue and initializes it.  The capacity is rounded
+/// up to the next power of two, and a capacity of 0 to 1.
 ///
-/// @param capacity The maximum number of messages the queue can hold.
+/// @param capacity The minimum number of messages the queue can hold.
 /// @return A pointer to a new message_queue, or NULL on error.
 /// @see message_queue_destroy()
 struct message_queue *message_queue_create(uint32_t capacity);
@@ -111,19 +132,186 @@ void message_queue_destroy(struct message_queue *queue);
 /// @param queue Message queue.
 /// @param in The message to add to the back of the queue.
 /// @return 0 if the message was added to the queue, 1 if the queue is full, or a negative value on error.
+///         Returns -MSGQ_FAILURE_CLOSED if the queue has been closed.
 int message_queue_put(struct message_queue *queue, struct message *in);
 
+/// Adds as many messages as will fit to the back of the queue with a single slot claim.
+///
+/// @param queue Message queue.
+/// @param in The messages to add to the back of the queue, in order.
+/// @param n The number of messages in in.
+/// @return The number of messages added to the queue, or a negative value on error.
+///         Returns -MSGQ_FAILURE_CLOSED if the queue has been closed.
+int message_queue_put_many(struct message_queue *queue, struct message const *in, uint32_t n);
+
 /// Removes and returns the message at the front of the queue, blocking if the queue is empty.
 ///
 /// @param queue Message queue.
 /// @param out The message at the front of the queue.
 /// @return 0 if a message was removed from the queue, or a negative value on error.
+///         Returns -MSGQ_FAILURE_CLOSED once the queue has been closed and drained.
 int message_queue_get(struct message_queue *queue, struct message *out);
 
+/// Removes and returns the message at the front of the queue without blocking.
+///
+/// @param queue Message queue.
+/// @param out The message at the front of the queue.
+/// @return 0 if a message was removed from the queue, 1 if the queue is empty, or a negative value on error.
+///         Returns -MSGQ_FAILURE_CLOSED once the queue has been closed and drained.
+int message_queue_try_get(struct message_queue *queue, struct message *out);
+
+/// Removes and returns the message at the front of the queue, blocking for at most ms milliseconds if the queue is empty.
+///
+/// @param queue Message queue.
+/// @param out The message at the front of the queue.
+/// @param ms The maximum time to wait in milliseconds, or SDL_MUTEX_MAXWAIT to wait forever.
+/// @return 0 if a message was removed from the queue, 1 if the wait timed out, or a negative value on error.
+///         Returns -MSGQ_FAILURE_CLOSED once the queue has been closed and drained.
+int message_queue_get_timeout(struct message_queue *queue, struct message *out, uint32_t ms);
+
+/// Removes up to max messages from the front of the queue with a single slot claim, without blocking.
+///
+/// @param queue Message queue.
+/// @param out Storage for at least max messages, filled in queue order.
+/// @param max The maximum number of messages to remove.
+/// @return The number of messages removed from the queue, or a negative value on error.
+///         Returns -MSGQ_FAILURE_CLOSED once the queue has been closed and drained.
+int message_queue_get_many(struct message_queue *queue, struct message *out, uint32_t max);
+
+/// Closes the queue.
+///
+/// Further puts fail, and every blocked consumer is woken.  Consumers can
+/// still remove the messages that were in the queue when it was closed.  A put
+/// racing with the close either fails or adds messages that consumers still
+/// receive before they see the queue drained.
+///
+/// @param queue Message queue.
+void message_queue_close(struct message_queue *queue);
+
 /// Returns the number of messages in the queue.
 ///
 /// @param queue Message queue.
 /// @return The number of messages in the queue.
 uint32_t message_queue_size(struct message_queue *queue);
 
+/// A lock-free bounded single-producer/single-consumer message queue
+struct message_spsc_queue;
+
+/// Creates a new single-producer/single-consumer queue.
+///
+/// The capacity is rounded up to the next power of two.
+///
+/// @param capacity The minimum number of messages the queue can hold.
+/// @return A pointer to a new message_spsc_queue, or NULL on error.
+/// @see message_spsc_queue_destroy()
+struct message_spsc_queue *message_spsc_queue_create(uint32_t capacity);
+
+/// Frees resources associated with the queue.
+///
+/// Also frees the queue itself.
+///
+/// @param queue Message queue.
+/// @see message_spsc_queue_create()
+void message_spsc_queue_destroy(struct message_spsc_queue *queue);
+
+/// Adds a message to the back of the queue.
+///
+/// Must only be called from the producer thread.
+///
+/// @param queue Message queue.
+/// @param in The message to add to the back of the queue.
+/// @return 0 if the message was added to the queue, 1 if the queue is full, or a negative value on error.
+int message_spsc_queue_put(struct message_spsc_queue *queue, struct message *in);
+
+/// Removes and returns the message at the front of the queue, blocking if the queue is empty.
+///
+/// Must only be called from the consumer thread.
+///
+/// @param queue Message queue.
+/// @param out The message at the front of the queue.
+/// @return 0 if a message was removed from the queue, or a negative value on error.
+int message_spsc_queue_get(struct message_spsc_queue *queue, struct message *out);
+
+/// Removes and returns the message at the front of the queue without blocking.
+///
+/// Must only be called from the consumer thread.
+///
+/// @param queue Message queue.
+/// @param out The message at the front of the queue.
+/// @return 0 if a message was removed from the queue, 1 if the queue is empty, or a negative value on error.
+int message_spsc_queue_try_get(struct message_spsc_queue *queue, struct message *out);
+
+/// Returns the number of messages in the queue.
+///
+/// @param queue Message queue.
+/// @return The number of messages in the queue.
+uint32_t message_spsc_queue_size(struct message_spsc_queue *queue);
+
+/// A lock-free single-producer/single-consumer ring of variable-length messages
+///
+/// The producer reserves space for a payload directly in the ring, fills it
+/// in, and commits it.  The consumer reads the payload in place and releases
+/// it.  Payloads are contiguous and 8-byte aligned.
+struct message_ring;
+
+/// Creates a new ring.
+///
+/// The capacity is rounded up to the next power of two.
+///
+/// @param capacity The minimum size of the ring in bytes.
+/// @return A pointer to a new message_ring, or NULL on error.
+/// @see message_ring_destroy()
+struct message_ring *message_ring_create(uint32_t capacity);
+
+/// Frees resources associated with the ring.
+///
+/// Also frees the ring itself.
+///
+/// @param ring Message ring.
+/// @see message_ring_create()
+void message_ring_destroy(struct message_ring *ring);
+
+/// Reserves contiguous space for a payload at the back of the ring.
+///
+/// Must only be called from the producer thread.  A later reservation replaces
+/// an uncommitted one.
+///
+/// @param ring Message ring.
+/// @param size The size of the payload in bytes, at most a quarter of the capacity.
+/// @param data Set to the reserved space.
+/// @return 0 if the space was reserved, 1 if the ring is full, or a negative value on error.
+/// @see message_ring_commit()
+int message_ring_reserve(struct message_ring *ring, uint32_t size, void **data);
+
+/// Publishes the reserved payload to the consumer.
+///
+/// Must only be called from the producer thread.
+///
+/// @param ring Message ring.
+/// @param tag The message tag.
+/// @param size The size of the payload in bytes, at most the reserved size.
+/// @return 0 if the payload was published, or a negative value on error.
+/// @see message_ring_reserve()
+int message_ring_commit(struct message_ring *ring, enum message_tag tag, uint32_t size);
+
+/// Returns the payload at the front of the ring without copying or blocking.
+///
+/// Must only be called from the consumer thread.  The payload stays in the ring
+/// until it is released.
+///
+/// @param ring Message ring.
+/// @param out The payload at the front of the ring.
+/// @return 0 if a payload was read, 1 if the ring is empty, or a negative value on error.
+/// @see message_ring_release()
+int message_ring_try_read(struct message_ring *ring, struct message_payload *out);
+
+/// Removes the payload at the front of the ring, returning its space to the producer.
+///
+/// Must only be called from the consumer thread, after a successful read.
+///
+/// @param ring Message ring.
+/// @return 0 if a payload was removed, or a negative value on error.
+/// @see message_ring_try_read()
+int message_ring_release(struct message_ring *ring);
+
 #endif // SDL_BITS_INCLUDE_MESSAGE_QUEUE_H
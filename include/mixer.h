@@ -0,0 +1,136 @@
+#ifndef SDL_BITS_INCLUDE_MIXER_H
+#define SDL_BITS_INCLUDE_MIXER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// A software mixer for interleaved stereo float audio.
+///
+/// One game thread controls the voices by sending commands through a
+/// lock-free ring; the audio callback drains the ring and mixes every active
+/// voice.  Neither side ever takes a lock or allocates memory after
+/// mixer_create(), so the callback never waits on the game thread.
+///
+/// The functions taking a voice handle are producer functions and must only be
+/// called from the game thread.  mixer_mix() and mixer_callback() must only be
+/// called from the audio thread.
+struct mixer;
+
+/// Reads the next frames of a voice that produces its own samples.
+///
+/// Called on the audio thread, so it must not block or take locks.
+///
+/// @param userdata The userdata passed to mixer_play_source().
+/// @param dst Interleaved stereo output at the output sample rate.
+/// @param frames The number of frames wanted.
+/// @return The number of frames written.  Fewer than frames ends the voice.
+typedef size_t (*mixer_source_fn)(void *userdata, float *dst, size_t frames);
+
+/// Creates a mixer.
+///
+/// @param sample_rate Output sample rate (Hz).
+/// @param max_voices The maximum number of voices playing at once.
+/// @param max_commands The minimum number of commands that can be waiting for the callback.
+/// @return A pointer to a new mixer, or NULL on error.
+/// @see mixer_destroy()
+struct mixer *mixer_create(int sample_rate, uint32_t max_voices, uint32_t max_commands);
+
+/// Frees resources associated with the mixer.
+///
+/// The audio device using the mixer must be closed first.
+///
+/// @param mixer Mixer.
+/// @see mixer_create()
+void mixer_destroy(struct mixer *mixer);
+
+/// Starts a sine tone.
+///
+/// The tone fades in over the first buffer it plays in.
+///
+/// @param mixer Mixer.
+/// @param frequency Frequency (Hz), below half the sample rate.
+/// @param gain Amplitude.
+/// @param voice Set to the handle of the new voice.
+/// @return 0 if the command was sent, 1 if the command ring is full, or -1 on error.
+int mixer_play_tone(struct mixer *mixer, double frequency, float gain, uint32_t *voice);
+
+/// Starts playing decoded samples.
+///
+/// The samples are read in place, so they must stay valid until the mixer is
+/// destroyed.  A voice that does not loop stops by itself at the end.
+///
+/// @param mixer Mixer.
+/// @param samples Interleaved stereo samples at the output sample rate.
+/// @param frames The number of frames in samples.
+/// @param gain Amplitude.
+/// @param loop Non-zero to restart from the beginning at the end.
+/// @param voice Set to the handle of the new voice.
+/// @return 0 if the command was sent, 1 if the command ring is full, or -1 on error.
+int mixer_play_samples(struct mixer *mixer, float const *samples, size_t frames, float gain, int loop, uint32_t *voice);
+
+/// Starts playing samples produced by a source.
+///
+/// The source must stay valid until the mixer is destroyed.
+///
+/// @param mixer Mixer.
+/// @param read Called for each chunk of frames the voice plays.
+/// @param userdata Passed to read.
+/// @param gain Amplitude.
+/// @param voice Set to the handle of the new voice.
+/// @return 0 if the command was sent, 1 if the command ring is full, or -1 on error.
+int mixer_play_source(struct mixer *mixer, mixer_source_fn read, void *userdata, float gain, uint32_t *voice);
+
+/// Changes the amplitude of a voice, ramping to it over one buffer.
+///
+/// @param mixer Mixer.
+/// @param voice Voice handle.  Voices that have stopped are ignored.
+/// @param gain Amplitude.
+/// @return 0 if the command was sent, 1 if the command ring is full, or -1 on error.
+int mixer_set_gain(struct mixer *mixer, uint32_t voice, float gain);
+
+/// Changes the frequency of a tone without moving its phase.
+///
+/// @param mixer Mixer.
+/// @param voice Voice handle.  Voices that have stopped or are not tones are ignored.
+/// @param frequency Frequency (Hz), below half the sample rate.
+/// @return 0 if the command was sent, 1 if the command ring is full, or -1 on error.
+int mixer_set_frequency(struct mixer *mixer, uint32_t voice, double frequency);
+
+/// Fades a voice out over one buffer, then frees it.
+///
+/// @param mixer Mixer.
+/// @param voice Voice handle.  Voices that have stopped are ignored.
+/// @return 0 if the command was sent, 1 if the command ring is full, or -1 on error.
+int mixer_stop(struct mixer *mixer, uint32_t voice);
+
+/// Applies waiting commands and mixes the active voices.
+///
+/// @param mixer Mixer.
+/// @param dst Interleaved stereo output, overwritten.
+/// @param frames The number of frames to write.
+void mixer_mix(struct mixer *mixer, float *dst, size_t frames);
+
+/// An SDL audio callback for AUDIO_F32 stereo output.
+///
+/// @param userdata The mixer.
+/// @param stream The stream to write to.
+/// @param len The length of the stream in bytes.
+void mixer_callback(void *userdata, uint8_t *stream, int len);
+
+/// Returns the number of voices playing, as of the last mix.
+///
+/// May be called from any thread.
+///
+/// @param mixer Mixer.
+/// @return The number of active voices.
+uint32_t mixer_active_voices(struct mixer const *mixer);
+
+/// Returns the number of voices that could not start because every voice was in use.
+///
+/// May be called from any thread.
+///
+/// @param mixer Mixer.
+/// @return The number of dropped voices since the mixer was created.
+uint32_t mixer_dropped_voices(struct mixer const *mixer);
+
+#endif // SDL_BITS_INCLUDE_MIXER_H
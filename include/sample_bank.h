@@ -0,0 +1,82 @@
+#ifndef SDL_BITS_INCLUDE_SAMPLE_BANK_H
+#define SDL_BITS_INCLUDE_SAMPLE_BANK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// A sound converted to the output format and kept in memory.
+struct sample
+{
+    float *samples; ///< Interleaved stereo samples at the output sample rate
+    size_t frames;  ///< Number of frames in samples
+};
+
+/// A track streamed from a WAV file.
+///
+/// A reader thread decodes the file into two buffers of converted samples,
+/// refilling one while the audio thread plays the other, so the memory used
+/// does not depend on the length of the track.
+struct sample_stream;
+
+/// Sounds loaded from WAV files, converted to the output format of the mixer.
+///
+/// Short sounds are loaded whole and converted once.  Long tracks are
+/// streamed.  Either way the audio callback only copies and mixes samples
+/// that are already in the output format.
+///
+/// The bank functions must only be called from one thread.
+struct sample_bank;
+
+/// Creates an empty sample bank.
+///
+/// @param sample_rate Output sample rate (Hz).  The output is AUDIO_F32 stereo.
+/// @return The bank, or NULL on failure.
+/// @see sample_bank_destroy()
+struct sample_bank *sample_bank_create(int sample_rate);
+
+/// Stops every stream and frees every sound in the bank.
+///
+/// The audio device playing the sounds must be closed first.
+///
+/// @param bank The bank.
+void sample_bank_destroy(struct sample_bank *bank);
+
+/// Loads a WAV file whole and converts it to the output format.
+///
+/// @param bank The bank.
+/// @param path Path to the WAV file.
+/// @return The sound, valid until the bank is destroyed, or NULL on failure.
+struct sample const *sample_bank_load(struct sample_bank *bank, char const *path);
+
+/// Opens a WAV file for streaming and starts its reader thread.
+///
+/// The first buffer is decoded before returning, so the stream can be played
+/// at once.  A stream plays once, or forever if it loops.  Unsigned 8-bit,
+/// signed 16-bit and 32-bit integer, and 32-bit float PCM are supported.
+///
+/// @param bank The bank.
+/// @param path Path to the WAV file.
+/// @param loop Non-zero to restart from the beginning at the end.
+/// @return The stream, valid until the bank is destroyed, or NULL on failure.
+struct sample_stream *sample_bank_open_stream(struct sample_bank *bank, char const *path, int loop);
+
+/// Copies the next frames of a stream.  A mixer_source_fn.
+///
+/// Called from the audio thread, by at most one voice.  Never blocks: if the
+/// reader thread has fallen behind, the rest of dst is filled with silence.
+///
+/// @param stream The stream.
+/// @param dst Interleaved stereo output at the output sample rate.
+/// @param frames The number of frames wanted.
+/// @return frames, or fewer once the track has ended.
+size_t sample_stream_read(void *stream, float *dst, size_t frames);
+
+/// Returns the number of times the audio thread found no decoded samples ready.
+///
+/// May be called from any thread.
+///
+/// @param stream The stream.
+/// @return The number of underruns.
+uint32_t sample_stream_underruns(struct sample_stream const *stream);
+
+#endif // SDL_BITS_INCLUDE_SAMPLE_BANK_H
@@ -0,0 +1,28 @@
+#ifndef SDL_BITS_INCLUDE_SDF_H
+#define SDL_BITS_INCLUDE_SDF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// Value of a signed distance field on the edge of a shape.
+#define SDF_EDGE 128
+
+/// Computes a signed distance field from a coverage mask.
+///
+/// Distances are exact Euclidean distances between pixel centers, computed in
+/// time linear in the number of pixels with the Felzenszwalb-Huttenlocher
+/// transform.  The edge lies halfway between an inside and an outside pixel.
+/// A pixel at signed distance d, positive inside, maps to
+/// SDF_EDGE + 127 * d / spread, rounded and clamped to [0, 255].  Values reach
+/// 255 at spread pixels inside the edge and 1 at spread pixels outside it, and
+/// are 0 only past spread * 128 / 127 pixels outside.
+///
+/// @param dst The distance field, width * height bytes.
+/// @param src The mask, width * height bytes, non-zero inside the shape.
+/// @param width Width (pixels).
+/// @param height Height (pixels).
+/// @param spread Distance from the edge at which the field saturates (pixels).
+/// @return 0 on success, -1 on error.
+int sdf_generate(uint8_t *dst, uint8_t const *src, size_t width, size_t height, double spread);
+
+#endif // SDL_BITS_INCLUDE_SDF_H
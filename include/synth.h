@@ -0,0 +1,57 @@
+#ifndef SDL_BITS_INCLUDE_SYNTH_H
+#define SDL_BITS_INCLUDE_SYNTH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cpu_isa.h"
+
+/// A sine oscillator.
+///
+/// The phase is a fixed-point fraction of a cycle that wraps around at 2^32,
+/// so it never loses precision however long the oscillator runs.
+typedef struct synth_osc
+{
+    uint32_t phase;     // Position in the cycle, 2^32 per cycle
+    uint32_t increment; // Phase advance per frame
+    float gain;         // Amplitude
+} synth_osc;
+
+/// Synthesis kernels for one instruction set.
+///
+/// The vector kernels evaluate the same polynomial as synth_sine() in the same
+/// order, so a mix sounds the same whichever kernels the CPU picks.
+typedef struct synth_kernels
+{
+    /// Writes n frames of a sine wave as interleaved stereo samples, and advances the oscillator.
+    void (*sine_stereo)(float *dst, size_t n, synth_osc *osc);
+} synth_kernels;
+
+/// Gets the synthesis kernels written for an instruction set.
+///
+/// @param isa The instruction set.
+/// @return The kernels, or NULL if this machine cannot run them.
+synth_kernels const *synth_get_kernels(cpu_isa isa);
+
+/// Gets the fastest synthesis kernels this machine can run, as used by the mixer.
+///
+/// @return The kernels.
+synth_kernels const *synth_best_kernels(void);
+
+/// Sets the frequency of an oscillator without moving its phase.
+///
+/// @param osc The oscillator.
+/// @param frequency Frequency (Hz), below half the sample rate.
+/// @param sample_rate Sample rate (Hz).
+void synth_osc_set_frequency(synth_osc *osc, double frequency, int sample_rate);
+
+/// Computes one sample of a sine wave.
+///
+/// Uses a polynomial accurate to about 1e-6 rather than libm, and matches the
+/// samples of the kernels exactly.
+///
+/// @param phase Position in the cycle, 2^32 per cycle.
+/// @return The sine of the phase.
+float synth_sine(uint32_t phase);
+
+#endif // SDL_BITS_INCLUDE_SYNTH_H
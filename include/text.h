@@ -0,0 +1,97 @@
+#ifndef SDL_BITS_INCLUDE_TEXT_H
+#define SDL_BITS_INCLUDE_TEXT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <SDL.h>
+
+#include "atlas.h"
+#include "bmp.h"
+
+/// A string laid out against a glyph atlas.
+///
+/// Every visible glyph is a quad of four vertices, top-left, top-right,
+/// bottom-left and bottom-right, positioned relative to the top-left corner
+/// of the first line and colored white.
+struct text_layout
+{
+    SDL_Vertex *vertices; ///< Four vertices per quad
+    uint32_t *offsets;    ///< Byte offset in the string of the codepoint each quad draws
+    size_t count;         ///< Number of quads
+    float width;          ///< Width of the widest line (pixels)
+    float height;         ///< Height of all lines (pixels)
+    uint64_t version;     ///< Zero, or set by a layout cache to a new value whenever the vertices change
+};
+
+/// Lays out a UTF-8 string.
+///
+/// Lines are separated by '\n'.  Codepoints missing from the atlas, and
+/// invalid UTF-8 sequences, are drawn as '?' if the atlas has it and skipped
+/// otherwise.
+///
+/// @param layout The layout to initialize.
+/// @param metrics The metrics of the atlas.
+/// @param str The string.
+/// @param len Length of the string (bytes), less than UINT32_MAX.
+/// @return 0 on success, -1 on error.
+int text_layout_init(struct text_layout *layout, atlas_metrics const *metrics, char const *str, size_t len);
+
+/// Frees the vertices of a layout.
+///
+/// @param layout The layout.
+void text_layout_free(struct text_layout *layout);
+
+/// Draws text from a glyph atlas in batches.
+///
+/// Strings drawn with text_draw() are collected into one vertex buffer, which
+/// text_flush() sends to the renderer in a single SDL_RenderGeometry() call.
+/// Layouts come from a text_cache, so a string drawn every frame is only laid
+/// out again when it changes, and a frame that draws the same layouts at the
+/// same places as the last one reuses the vertex buffer as it is.
+struct text_renderer;
+
+/// Creates a text renderer and uploads its atlas.
+///
+/// The atlas is uploaded as white with its alpha as coverage, so that vertex
+/// colors tint the text.  Distance field atlases are not supported, because
+/// SDL_Renderer cannot threshold them.
+///
+/// @param renderer The renderer, which must outlive the text renderer.
+/// @param metrics The metrics of the atlas, which the text renderer takes over on success.
+/// @param pixels The atlas, metrics->width * metrics->height top-down pixels.
+/// @param cache_budget Memory for cached layouts (bytes).
+/// @return The text renderer, or NULL on failure.
+struct text_renderer *text_renderer_create(SDL_Renderer *renderer, atlas_metrics *metrics, bmp_pixel32 const *pixels,
+                                           size_t cache_budget);
+
+/// Destroys a text renderer, its atlas texture and its cached layouts.
+///
+/// @param text The text renderer, or NULL.
+void text_renderer_destroy(struct text_renderer *text);
+
+/// Queues a string for the next text_flush().
+///
+/// @param text The text renderer.
+/// @param str The string, UTF-8.
+/// @param x Left edge (pixels).
+/// @param y Top edge (pixels).
+/// @param color Color of the text.
+/// @return 0 on success, -1 on error.
+int text_draw(struct text_renderer *text, char const *str, float x, float y, SDL_Color color);
+
+/// Renders every string queued since the last flush, and starts a new frame.
+///
+/// @param text The text renderer.
+/// @return 0 on success, -1 on error.
+int text_flush(struct text_renderer *text);
+
+struct text_cache_stats;
+
+/// Gets the counters of the layout cache of a text renderer.
+///
+/// @param text The text renderer.
+/// @param stats The counters.
+void text_get_cache_stats(struct text_renderer const *text, struct text_cache_stats *stats);
+
+#endif // SDL_BITS_INCLUDE_TEXT_H
@@ -0,0 +1,67 @@
+#ifndef SDL_BITS_INCLUDE_TEXT_CACHE_H
+#define SDL_BITS_INCLUDE_TEXT_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "atlas.h"
+#include "text.h"
+
+/// Counters of a layout cache.
+struct text_cache_stats
+{
+    uint64_t hits;      ///< Lookups that found the string
+    uint64_t patches;   ///< Lookups that rewrote the digits of a cached layout
+    uint64_t misses;    ///< Lookups that laid the string out
+    uint64_t evictions; ///< Layouts dropped to stay within the budget
+    size_t entries;     ///< Layouts cached
+    size_t size;        ///< Memory held by the cached layouts (bytes)
+};
+
+/// Caches text layouts by font and string, least recently used first out.
+///
+/// Strings that only differ in their ASCII digits share a key, so that a
+/// counter which changes every frame rewrites the quads of the digits that
+/// changed instead of laying out the whole string.  This needs every digit in
+/// the font to have a quad and the same advance; otherwise the string is laid
+/// out again.  A layout drawn in the current frame is never patched for
+/// another string, so strings like "P1" and "P2" drawn side by side each keep
+/// their own layout.
+struct text_cache;
+
+/// Creates a layout cache.
+///
+/// @param budget Memory the cached layouts may hold (bytes).
+/// @return The cache, or NULL on failure.
+struct text_cache *text_cache_create(size_t budget);
+
+/// Destroys a cache and its layouts.
+///
+/// @param cache The cache, or NULL.
+void text_cache_destroy(struct text_cache *cache);
+
+/// Gets the layout of a string.
+///
+/// Fonts are told apart by their address, so a font must not be freed while
+/// its layouts are cached.  A string larger than the whole budget is laid out
+/// on its own, and only lasts until the next such string.
+///
+/// @param cache The cache.
+/// @param font The metrics of the font.
+/// @param str The string, UTF-8.
+/// @param len Length of the string (bytes).
+/// @return The layout, valid until the next call, or NULL on error.
+struct text_layout const *text_cache_get(struct text_cache *cache, atlas_metrics const *font, char const *str, size_t len);
+
+/// Starts a new frame, after which layouts drawn in the last frame may be patched.
+///
+/// @param cache The cache.
+void text_cache_next_frame(struct text_cache *cache);
+
+/// Gets the counters of a cache.
+///
+/// @param cache The cache.
+/// @param stats The counters.
+void text_cache_get_stats(struct text_cache const *cache, struct text_cache_stats *stats);
+
+#endif // SDL_BITS_INCLUDE_TEXT_CACHE_H
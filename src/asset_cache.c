@@ -0,0 +1,362 @@
+#include "asset_cache.h"
+#include "macro.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#    include <direct.h>
+#    include <io.h>
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <unistd.h>
+#endif
+
+static uint32_t const ASSET_CACHE_MAGIC = 0x43505842; // "BXPC"
+static uint32_t const ASSET_CACHE_VERSION = 2;
+
+static uint64_t const FNV_OFFSET_BASIS = 0xCBF29CE484222325;
+static uint64_t const FNV_PRIME = 0x100000001B3;
+
+/// Header of a cache entry, followed by width * height top-down BGRA pixels.
+typedef struct asset_cache_header
+{
+    uint32_t magic;        // ASSET_CACHE_MAGIC
+    uint32_t version;      // ASSET_CACHE_VERSION
+    int64_t source_mtime;  // Modification time of the source file (seconds)
+    uint64_t source_size;  // Size of the source file (bytes)
+    uint32_t width;        // Image width (pixels)
+    uint32_t height;       // Image height (pixels)
+    uint32_t source_nsec;  // Sub-second part of the modification time (nanoseconds)
+    uint8_t reserved[28];  // Pads the header so that the pixels are 64-byte aligned
+} asset_cache_header;
+
+STATIC_ASSERT(sizeof(asset_cache_header) == 64);
+
+/// Hashes a string with 64-bit FNV-1a.
+static uint64_t hash_str(char const *str)
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (unsigned char const *p = (unsigned char const *)str; *p != '\0'; ++p)
+    {
+        hash = (hash ^ *p) * FNV_PRIME;
+    }
+    return hash;
+}
+
+#ifdef _WIN32
+/// Seconds from 1601-01-01, the FILETIME epoch, to 1970-01-01.
+static int64_t const FILETIME_UNIX_EPOCH = 11644473600;
+
+/// Gets the size and modification time of a source file.
+static int stat_source(char const *source, uint64_t *size, int64_t *mtime, uint32_t *nsec)
+{
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (GetFileAttributesExA(source, GetFileExInfoStandard, &data) == 0)
+    {
+        return -1;
+    }
+    *size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    // A FILETIME counts 100 ns intervals.
+    uint64_t const ticks = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+    *mtime = (int64_t)(ticks / 10000000) - FILETIME_UNIX_EPOCH;
+    *nsec = (uint32_t)(ticks % 10000000) * 100;
+    return 0;
+}
+
+static void *map_entry(char const *file, size_t *size)
+{
+    HANDLE file_handle = CreateFileA(file, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file_handle == INVALID_HANDLE_VALUE)
+    {
+        return NULL;
+    }
+    LARGE_INTEGER file_size;
+    if (GetFileSizeEx(file_handle, &file_size) == 0 || file_size.QuadPart <= 0)
+    {
+        CloseHandle(file_handle);
+        return NULL;
+    }
+    HANDLE mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file_handle);
+    if (mapping_handle == NULL)
+    {
+        return NULL;
+    }
+    void *base = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping_handle);
+    if (base == NULL)
+    {
+        return NULL;
+    }
+    *size = (size_t)file_size.QuadPart;
+    return base;
+}
+
+static void unmap_entry(void *base, __attribute__((unused)) size_t size)
+{
+    UnmapViewOfFile(base);
+}
+
+static int make_dir(char const *dir)
+{
+    return _mkdir(dir);
+}
+
+static FILE *open_temp(char *tmp_path)
+{
+    if (_mktemp_s(tmp_path, strlen(tmp_path) + 1) != 0)
+    {
+        return NULL;
+    }
+    return fopen(tmp_path, "wbx");
+}
+
+static int replace_file(char const *from, char const *to)
+{
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) ? 0 : -1;
+}
+#else
+/// Gets the size and modification time of a source file.
+static int stat_source(char const *source, uint64_t *size, int64_t *mtime, uint32_t *nsec)
+{
+    struct stat st;
+    if (stat(source, &st) != 0 || st.st_size < 0)
+    {
+        return -1;
+    }
+    *size = (uint64_t)st.st_size;
+#    ifdef __APPLE__
+    *mtime = (int64_t)st.st_mtimespec.tv_sec;
+    *nsec = (uint32_t)st.st_mtimespec.tv_nsec;
+#    else
+    *mtime = (int64_t)st.st_mtim.tv_sec;
+    *nsec = (uint32_t)st.st_mtim.tv_nsec;
+#    endif
+    return 0;
+}
+
+static void *map_entry(char const *file, size_t *size)
+{
+    int fd = open(file, O_RDONLY);
+    if (fd == -1)
+    {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        return NULL;
+    }
+    *size = (size_t)st.st_size;
+    return base;
+}
+
+static void unmap_entry(void *base, size_t size)
+{
+    munmap(base, size);
+}
+
+static int make_dir(char const *dir)
+{
+    return mkdir(dir, 0755);
+}
+
+static FILE *open_temp(char *tmp_path)
+{
+    int fd = mkstemp(tmp_path);
+    if (fd == -1)
+    {
+        return NULL;
+    }
+    FILE *file_handle = fdopen(fd, "wb");
+    if (file_handle == NULL)
+    {
+        close(fd);
+        remove(tmp_path);
+    }
+    return file_handle;
+}
+
+static int replace_file(char const *from, char const *to)
+{
+    return rename(from, to);
+}
+#endif
+
+int asset_cache_init(char const *dir)
+{
+    if (dir == NULL)
+    {
+        return -1;
+    }
+    if (make_dir(dir) != 0 && errno != EEXIST)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+char *asset_cache_path(char const *dir, char const *source)
+{
+    if (dir == NULL || source == NULL)
+    {
+        return NULL;
+    }
+    unsigned long long const hash = hash_str(source);
+    int const len = snprintf(NULL, 0, "%s/%016llx.px", dir, hash);
+    if (len < 0)
+    {
+        return NULL;
+    }
+    char *path = malloc((size_t)len + 1);
+    if (path == NULL)
+    {
+        return NULL;
+    }
+    (void)snprintf(path, (size_t)len + 1, "%s/%016llx.px", dir, hash);
+    return path;
+}
+
+/// Checks that a mapped entry is complete and matches the source file.
+static int validate_entry(asset_cache_header const *header, size_t size, uint64_t source_size, int64_t source_mtime,
+                          uint32_t source_nsec)
+{
+    if (size < sizeof(*header) || header->magic != ASSET_CACHE_MAGIC || header->version != ASSET_CACHE_VERSION)
+    {
+        return -1;
+    }
+    if (header->source_size != source_size || header->source_mtime != source_mtime || header->source_nsec != source_nsec)
+    {
+        return -1;
+    }
+    size_t const pixels_size = (size_t)header->width * header->height * sizeof(bmp_pixel32);
+    if (header->width == 0 || header->height == 0 || pixels_size / header->width / header->height != sizeof(bmp_pixel32)
+        || pixels_size != size - sizeof(*header))
+    {
+        return -1;
+    }
+    return 0;
+}
+
+int asset_cache_open(char const *dir, char const *source, asset_cache_entry *entry)
+{
+    if (entry == NULL)
+    {
+        return -1;
+    }
+    memset(entry, 0, sizeof(*entry));
+
+    uint64_t source_size = 0;
+    int64_t source_mtime = 0;
+    uint32_t source_nsec = 0;
+    if (source == NULL || stat_source(source, &source_size, &source_mtime, &source_nsec) != 0)
+    {
+        return -1;
+    }
+    char *path = asset_cache_path(dir, source);
+    if (path == NULL)
+    {
+        return -1;
+    }
+
+    size_t size = 0;
+    unsigned char *base = map_entry(path, &size);
+    free(path);
+    if (base == NULL)
+    {
+        return 1;
+    }
+    asset_cache_header const *header = (asset_cache_header const *)base;
+    if (validate_entry(header, size, source_size, source_mtime, source_nsec) != 0)
+    {
+        unmap_entry(base, size);
+        return 1;
+    }
+
+    entry->base = base;
+    entry->size = size;
+    entry->pixels = (bmp_pixel32 const *)(base + sizeof(*header));
+    entry->width = header->width;
+    entry->height = header->height;
+    return 0;
+}
+
+void asset_cache_close(asset_cache_entry *entry)
+{
+    if (entry == NULL || entry->base == NULL)
+    {
+        return;
+    }
+    unmap_entry(entry->base, entry->size);
+    memset(entry, 0, sizeof(*entry));
+}
+
+int asset_cache_store(char const *dir, char const *source, bmp_pixel32 const *pixels, size_t width, size_t height)
+{
+    if (pixels == NULL || width == 0 || height == 0 || width > UINT32_MAX || height > UINT32_MAX
+        || width > SIZE_MAX / sizeof(*pixels) / height)
+    {
+        return -1;
+    }
+    asset_cache_header header = {
+        .magic = ASSET_CACHE_MAGIC,
+        .version = ASSET_CACHE_VERSION,
+        .width = (uint32_t)width,
+        .height = (uint32_t)height,
+    };
+    if (source == NULL || stat_source(source, &header.source_size, &header.source_mtime, &header.source_nsec) != 0)
+    {
+        return -1;
+    }
+
+    int ret = -1;
+    char *path = asset_cache_path(dir, source);
+    if (path == NULL)
+    {
+        return -1;
+    }
+    size_t const path_len = strlen(path);
+    char *tmp_path = malloc(path_len + sizeof(".XXXXXX"));
+    if (tmp_path == NULL)
+    {
+        goto out_free_path;
+    }
+    memcpy(tmp_path, path, path_len);
+    memcpy(&tmp_path[path_len], ".XXXXXX", sizeof(".XXXXXX"));
+
+    FILE *file_handle = open_temp(tmp_path);
+    if (file_handle == NULL)
+    {
+        goto out_free_tmp_path;
+    }
+    int const written = fwrite(&header, sizeof(header), 1, file_handle) == 1
+                        && fwrite(pixels, width * height * sizeof(*pixels), 1, file_handle) == 1;
+    if (fclose(file_handle) != 0 || !written || replace_file(tmp_path, path) != 0)
+    {
+        remove(tmp_path);
+        goto out_free_tmp_path;
+    }
+
+    ret = 0;
+out_free_tmp_path:
+    free(tmp_path);
+out_free_path:
+    free(path);
+    return ret;
+}
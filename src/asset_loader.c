@@ -0,0 +1,286 @@
+#include "asset_loader.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "asset_cache.h"
+#include "bmp.h"
+#include "message_queue.h"
+
+/// A submitted asset, passed to a worker through the job queue and back through the result queue.
+struct asset_job
+{
+    struct asset asset; // Filled in by the worker
+    char path[];        // Path to the BMP file
+};
+
+struct asset_loader
+{
+    struct message_queue *jobs;    // Jobs waiting for a worker
+    struct message_queue *results; // Jobs decoded by a worker
+    _Atomic uint32_t pending;      // Jobs submitted but not collected
+    _Atomic int stopping;          // Non-zero once the loader is being destroyed
+    uint32_t capacity;             // Maximum value of pending
+    uint32_t threads;              // Number of workers started
+    char *cache_dir;               // Cache directory, or NULL
+    SDL_Thread **workers;          // Worker threads
+};
+
+/// Puts a decoded job on the result queue.
+///
+/// The result queue holds at least capacity messages and at most capacity
+/// jobs are outstanding, so it only fills up transiently while the render
+/// thread is still removing an earlier result.
+static int asset_loader_finish(struct asset_loader *loader, struct asset_job *job)
+{
+    struct message msg = { .tag = MSG_TAG_SOME, .value = (intptr_t)job };
+    int rc = 0;
+    while ((rc = message_queue_put(loader->results, &msg)) == 1)
+    {
+        SDL_Delay(1);
+    }
+    return rc;
+}
+
+/// Maps an asset from the cache, or decodes it and stores it in the cache.
+static void asset_loader_load(struct asset_loader *loader, char const *path, struct asset *asset)
+{
+    if (loader->cache_dir != NULL && asset_cache_open(loader->cache_dir, path, &asset->cached) == 0)
+    {
+        asset->status = 0;
+        asset->pixels = asset->cached.pixels;
+        asset->width = asset->cached.width;
+        asset->height = asset->cached.height;
+        return;
+    }
+
+    asset->status = bmp_load(path, &asset->decoded, &asset->width, &asset->height);
+    if (asset->status != 0)
+        return;
+
+    asset->pixels = asset->decoded;
+    if (loader->cache_dir != NULL)
+    {
+        // A failed store only costs a decode on the next run.
+        (void)asset_cache_store(loader->cache_dir, path, asset->decoded, asset->width, asset->height);
+    }
+}
+
+static int asset_loader_work(void *data)
+{
+    struct asset_loader *loader = data;
+    struct message msg = { 0 };
+    for (;;)
+    {
+        int rc = message_queue_get(loader->jobs, &msg);
+        if (rc == -MSGQ_FAILURE_CLOSED)
+            return 0;
+
+        if (rc < 0)
+            return -1;
+
+        struct asset_job *job = (struct asset_job *)msg.value;
+        job->asset.status = -1;
+        if (atomic_load_explicit(&loader->stopping, memory_order_relaxed) == 0)
+        {
+            asset_loader_load(loader, job->path, &job->asset);
+        }
+
+        rc = asset_loader_finish(loader, job);
+        if (rc < 0)
+            return -1;
+    }
+}
+
+/// Stops and joins the first n workers.
+static void asset_loader_stop(struct asset_loader *loader, uint32_t n)
+{
+    atomic_store(&loader->stopping, 1);
+    message_queue_close(loader->jobs);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        SDL_WaitThread(loader->workers[i], NULL);
+    }
+}
+
+/// Frees the pixels of any uncollected results.
+static void asset_loader_drain(struct asset_loader *loader)
+{
+    struct message msg = { 0 };
+    while (message_queue_try_get(loader->results, &msg) == 0)
+    {
+        struct asset_job *job = (struct asset_job *)msg.value;
+        asset_release(&job->asset);
+        free(job);
+    }
+    // Jobs that never reached a worker only exist if the workers failed.
+    while (message_queue_try_get(loader->jobs, &msg) == 0)
+    {
+        free((struct asset_job *)msg.value);
+    }
+}
+
+struct asset_loader *asset_loader_create(uint32_t threads, uint32_t capacity, char const *cache_dir)
+{
+    if (threads == 0 || capacity == 0)
+        return NULL;
+
+    struct asset_loader *loader = calloc(1, sizeof(*loader));
+    if (loader == NULL)
+        return NULL;
+
+    atomic_init(&loader->pending, 0);
+    atomic_init(&loader->stopping, 0);
+    loader->capacity = capacity;
+
+    if (cache_dir != NULL)
+    {
+        size_t const size = strlen(cache_dir) + 1;
+        loader->cache_dir = malloc(size);
+        if (loader->cache_dir == NULL)
+            goto out_free_loader;
+
+        memcpy(loader->cache_dir, cache_dir, size);
+    }
+
+    loader->jobs = message_queue_create(capacity);
+    if (loader->jobs == NULL)
+        goto out_free_cache_dir;
+
+    loader->results = message_queue_create(capacity);
+    if (loader->results == NULL)
+        goto out_destroy_jobs;
+
+    loader->workers = calloc(threads, sizeof(*loader->workers));
+    if (loader->workers == NULL)
+        goto out_destroy_results;
+
+    for (; loader->threads < threads; ++loader->threads)
+    {
+        SDL_Thread *worker = SDL_CreateThread(asset_loader_work, "asset_loader", loader);
+        if (worker == NULL)
+            goto out_stop_workers;
+
+        loader->workers[loader->threads] = worker;
+    }
+    return loader;
+
+out_stop_workers:
+    asset_loader_stop(loader, loader->threads);
+    free(loader->workers);
+out_destroy_results:
+    message_queue_destroy(loader->results);
+out_destroy_jobs:
+    message_queue_destroy(loader->jobs);
+out_free_cache_dir:
+    free(loader->cache_dir);
+out_free_loader:
+    free(loader);
+    return NULL;
+}
+
+void asset_loader_destroy(struct asset_loader *loader)
+{
+    if (loader == NULL)
+        return;
+
+    asset_loader_stop(loader, loader->threads);
+    asset_loader_drain(loader);
+    free(loader->workers);
+    message_queue_destroy(loader->results);
+    message_queue_destroy(loader->jobs);
+    free(loader->cache_dir);
+    free(loader);
+}
+
+int asset_loader_submit(struct asset_loader *loader, char const *path, intptr_t id)
+{
+    if (loader == NULL || path == NULL)
+        return -MSGQ_FAILURE_NULL_POINTER;
+
+    uint32_t pending = atomic_load(&loader->pending);
+    do
+    {
+        if (pending >= loader->capacity)
+            return 1;
+    } while (!atomic_compare_exchange_weak(&loader->pending, &pending, pending + 1));
+
+    size_t const path_size = strlen(path) + 1;
+    struct asset_job *job = calloc(1, sizeof(*job) + path_size);
+    if (job == NULL)
+    {
+        atomic_fetch_sub(&loader->pending, 1);
+        return -MSGQ_FAILURE_MALLOC;
+    }
+    job->asset.id = id;
+    memcpy(job->path, path, path_size);
+
+    struct message msg = { .tag = MSG_TAG_SOME, .value = (intptr_t)job };
+    int const rc = message_queue_put(loader->jobs, &msg);
+    if (rc != 0)
+    {
+        free(job);
+        atomic_fetch_sub(&loader->pending, 1);
+        return (rc < 0) ? rc : 1;
+    }
+    return 0;
+}
+
+/// Moves a result into out and releases its job.
+static void asset_loader_collect(struct asset_loader *loader, struct message const *msg, struct asset *out)
+{
+    struct asset_job *job = (struct asset_job *)msg->value;
+    *out = job->asset;
+    free(job);
+    atomic_fetch_sub(&loader->pending, 1);
+}
+
+int asset_loader_get(struct asset_loader *loader, struct asset *out)
+{
+    if (loader == NULL || out == NULL)
+        return -MSGQ_FAILURE_NULL_POINTER;
+
+    if (atomic_load(&loader->pending) == 0)
+        return 1;
+
+    struct message msg = { 0 };
+    int const rc = message_queue_get(loader->results, &msg);
+    if (rc != 0)
+        return rc;
+
+    asset_loader_collect(loader, &msg, out);
+    return 0;
+}
+
+int asset_loader_try_get(struct asset_loader *loader, struct asset *out)
+{
+    if (loader == NULL || out == NULL)
+        return -MSGQ_FAILURE_NULL_POINTER;
+
+    struct message msg = { 0 };
+    int const rc = message_queue_try_get(loader->results, &msg);
+    if (rc != 0)
+        return rc;
+
+    asset_loader_collect(loader, &msg, out);
+    return 0;
+}
+
+void asset_release(struct asset *asset)
+{
+    if (asset == NULL)
+        return;
+
+    free(asset->decoded);
+    asset_cache_close(&asset->cached);
+    asset->decoded = NULL;
+    asset->pixels = NULL;
+}
+
+uint32_t asset_loader_pending(struct asset_loader *loader)
+{
+    return (loader == NULL) ? 0 : atomic_load(&loader->pending);
+}
@@ -0,0 +1,383 @@
+#include "atlas.h"
+#include "macro.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t const ATLAS_MAGIC = 0x534C5441; // "ATLS"
+static uint32_t const ATLAS_VERSION = 1;
+
+/// Header of a metrics file, followed by count glyphs.
+typedef struct atlas_file_header
+{
+    uint32_t magic;      // ATLAS_MAGIC
+    uint32_t version;    // ATLAS_VERSION
+    uint32_t width;      // Atlas width (pixels)
+    uint32_t height;     // Atlas height (pixels)
+    int32_t line_height; // Distance between baselines (pixels)
+    int32_t ascent;      // Distance from the top of a line to its baseline (pixels)
+    uint32_t count;      // Number of glyphs
+    uint32_t sdf_spread; // Distance field spread (pixels), 0 for a coverage atlas
+} atlas_file_header;
+
+STATIC_ASSERT(sizeof(atlas_file_header) == 32);
+STATIC_ASSERT(sizeof(atlas_glyph) == 20);
+
+/// A segment of the skyline: the top of the packed area between x and x + width.
+typedef struct skyline_node
+{
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+} skyline_node;
+
+typedef struct skyline
+{
+    skyline_node *nodes;
+    size_t count;
+    uint32_t width;  // Packing width, including trailing padding
+    uint32_t height; // Packing height, including trailing padding
+} skyline;
+
+/// Finds the lowest y at which a rectangle fits with its left edge on node i.
+///
+/// @return 0 on success, -1 if it does not fit.
+static int skyline_fit(skyline const *sky, size_t i, uint32_t width, uint32_t height, uint32_t *y)
+{
+    uint32_t const x = sky->nodes[i].x;
+    if (width > sky->width - x)
+    {
+        return -1;
+    }
+    uint32_t top = 0;
+    for (uint32_t remaining = width; i < sky->count; ++i)
+    {
+        top = (sky->nodes[i].y > top) ? sky->nodes[i].y : top;
+        if (height > sky->height - top)
+        {
+            return -1;
+        }
+        if (sky->nodes[i].width >= remaining)
+        {
+            break;
+        }
+        remaining -= sky->nodes[i].width;
+    }
+    *y = top;
+    return 0;
+}
+
+/// Raises the skyline under a rectangle placed on node i.
+static void skyline_add(skyline *sky, size_t i, uint32_t width, uint32_t height, uint32_t y)
+{
+    skyline_node const node = { sky->nodes[i].x, y + height, width };
+    memmove(&sky->nodes[i + 1], &sky->nodes[i], (sky->count - i) * sizeof(*sky->nodes));
+    sky->nodes[i] = node;
+    ++sky->count;
+
+    // Trim or remove the nodes now hidden under the new one.
+    uint32_t const right = node.x + node.width;
+    size_t j = i + 1;
+    while (j < sky->count && sky->nodes[j].x < right)
+    {
+        uint32_t const end = sky->nodes[j].x + sky->nodes[j].width;
+        if (end > right)
+        {
+            sky->nodes[j].width = end - right;
+            sky->nodes[j].x = right;
+            break;
+        }
+        ++j;
+    }
+    memmove(&sky->nodes[i + 1], &sky->nodes[j], (sky->count - j) * sizeof(*sky->nodes));
+    sky->count -= j - (i + 1);
+
+    // Merge neighbors of equal height.
+    for (size_t k = 0; k + 1 < sky->count;)
+    {
+        if (sky->nodes[k].y == sky->nodes[k + 1].y)
+        {
+            sky->nodes[k].width += sky->nodes[k + 1].width;
+            memmove(&sky->nodes[k + 1], &sky->nodes[k + 2], (sky->count - k - 2) * sizeof(*sky->nodes));
+            --sky->count;
+        }
+        else
+        {
+            ++k;
+        }
+    }
+}
+
+/// Places a rectangle at the lowest position, preferring the narrowest node on ties.
+static int skyline_insert(skyline *sky, uint32_t width, uint32_t height, uint32_t *x, uint32_t *y)
+{
+    size_t best = SIZE_MAX;
+    uint32_t best_bottom = UINT32_MAX;
+    uint32_t best_width = UINT32_MAX;
+    uint32_t best_y = 0;
+    for (size_t i = 0; i < sky->count; ++i)
+    {
+        uint32_t top = 0;
+        if (skyline_fit(sky, i, width, height, &top) != 0)
+        {
+            continue;
+        }
+        uint32_t const bottom = top + height;
+        if (bottom < best_bottom || (bottom == best_bottom && sky->nodes[i].width < best_width))
+        {
+            best = i;
+            best_bottom = bottom;
+            best_width = sky->nodes[i].width;
+            best_y = top;
+        }
+    }
+    if (best == SIZE_MAX)
+    {
+        return -1;
+    }
+    *x = sky->nodes[best].x;
+    *y = best_y;
+    skyline_add(sky, best, width, height, best_y);
+    return 0;
+}
+
+static int compare_rects(void const *a, void const *b)
+{
+    atlas_rect const *const ra = *(atlas_rect *const *)a;
+    atlas_rect const *const rb = *(atlas_rect *const *)b;
+    if (ra->height != rb->height)
+    {
+        return (ra->height < rb->height) ? 1 : -1;
+    }
+    if (ra->width != rb->width)
+    {
+        return (ra->width < rb->width) ? 1 : -1;
+    }
+    return 0;
+}
+
+/// Packs the sorted rectangles into an atlas of the given size.
+static int pack_size(skyline *sky, atlas_rect *const *sorted, size_t n, uint32_t padding, uint32_t width, uint32_t height)
+{
+    sky->width = width + padding;
+    sky->height = height + padding;
+    sky->nodes[0] = (skyline_node){ 0, 0, sky->width };
+    sky->count = 1;
+    for (size_t i = 0; i < n; ++i)
+    {
+        atlas_rect *const rect = sorted[i];
+        if (skyline_insert(sky, rect->width + padding, rect->height + padding, &rect->x, &rect->y) != 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int atlas_pack(atlas_rect *rects, size_t n, uint32_t padding, uint32_t max_size, uint32_t *width, uint32_t *height)
+{
+    if ((rects == NULL && n > 0) || width == NULL || height == NULL || max_size > UINT32_MAX / 2 || padding > max_size)
+    {
+        return -1;
+    }
+
+    // Sort the non-empty rectangles, tallest first, and find the smallest size that could hold them.
+    atlas_rect **sorted = malloc((n + 1) * sizeof(*sorted));
+    if (sorted == NULL)
+    {
+        return -1;
+    }
+    size_t count = 0;
+    uint64_t area = 0;
+    uint32_t min_width = 1;
+    uint32_t min_height = 1;
+    for (size_t i = 0; i < n; ++i)
+    {
+        atlas_rect *const rect = &rects[i];
+        rect->x = 0;
+        rect->y = 0;
+        if (rect->width == 0 || rect->height == 0)
+        {
+            continue;
+        }
+        if (rect->width > max_size || rect->height > max_size)
+        {
+            free(sorted);
+            return -1;
+        }
+        uint64_t const padded_width = (uint64_t)rect->width + padding;
+        uint64_t const padded_height = (uint64_t)rect->height + padding;
+        area += padded_width * padded_height;
+        min_width = (rect->width > min_width) ? rect->width : min_width;
+        min_height = (rect->height > min_height) ? rect->height : min_height;
+        sorted[count++] = rect;
+    }
+    qsort(sorted, count, sizeof(*sorted), compare_rects);
+
+    // Every insertion adds at most one node to the skyline.
+    skyline sky = { .nodes = malloc((count + 2) * sizeof(*sky.nodes)) };
+    if (sky.nodes == NULL)
+    {
+        free(sorted);
+        return -1;
+    }
+
+    int ret = -1;
+    uint32_t w = 1;
+    uint32_t h = 1;
+    while (w < min_width)
+        w *= 2;
+    while (h < min_height)
+        h *= 2;
+    while ((uint64_t)w * h < area)
+    {
+        if (h < w)
+            h *= 2;
+        else
+            w *= 2;
+    }
+    while (w <= max_size && h <= max_size)
+    {
+        if (pack_size(&sky, sorted, count, padding, w, h) == 0)
+        {
+            *width = w;
+            *height = h;
+            ret = 0;
+            break;
+        }
+        if (h < w)
+            h *= 2;
+        else
+            w *= 2;
+    }
+
+    free(sky.nodes);
+    free(sorted);
+    return ret;
+}
+
+static int compare_glyphs(void const *a, void const *b)
+{
+    uint32_t const ca = ((atlas_glyph const *)a)->code;
+    uint32_t const cb = ((atlas_glyph const *)b)->code;
+    return (ca > cb) - (ca < cb);
+}
+
+void atlas_metrics_sort(atlas_metrics *metrics)
+{
+    if (metrics == NULL || metrics->glyphs == NULL)
+    {
+        return;
+    }
+    qsort(metrics->glyphs, metrics->count, sizeof(*metrics->glyphs), compare_glyphs);
+}
+
+atlas_glyph const *atlas_metrics_find(atlas_metrics const *metrics, uint32_t code)
+{
+    if (metrics == NULL || metrics->glyphs == NULL)
+    {
+        return NULL;
+    }
+    atlas_glyph const key = { .code = code };
+    return bsearch(&key, metrics->glyphs, metrics->count, sizeof(*metrics->glyphs), compare_glyphs);
+}
+
+int atlas_metrics_write(atlas_metrics const *metrics, char const *file)
+{
+    if (metrics == NULL || file == NULL || metrics->count > UINT32_MAX || (metrics->glyphs == NULL && metrics->count > 0))
+    {
+        return -1;
+    }
+    atlas_file_header const header = {
+        .magic = ATLAS_MAGIC,
+        .version = ATLAS_VERSION,
+        .width = metrics->width,
+        .height = metrics->height,
+        .line_height = metrics->line_height,
+        .ascent = metrics->ascent,
+        .count = (uint32_t)metrics->count,
+        .sdf_spread = metrics->sdf_spread,
+    };
+    FILE *file_handle = fopen(file, "wb");
+    if (file_handle == NULL)
+    {
+        return -1;
+    }
+    int ret = -1;
+    if (fwrite(&header, sizeof(header), 1, file_handle) == 1
+        && fwrite(metrics->glyphs, sizeof(*metrics->glyphs), metrics->count, file_handle) == metrics->count)
+    {
+        ret = 0;
+    }
+    if (fclose(file_handle) != 0)
+    {
+        ret = -1;
+    }
+    return ret;
+}
+
+int atlas_metrics_read(char const *file, atlas_metrics *metrics)
+{
+    if (file == NULL || metrics == NULL)
+    {
+        return -1;
+    }
+    memset(metrics, 0, sizeof(*metrics));
+
+    FILE *file_handle = fopen(file, "rb");
+    if (file_handle == NULL)
+    {
+        return -1;
+    }
+
+    int ret = -1;
+    atlas_file_header header;
+    if (fread(&header, sizeof(header), 1, file_handle) != 1 || header.magic != ATLAS_MAGIC || header.version != ATLAS_VERSION)
+    {
+        goto out_fclose_file_handle;
+    }
+    atlas_glyph *glyphs = calloc(header.count + (size_t)1, sizeof(*glyphs));
+    if (glyphs == NULL)
+    {
+        goto out_fclose_file_handle;
+    }
+    if (fread(glyphs, sizeof(*glyphs), header.count, file_handle) != header.count)
+    {
+        free(glyphs);
+        goto out_fclose_file_handle;
+    }
+    for (uint32_t i = 0; i < header.count; ++i)
+    {
+        atlas_glyph const *g = &glyphs[i];
+        if ((i > 0 && g->code <= glyphs[i - 1].code) || (uint32_t)g->x + g->width > header.width
+            || (uint32_t)g->y + g->height > header.height)
+        {
+            free(glyphs);
+            goto out_fclose_file_handle;
+        }
+    }
+
+    metrics->width = header.width;
+    metrics->height = header.height;
+    metrics->line_height = header.line_height;
+    metrics->ascent = header.ascent;
+    metrics->sdf_spread = header.sdf_spread;
+    metrics->count = header.count;
+    metrics->glyphs = glyphs;
+    ret = 0;
+out_fclose_file_handle:
+    fclose(file_handle);
+    return ret;
+}
+
+void atlas_metrics_free(atlas_metrics *metrics)
+{
+    if (metrics == NULL)
+    {
+        return;
+    }
+    free(metrics->glyphs);
+    memset(metrics, 0, sizeof(*metrics));
+}
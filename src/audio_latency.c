@@ -0,0 +1,87 @@
+#include "audio_latency.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// Clean windows before a buffer size counts as settled.
+static uint32_t const SETTLE_WINDOWS = 3;
+
+/// Clean windows before trying a smaller buffer, doubled after each failure.
+static uint32_t const RETRY_WINDOWS = 30;
+
+/// Failures after which the retry wait stops doubling.
+static uint32_t const MAX_BACKOFF = 5;
+
+/// First load bucket counted as busy: 80% of the deadline.
+static size_t const BUSY_BUCKET = 8;
+
+/// Busy callbacks allowed per window, as a fraction: 1 in 100.
+static uint32_t const BUSY_RATIO = 100;
+
+/// Switches to a new buffer size, whose device timing starts from zero.
+static void resize(struct audio_latency *latency, uint32_t frames)
+{
+    latency->frames = frames;
+    latency->clean = 0;
+    latency->warm = 0;
+    latency->callbacks = 0;
+    latency->trouble = 0;
+    latency->busy = 0;
+}
+
+void audio_latency_init(struct audio_latency *latency, uint32_t min_frames, uint32_t max_frames)
+{
+    latency->min_frames = min_frames;
+    latency->max_frames = (max_frames < min_frames) ? min_frames : max_frames;
+    latency->failures = 0;
+    resize(latency, min_frames);
+}
+
+enum audio_latency_event audio_latency_update(struct audio_latency *latency, struct audio_timing_stats const *stats)
+{
+    // A window is one second of audio.
+    uint32_t const window = (stats->deadline_us >= 1e6) ? 1 : (uint32_t)(1e6 / stats->deadline_us);
+    if (stats->callbacks - latency->callbacks < window)
+        return AUDIO_LATENCY_STEADY;
+
+    uint32_t busy = 0;
+    for (size_t i = BUSY_BUCKET; i < AUDIO_TIMING_BUCKETS; ++i)
+        busy += stats->load[i];
+    uint32_t const trouble = stats->overruns + stats->gaps;
+    uint32_t const callbacks = stats->callbacks - latency->callbacks;
+    uint32_t const new_trouble = trouble - latency->trouble;
+    uint32_t const new_busy = busy - latency->busy;
+    latency->callbacks = stats->callbacks;
+    latency->trouble = trouble;
+    latency->busy = busy;
+
+    // The first callbacks of a device are often late while it starts.
+    if (!latency->warm)
+    {
+        latency->warm = 1;
+        return AUDIO_LATENCY_STEADY;
+    }
+
+    if (new_trouble > 0 || new_busy * BUSY_RATIO > callbacks)
+    {
+        if (latency->frames >= latency->max_frames)
+            return AUDIO_LATENCY_STEADY;
+        if (latency->failures < MAX_BACKOFF)
+            ++latency->failures;
+        resize(latency, latency->frames * 2);
+        return AUDIO_LATENCY_RESIZE;
+    }
+
+    ++latency->clean;
+    if (latency->frames > latency->min_frames && latency->clean >= RETRY_WINDOWS << latency->failures)
+    {
+        resize(latency, latency->frames / 2);
+        return AUDIO_LATENCY_RESIZE;
+    }
+    return (latency->clean == SETTLE_WINDOWS) ? AUDIO_LATENCY_SETTLED : AUDIO_LATENCY_STEADY;
+}
+
+uint32_t audio_latency_frames(struct audio_latency const *latency)
+{
+    return latency->frames;
+}
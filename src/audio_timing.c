@@ -0,0 +1,136 @@
+#include "audio_timing.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/// Intervals longer than this many deadlines count as gaps.
+static double const GAP_DEADLINES = 1.5;
+
+/// Percent of the deadline per load bucket.
+static double const LOAD_STEP = 10.0;
+
+struct audio_timing
+{
+    double us_per_tick;
+    double deadline_us;
+    uint64_t last_begin; // Audio thread only
+    int started;         // Audio thread only
+    _Atomic uint32_t callbacks;
+    _Atomic uint32_t overruns;
+    _Atomic uint32_t gaps;
+    _Atomic uint32_t max_duration_us;
+    _Atomic uint32_t max_interval_us;
+    _Atomic uint32_t duration[AUDIO_TIMING_BUCKETS];
+    _Atomic uint32_t interval[AUDIO_TIMING_BUCKETS];
+    _Atomic uint32_t load[AUDIO_TIMING_BUCKETS];
+};
+
+struct audio_timing *audio_timing_create(int sample_rate, uint32_t frames, uint64_t counter_frequency)
+{
+    if (sample_rate <= 0 || frames == 0 || counter_frequency == 0)
+        return NULL;
+
+    struct audio_timing *timing = malloc(sizeof(*timing));
+    if (timing == NULL)
+        return NULL;
+
+    timing->us_per_tick = 1e6 / (double)counter_frequency;
+    timing->deadline_us = 1e6 * (double)frames / (double)sample_rate;
+    timing->last_begin = 0;
+    timing->started = 0;
+    atomic_init(&timing->callbacks, 0);
+    atomic_init(&timing->overruns, 0);
+    atomic_init(&timing->gaps, 0);
+    atomic_init(&timing->max_duration_us, 0);
+    atomic_init(&timing->max_interval_us, 0);
+    for (size_t i = 0; i < AUDIO_TIMING_BUCKETS; ++i)
+    {
+        atomic_init(&timing->duration[i], 0);
+        atomic_init(&timing->interval[i], 0);
+        atomic_init(&timing->load[i], 0);
+    }
+    return timing;
+}
+
+void audio_timing_destroy(struct audio_timing *timing)
+{
+    free(timing);
+}
+
+/// Increments a counter that only the audio thread writes.
+static void increment(_Atomic uint32_t *counter)
+{
+    atomic_fetch_add_explicit(counter, 1, memory_order_relaxed);
+}
+
+/// Raises a maximum that only the audio thread writes.
+static void raise_max(_Atomic uint32_t *max, uint32_t value)
+{
+    if (value > atomic_load_explicit(max, memory_order_relaxed))
+        atomic_store_explicit(max, value, memory_order_relaxed);
+}
+
+static uint32_t to_us(double us)
+{
+    return (us >= (double)UINT32_MAX) ? UINT32_MAX : (uint32_t)us;
+}
+
+/// Returns the histogram bucket of a time: floor(log2(us)), clamped.
+static size_t time_bucket(uint32_t us)
+{
+    size_t bucket = 0;
+    while (us >= 2 && bucket < AUDIO_TIMING_BUCKETS - 1)
+    {
+        us >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+void audio_timing_record(struct audio_timing *timing, uint64_t begin, uint64_t end)
+{
+    double const duration = (double)(end - begin) * timing->us_per_tick;
+    uint32_t const duration_us = to_us(duration);
+    increment(&timing->duration[time_bucket(duration_us)]);
+    raise_max(&timing->max_duration_us, duration_us);
+
+    double const load = 100.0 * duration / timing->deadline_us;
+    size_t const load_bucket = (load >= LOAD_STEP * (AUDIO_TIMING_BUCKETS - 1)) ? AUDIO_TIMING_BUCKETS - 1
+                                                                                 : (size_t)(load / LOAD_STEP);
+    increment(&timing->load[load_bucket]);
+    if (duration > timing->deadline_us)
+        increment(&timing->overruns);
+
+    if (timing->started)
+    {
+        double const interval = (double)(begin - timing->last_begin) * timing->us_per_tick;
+        uint32_t const interval_us = to_us(interval);
+        increment(&timing->interval[time_bucket(interval_us)]);
+        raise_max(&timing->max_interval_us, interval_us);
+        if (interval > GAP_DEADLINES * timing->deadline_us)
+            increment(&timing->gaps);
+    }
+    timing->last_begin = begin;
+    timing->started = 1;
+
+    // Released last, so a reader that sees a callback counted also sees its buckets.
+    atomic_fetch_add_explicit(&timing->callbacks, 1, memory_order_release);
+}
+
+void audio_timing_read(struct audio_timing const *timing, struct audio_timing_stats *stats)
+{
+    stats->deadline_us = timing->deadline_us;
+    stats->callbacks = atomic_load_explicit(&timing->callbacks, memory_order_acquire);
+    stats->overruns = atomic_load_explicit(&timing->overruns, memory_order_relaxed);
+    stats->gaps = atomic_load_explicit(&timing->gaps, memory_order_relaxed);
+    stats->max_duration_us = atomic_load_explicit(&timing->max_duration_us, memory_order_relaxed);
+    stats->max_interval_us = atomic_load_explicit(&timing->max_interval_us, memory_order_relaxed);
+    for (size_t i = 0; i < AUDIO_TIMING_BUCKETS; ++i)
+    {
+        stats->duration.counts[i] = atomic_load_explicit(&timing->duration[i], memory_order_relaxed);
+        stats->interval.counts[i] = atomic_load_explicit(&timing->interval[i], memory_order_relaxed);
+        stats->load[i] = atomic_load_explicit(&timing->load[i], memory_order_relaxed);
+    }
+}
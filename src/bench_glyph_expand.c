@@ -0,0 +1,147 @@
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "bmp.h"
+#include "bmp_convert.h"
+#include "prelude_stdlib.h"
+
+#define eprintf(...) (void)fprintf(stderr, __VA_ARGS__)
+
+#define GET_BIT(c, pos) (((pos) >= CHAR_BIT) ? 0 : (((c) >> (CHAR_BIT + ~(pos)) & 1)))
+
+enum
+{
+    GLYPHS = 4096,
+    ROWS = 20,
+    ROUNDS = 20,
+};
+
+static size_t const WIDTHS[] = { 10, 24, 64 };
+
+static bmp_pixel32 const WHITE = { 0xFF, 0xFF, 0xFF, 0x00 };
+static bmp_pixel32 const BLACK = { 0x00, 0x00, 0x00, 0xFF };
+
+static uint64_t perf_freq = 0;
+
+/// A set of 1-bit glyph bitmaps with the same size.
+struct glyphs
+{
+    uint8_t *bits;       // Rows of every glyph, pitch bytes each
+    size_t width;        // Glyph width (pixels)
+    size_t pitch;        // Bytes per row
+    bmp_pixel32 *pixels; // Expanded glyphs
+    char *image;         // One byte per pixel, used by the bitwise path
+};
+
+/// Expands one bit at a time into a byte per pixel, then converts each byte to a pixel.
+static void expand_bitwise(struct glyphs *g)
+{
+    size_t const glyph_size = g->width * ROWS;
+    for (size_t n = 0; n < GLYPHS; ++n)
+    {
+        uint8_t const *buffer = &g->bits[n * g->pitch * ROWS];
+        for (size_t y = 0, p = 0; y < ROWS; ++y, p += g->pitch)
+        {
+            for (size_t i = 0; i < g->pitch; ++i)
+            {
+                for (size_t j = 0, x; j < CHAR_BIT; ++j)
+                {
+                    x = j + (i * CHAR_BIT);
+                    if (x >= g->width)
+                        continue;
+
+                    g->image[(y * g->width) + x] = GET_BIT(buffer[p + i], j);
+                }
+            }
+        }
+        bmp_pixel32 *const out = &g->pixels[n * glyph_size];
+        for (size_t i = 0; i < glyph_size; ++i)
+            out[i] = g->image[i] ? BLACK : WHITE;
+    }
+}
+
+/// Expands each byte to eight pixels with one table lookup.
+static void expand_table(struct glyphs *g, bmp_convert_mono_table const *table)
+{
+    size_t const glyph_size = g->width * ROWS;
+    for (size_t n = 0; n < GLYPHS; ++n)
+    {
+        uint8_t const *buffer = &g->bits[n * g->pitch * ROWS];
+        bmp_pixel32 *const out = &g->pixels[n * glyph_size];
+        for (size_t y = 0; y < ROWS; ++y)
+            bmp_convert_expand_mono(&out[y * g->width], &buffer[y * g->pitch], g->width, table);
+    }
+}
+
+static double seconds_since(uint64_t begin)
+{
+    return (double)(SDL_GetPerformanceCounter() - begin) / (double)perf_freq;
+}
+
+static void report(char const *name, size_t width, double seconds)
+{
+    double const pixels = (double)GLYPHS * ROWS * (double)width * ROUNDS;
+    printf("%-8s %6zu %14.1f %12.1f\n", name, width, pixels / seconds / 1e6, seconds * 1e9 / ((double)GLYPHS * ROUNDS));
+}
+
+static int bench(size_t width, bmp_convert_mono_table const *table)
+{
+    struct glyphs g = { .width = width, .pitch = (width + 7) / 8 };
+    size_t const pixels_size = GLYPHS * ROWS * width;
+    g.bits = ecalloc(GLYPHS * ROWS * g.pitch, sizeof(*g.bits));
+    g.pixels = ecalloc(pixels_size, sizeof(*g.pixels));
+    g.image = ecalloc(width * ROWS, sizeof(*g.image));
+    bmp_pixel32 *reference = ecalloc(pixels_size, sizeof(*reference));
+
+    uint32_t state = 1;
+    for (size_t i = 0; i < GLYPHS * ROWS * g.pitch; ++i)
+    {
+        state = (state * 1103515245) + 12345;
+        g.bits[i] = (uint8_t)(state >> 16);
+    }
+
+    uint64_t begin = SDL_GetPerformanceCounter();
+    for (int r = 0; r < ROUNDS; ++r)
+        expand_bitwise(&g);
+    report("bitwise", width, seconds_since(begin));
+    memcpy(reference, g.pixels, pixels_size * sizeof(*reference));
+
+    begin = SDL_GetPerformanceCounter();
+    for (int r = 0; r < ROUNDS; ++r)
+        expand_table(&g, table);
+    report("table", width, seconds_since(begin));
+
+    int const ret = (memcmp(reference, g.pixels, pixels_size * sizeof(*reference)) == 0) ? 0 : -1;
+    if (ret != 0)
+        eprintf("table: output differs from bitwise (width = %zu)\n", width);
+
+    free(reference);
+    free(g.image);
+    free(g.pixels);
+    free(g.bits);
+    return ret;
+}
+
+int main(__attribute__((unused)) int argc, __attribute__((unused)) char *argv[])
+{
+    perf_freq = SDL_GetPerformanceFrequency();
+
+    static bmp_convert_mono_table table;
+    bmp_convert_mono_table_init(&table, WHITE, BLACK);
+
+    printf("%-8s %6s %14s %12s\n", "kernel", "width", "Mpixels/sec", "ns/glyph");
+
+    size_t const num_widths = sizeof(WIDTHS) / sizeof(WIDTHS[0]);
+    for (size_t w = 0; w < num_widths; ++w)
+    {
+        if (bench(WIDTHS[w], &table) != 0)
+            return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,202 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "message_queue.h"
+#include "prelude_stdlib.h"
+
+#define eprintf(...) (void)fprintf(stderr, __VA_ARGS__)
+
+enum
+{
+    MESSAGES = 200000, // Messages per run, split across producers
+};
+
+static uint32_t const CAPACITIES[] = { 4, 64, 1024 };
+static int const THREADS[] = { 1, 2, 4 };
+
+static uint64_t perf_freq = 0;
+
+struct run
+{
+    struct message_queue *queue;
+    struct message_spsc_queue *spsc_queue;
+    int messages;      // Messages per producer
+    uint64_t *samples; // Enqueue-to-dequeue latency in ticks, one per message received
+    size_t count;      // Number of samples recorded
+};
+
+static int produce(void *data)
+{
+    struct run *r = data;
+    for (int i = 0; i < r->messages;)
+    {
+        struct message msg = { .tag = MSG_TAG_SOME, .value = (intptr_t)SDL_GetPerformanceCounter() };
+        int const rc = (r->spsc_queue != NULL)
+            ? message_spsc_queue_put(r->spsc_queue, &msg)
+            : message_queue_put(r->queue, &msg);
+        if (rc < 0)
+            return -1;
+
+        if (rc == 0)
+            ++i;
+    }
+    return 0;
+}
+
+static int consume(void *data)
+{
+    struct run *r = data;
+    struct message msg = { 0 };
+    for (;;)
+    {
+        int const rc = message_queue_get(r->queue, &msg);
+        if (rc == -MSGQ_FAILURE_CLOSED)
+            return 0;
+
+        if (rc < 0)
+            return -1;
+
+        r->samples[r->count++] = SDL_GetPerformanceCounter() - (uint64_t)msg.value;
+    }
+}
+
+static int consume_spsc(void *data)
+{
+    struct run *r = data;
+    struct message msg = { 0 };
+    while (r->count < (size_t)r->messages)
+    {
+        if (message_spsc_queue_get(r->spsc_queue, &msg) != 0)
+            return -1;
+
+        r->samples[r->count++] = SDL_GetPerformanceCounter() - (uint64_t)msg.value;
+    }
+    return 0;
+}
+
+static int compare_u64(void const *a, void const *b)
+{
+    uint64_t const x = *(uint64_t const *)a;
+    uint64_t const y = *(uint64_t const *)b;
+    return (x > y) - (x < y);
+}
+
+/// Returns the given percentile of sorted samples, in microseconds.
+static double percentile(uint64_t const *sorted, size_t n, double p)
+{
+    size_t const i = (size_t)(p * (double)(n - 1));
+    return ((double)sorted[i] * 1e6) / (double)perf_freq;
+}
+
+/// Runs producers and consumers against a queue and prints throughput and latency.
+///
+/// @param name The name of the queue variant.
+/// @param capacity The queue capacity.
+/// @param threads The number of producers and the number of consumers.
+/// @return 0 on success, -1 on failure.
+static int bench(char const *name, uint32_t capacity, int threads)
+{
+    int ret = -1;
+
+    int const spsc = strcmp(name, "spsc") == 0;
+    struct message_queue *queue = spsc ? NULL : message_queue_create(capacity);
+    struct message_spsc_queue *spsc_queue = spsc ? message_spsc_queue_create(capacity) : NULL;
+    if (queue == NULL && spsc_queue == NULL)
+        return -1;
+
+    int const messages = MESSAGES / threads;
+    size_t const total = (size_t)messages * (size_t)threads;
+    uint64_t *samples = ecalloc(total, sizeof(*samples));
+    struct run *producers = ecalloc((size_t)threads, sizeof(*producers));
+    struct run *consumers = ecalloc((size_t)threads, sizeof(*consumers));
+    SDL_Thread **producer_threads = ecalloc((size_t)threads, sizeof(*producer_threads));
+    SDL_Thread **consumer_threads = ecalloc((size_t)threads, sizeof(*consumer_threads));
+
+    uint64_t const begin = SDL_GetPerformanceCounter();
+    for (int i = 0; i < threads; ++i)
+    {
+        // Any consumer may receive every message
+        consumers[i] = (struct run){ queue, spsc_queue, messages, ecalloc(total, sizeof(*samples)), 0 };
+        producers[i] = (struct run){ queue, spsc_queue, messages, NULL, 0 };
+        consumer_threads[i] = SDL_CreateThread(spsc ? consume_spsc : consume, "consumer", &consumers[i]);
+        producer_threads[i] = SDL_CreateThread(produce, "producer", &producers[i]);
+        if (consumer_threads[i] == NULL || producer_threads[i] == NULL)
+        {
+            eprintf("SDL_CreateThread failed: %s\n", SDL_GetError());
+            exit(EXIT_FAILURE);
+        }
+    }
+    int ok = 1;
+    int status = 0;
+    for (int i = 0; i < threads; ++i)
+    {
+        SDL_WaitThread(producer_threads[i], &status);
+        ok = ok && (status == 0);
+    }
+    message_queue_close(queue);
+    size_t count = 0;
+    for (int i = 0; i < threads; ++i)
+    {
+        SDL_WaitThread(consumer_threads[i], &status);
+        ok = ok && (status == 0);
+        if (count + consumers[i].count <= total)
+            memcpy(&samples[count], consumers[i].samples, consumers[i].count * sizeof(*samples));
+
+        count += consumers[i].count;
+        free(consumers[i].samples);
+    }
+    uint64_t const end = SDL_GetPerformanceCounter();
+
+    if (!ok || count != total)
+    {
+        eprintf("%s: lost messages (%zu of %zu)\n", name, count, total);
+        goto out_free;
+    }
+
+    qsort(samples, count, sizeof(*samples), compare_u64);
+    double const seconds = (double)(end - begin) / (double)perf_freq;
+    printf("%-6s %8u %4dx%-4d %14.0f %10.2f %10.2f %10.2f\n",
+           name, capacity, threads, threads,
+           (double)count / seconds,
+           percentile(samples, count, 0.50),
+           percentile(samples, count, 0.99),
+           percentile(samples, count, 0.999));
+
+    ret = 0;
+out_free:
+    free(consumer_threads);
+    free(producer_threads);
+    free(consumers);
+    free(producers);
+    free(samples);
+    message_spsc_queue_destroy(spsc_queue);
+    message_queue_destroy(queue);
+    return ret;
+}
+
+int main(__attribute__((unused)) int argc, __attribute__((unused)) char *argv[])
+{
+    perf_freq = SDL_GetPerformanceFrequency();
+
+    printf("%-6s %8s %9s %14s %10s %10s %10s\n", "queue", "capacity", "threads", "msgs/sec", "p50 (us)", "p99 (us)", "p999 (us)");
+
+    size_t const num_capacities = sizeof(CAPACITIES) / sizeof(CAPACITIES[0]);
+    size_t const num_threads = sizeof(THREADS) / sizeof(THREADS[0]);
+    for (size_t c = 0; c < num_capacities; ++c)
+    {
+        if (bench("spsc", CAPACITIES[c], 1) != 0)
+            return EXIT_FAILURE;
+
+        for (size_t t = 0; t < num_threads; ++t)
+        {
+            if (bench("mpmc", CAPACITIES[c], THREADS[t]) != 0)
+                return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <SDL.h>
+
+#include "mixer.h"
+#include "prelude_stdlib.h"
+
+#define eprintf(...) (void)fprintf(stderr, __VA_ARGS__)
+
+enum
+{
+    CHANNELS = 2,
+    SAMPLE_RATE = 48000,
+    BUFFER_SIZE = 256,
+    SAMPLE_FRAMES = 4800,
+    SECONDS = 5, // Audio mixed per voice count
+};
+
+static uint32_t const VOICE_COUNTS[] = { 1, 16, 64, 256 };
+
+static uint64_t perf_freq = 0;
+
+static double seconds_since(uint64_t begin)
+{
+    return (double)(SDL_GetPerformanceCounter() - begin) / (double)perf_freq;
+}
+
+/// Mixes a few seconds of audio from half tones and half looping samples.
+static int bench(uint32_t voices, float const *samples)
+{
+    struct mixer *mixer = mixer_create(SAMPLE_RATE, voices, voices);
+    if (mixer == NULL)
+    {
+        eprintf("mixer_create failed\n");
+        return -1;
+    }
+    for (uint32_t i = 0; i < voices; ++i)
+    {
+        uint32_t voice = 0;
+        int const rc = (i % 2 == 0) ? mixer_play_tone(mixer, 110.0 * (i + 1), 1.0f / (float)voices, &voice)
+                                    : mixer_play_samples(mixer, samples, SAMPLE_FRAMES, 1.0f / (float)voices, 1, &voice);
+        if (rc != 0)
+        {
+            eprintf("mixer_play failed\n");
+            mixer_destroy(mixer);
+            return -1;
+        }
+    }
+
+    static float out[BUFFER_SIZE * CHANNELS];
+    size_t const buffers = (SAMPLE_RATE * SECONDS) / BUFFER_SIZE;
+    uint64_t const begin = SDL_GetPerformanceCounter();
+    for (size_t b = 0; b < buffers; ++b)
+        mixer_mix(mixer, out, BUFFER_SIZE);
+    double const seconds = seconds_since(begin);
+
+    // The deadline of one callback is the time it plays for.
+    double const ns = seconds * 1e9 / (double)buffers;
+    double const deadline = 1e9 * BUFFER_SIZE / SAMPLE_RATE;
+    printf("%6u %14.1f %14.1f %10.2f\n", voices, ns, ns / voices, 100.0 * ns / deadline);
+    int const ret = (mixer_active_voices(mixer) == voices) ? 0 : -1;
+    mixer_destroy(mixer);
+    return ret;
+}
+
+int main(__attribute__((unused)) int argc, __attribute__((unused)) char *argv[])
+{
+    perf_freq = SDL_GetPerformanceFrequency();
+
+    float *const samples = ecalloc(SAMPLE_FRAMES * CHANNELS, sizeof(*samples));
+    for (size_t i = 0; i < SAMPLE_FRAMES * CHANNELS; ++i)
+        samples[i] = (float)(i % 97) / 97.0f;
+
+    printf("%6s %14s %14s %10s\n", "voices", "ns/callback", "ns/voice", "% deadline");
+
+    int ret = EXIT_SUCCESS;
+    size_t const num_counts = sizeof(VOICE_COUNTS) / sizeof(VOICE_COUNTS[0]);
+    for (size_t c = 0; c < num_counts && ret == EXIT_SUCCESS; ++c)
+    {
+        if (bench(VOICE_COUNTS[c], samples) != 0)
+            ret = EXIT_FAILURE;
+    }
+    free(samples);
+    return ret;
+}
@@ -0,0 +1,124 @@
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <SDL.h>
+
+#include "cpu_isa.h"
+#include "prelude_stdlib.h"
+#include "synth.h"
+
+#define eprintf(...) (void)fprintf(stderr, __VA_ARGS__)
+
+enum
+{
+    CHANNELS = 2,
+    SAMPLE_RATE = 48000,
+    SECONDS = 20, // Audio produced per buffer size and kernel
+};
+
+static size_t const BUFFER_SIZES[] = { 128, 256, 2048 };
+
+static double const FREQUENCY = 440.0;
+static double const VOLUME = 0.25;
+static double const MAX_ERROR = 1e-6;
+
+static uint64_t perf_freq = 0;
+
+/// The sine callback as it was: a libm call per sample, at a time computed from the buffer count.
+static void sine_libm(float *dst, size_t buffer_size, uint64_t elapsed)
+{
+    double const sample_rate = (double)SAMPLE_RATE;
+    uint64_t const offset = elapsed * buffer_size;
+    for (uint64_t i = 0; i < buffer_size; ++i)
+    {
+        double const time = (double)(offset + i) / sample_rate;
+        double const x = 2.0 * M_PI * time * FREQUENCY;
+        double const y = VOLUME * sin(x);
+        dst[(CHANNELS * i) + 0] = (float)y;
+        dst[(CHANNELS * i) + 1] = (float)y;
+    }
+}
+
+static double seconds_since(uint64_t begin)
+{
+    return (double)(SDL_GetPerformanceCounter() - begin) / (double)perf_freq;
+}
+
+static void report(char const *name, size_t buffer_size, size_t buffers, double seconds, double error)
+{
+    double const samples = (double)buffers * (double)buffer_size;
+    printf("%-8s %6zu %14.1f %14.1f %10.2e\n", name, buffer_size, samples / seconds / 1e6, seconds * 1e9 / (double)buffers,
+           error);
+}
+
+static int bench(size_t buffer_size)
+{
+    size_t const buffers = (SAMPLE_RATE * SECONDS) / buffer_size;
+    float *const out = ecalloc(buffer_size * CHANNELS, sizeof(*out));
+
+    uint64_t begin = SDL_GetPerformanceCounter();
+    for (size_t b = 0; b < buffers; ++b)
+        sine_libm(out, buffer_size, b);
+    report("libm", buffer_size, buffers, seconds_since(begin), 0.0);
+
+    int ret = 0;
+    for (int isa = CPU_ISA_SCALAR; isa < CPU_ISA_MAX; ++isa)
+    {
+        synth_kernels const *kernels = synth_get_kernels((cpu_isa)isa);
+        if (kernels == NULL)
+            continue;
+
+        synth_osc osc = { .gain = (float)VOLUME };
+        synth_osc_set_frequency(&osc, FREQUENCY, SAMPLE_RATE);
+        begin = SDL_GetPerformanceCounter();
+        for (size_t b = 0; b < buffers; ++b)
+            kernels->sine_stereo(out, buffer_size, &osc);
+        double const seconds = seconds_since(begin);
+
+        // Compare one more run against libm at the same phases, outside the
+        // timing.  The increment is rounded to 2^-32 of a cycle, so the tone is
+        // off by up to 6 microhertz at 48 kHz, which is not counted here.
+        double error = 0.0;
+        osc.phase = 0;
+        for (size_t b = 0; b < buffers; ++b)
+        {
+            uint32_t const phase = osc.phase;
+            kernels->sine_stereo(out, buffer_size, &osc);
+            for (size_t i = 0; i < buffer_size; ++i)
+            {
+                double const x = 2.0 * M_PI * (double)(uint32_t)(phase + ((uint32_t)i * osc.increment)) / 4294967296.0;
+                double const y = VOLUME * sin(x);
+                error = fmax(error, fabs((double)out[CHANNELS * i] - y));
+                error = fmax(error, fabs((double)out[(CHANNELS * i) + 1] - y));
+            }
+        }
+        report(cpu_isa_name((cpu_isa)isa), buffer_size, buffers, seconds, error);
+
+        if (error > MAX_ERROR)
+        {
+            eprintf("%s: error %g exceeds %g (buffer size = %zu)\n", cpu_isa_name((cpu_isa)isa), error, MAX_ERROR, buffer_size);
+            ret = -1;
+        }
+    }
+
+    free(out);
+    return ret;
+}
+
+int main(__attribute__((unused)) int argc, __attribute__((unused)) char *argv[])
+{
+    perf_freq = SDL_GetPerformanceFrequency();
+
+    printf("%-8s %6s %14s %14s %10s\n", "kernel", "frames", "Msamples/sec", "ns/callback", "max error");
+
+    size_t const num_sizes = sizeof(BUFFER_SIZES) / sizeof(BUFFER_SIZES[0]);
+    for (size_t s = 0; s < num_sizes; ++s)
+    {
+        if (bench(BUFFER_SIZES[s]) != 0)
+            return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
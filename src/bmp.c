@@ -1,27 +1,106 @@
 #include "bmp.h"
+#include "bmp_convert.h"
+#include "macro.h"
 
-#include <assert.h>
-#include <math.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
 
 static uint16_t const FILE_TYPE = 0x4D42;
-static uint32_t const BI_BITFIELDS = 0x0003;
 static uint32_t const LCS_WINDOWS_COLOR_SPACE = 0x57696E20;
 
 static size_t const V4_DATA_OFFSET = sizeof(bmp_file_header) + sizeof(bmp_v4_header);
 
-size_t bmp_row_size(double const bits_per_pixel, double const width)
+enum
+{
+    ROW_ALIGNMENT = 4,
+};
+
+// Row sizes of the supported depths, which bmp_row_size() computes without the
+// generic bit arithmetic.
+STATIC_ASSERT(BMP_ROW_SIZE(1, 1) == 4);
+STATIC_ASSERT(BMP_ROW_SIZE(1, 32) == 4);
+STATIC_ASSERT(BMP_ROW_SIZE(1, 33) == 8);
+STATIC_ASSERT(BMP_ROW_SIZE(4, 8) == 4);
+STATIC_ASSERT(BMP_ROW_SIZE(4, 9) == 8);
+STATIC_ASSERT(BMP_ROW_SIZE(8, 4) == 4);
+STATIC_ASSERT(BMP_ROW_SIZE(8, 5) == 8);
+STATIC_ASSERT(BMP_ROW_SIZE(16, 2) == 4);
+STATIC_ASSERT(BMP_ROW_SIZE(16, 3) == 8);
+STATIC_ASSERT(BMP_ROW_SIZE(24, 1) == 4);
+STATIC_ASSERT(BMP_ROW_SIZE(24, 4) == 12);
+STATIC_ASSERT(BMP_ROW_SIZE(24, 5) == 16);
+STATIC_ASSERT(BMP_ROW_SIZE(32, 1) == 4);
+STATIC_ASSERT(BMP_ROW_SIZE(32, 3) == 12);
+
+/// Rounds a number of bytes up to the row alignment, or returns 0 on overflow.
+static inline size_t row_align(size_t bytes)
+{
+    return (bytes > SIZE_MAX - (ROW_ALIGNMENT - 1)) ? 0 : (bytes + (ROW_ALIGNMENT - 1)) & ~(size_t)(ROW_ALIGNMENT - 1);
+}
+
+/// Computes the row size of a depth below 8 bits from whole 32-bit groups of pixels.
+static inline size_t row_size_packed(size_t width, size_t pixels_per_group)
+{
+    return ((width / pixels_per_group) + ((width % pixels_per_group) != 0)) * ROW_ALIGNMENT;
+}
+
+/// Computes the row size of a whole-byte depth, or returns 0 on overflow.
+static inline size_t row_size_bytes(size_t width, size_t bytes_per_pixel)
+{
+    return (width > SIZE_MAX / bytes_per_pixel) ? 0 : row_align(width * bytes_per_pixel);
+}
+
+size_t bmp_row_size(uint16_t const bits_per_pixel, size_t const width)
 {
-    assert(bits_per_pixel > 0);
-    assert(width > 0);
-    double const pixel_bits = bits_per_pixel * width;
-    double const dword_bits = 32;
-    double const dword_bytes = 4;
-    double const ret = ceil(pixel_bits / dword_bits) * dword_bytes;
-    assert(ret > 0);
-    return (size_t)ret;
+    switch (bits_per_pixel)
+    {
+    case 1:
+        return row_size_packed(width, 32);
+    case 4:
+        return row_size_packed(width, 8);
+    case 8:
+        return row_align(width);
+    case 16:
+        return row_size_bytes(width, 2);
+    case 24:
+        return row_size_bytes(width, 3);
+    case 32:
+        return row_size_bytes(width, 4);
+    default:
+        if (bits_per_pixel == 0 || width > (SIZE_MAX - 31) / bits_per_pixel)
+        {
+            return 0;
+        }
+        return BMP_ROW_SIZE(bits_per_pixel, width);
+    }
+}
+
+/// Gets the number of bytes between the current position and the end of a file.
+static int remaining_size(FILE *file_handle, size_t *remaining)
+{
+    long const pos = ftell(file_handle);
+    if (pos < 0 || fseek(file_handle, 0, SEEK_END) != 0)
+    {
+        return -1;
+    }
+    long const end = ftell(file_handle);
+    if (end < pos || fseek(file_handle, pos, SEEK_SET) != 0)
+    {
+        return -1;
+    }
+    *remaining = (size_t)(end - pos);
+    return 0;
 }
 
 int bmp_read(char const *file, bmp_file_header *file_header, bmp_info_header *info_header, char **image)
@@ -71,6 +150,11 @@ int bmp_read(char const *file, bmp_file_header *file_header, bmp_info_header *in
     }
 
     uint32_t const image_size = info_header->image_size;
+    size_t remaining = 0;
+    if (remaining_size(file_handle, &remaining) != 0 || image_size > remaining)
+    {
+        goto out_fclose_file_handle;
+    }
     *image = calloc(image_size, sizeof(**image));
     if (*image == NULL)
     {
@@ -138,6 +222,11 @@ int bmp_v4_read(char const *file, bmp_file_header *file_header, bmp_v4_header *v
     }
 
     uint32_t const image_size = v4_header->image_size;
+    size_t remaining = 0;
+    if (remaining_size(file_handle, &remaining) != 0 || image_size > remaining)
+    {
+        goto out_fclose_file_handle;
+    }
     *image = calloc(image_size, sizeof(**image));
     if (*image == NULL)
     {
@@ -158,45 +247,664 @@ out_fclose_file_handle:
     return ret;
 }
 
-int bmp_v4_write(bmp_pixel32 const *buffer, size_t width, size_t height, char const *file)
+#ifdef _WIN32
+static void *map_file(char const *file, size_t *size)
 {
-    if (buffer == NULL || file == NULL)
+    HANDLE file_handle = CreateFileA(file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file_handle == INVALID_HANDLE_VALUE)
+    {
+        return NULL;
+    }
+    LARGE_INTEGER file_size;
+    if (GetFileSizeEx(file_handle, &file_size) == 0 || file_size.QuadPart <= 0)
+    {
+        CloseHandle(file_handle);
+        return NULL;
+    }
+    HANDLE mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file_handle);
+    if (mapping_handle == NULL)
+    {
+        return NULL;
+    }
+    void *base = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping_handle);
+    if (base == NULL)
+    {
+        return NULL;
+    }
+    *size = (size_t)file_size.QuadPart;
+    return base;
+}
+
+static void unmap_file(void *base, __attribute__((unused)) size_t size)
+{
+    UnmapViewOfFile(base);
+}
+#else
+static void *map_file(char const *file, size_t *size)
+{
+    int fd = open(file, O_RDONLY);
+    if (fd == -1)
+    {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        return NULL;
+    }
+    *size = (size_t)st.st_size;
+    return base;
+}
+
+static void unmap_file(void *base, size_t size)
+{
+    munmap(base, size);
+}
+#endif
+
+typedef struct bmp_core_header
+{
+    uint32_t size;           // DIB Header size (bytes)
+    uint16_t width;          // Image width (pixels)
+    uint16_t height;         // Image height (pixels)
+    uint16_t planes;         // Number of planes
+    uint16_t bits_per_pixel; // Bits per pixel
+} __attribute__((packed)) bmp_core_header;
+
+/// Checks that the set bits of a channel mask form a single run, as channel extraction assumes.
+static int bmp_mask_contiguous(uint32_t mask)
+{
+    if (mask == 0)
+    {
+        return 1;
+    }
+    uint32_t const run = mask >> __builtin_ctz(mask);
+    return (run & (run + 1)) == 0;
+}
+
+int bmp_get_layout(void const *data, size_t size, bmp_layout *layout)
+{
+    if (data == NULL || layout == NULL)
     {
         return -1;
     }
-    if (width > INT32_MAX || height > INT32_MAX)
+    unsigned char const *const base = data;
+    size_t const dib_offset = sizeof(bmp_file_header);
+    if (size < dib_offset + sizeof(uint32_t))
+    {
+        return -1;
+    }
+    bmp_file_header file_header;
+    memcpy(&file_header, base, sizeof(file_header));
+    if (file_header.file_type != FILE_TYPE)
     {
         return -1;
     }
 
-    size_t const image_size = (width * height) * sizeof(bmp_pixel32);
-    if (image_size > UINT32_MAX)
+    memset(layout, 0, sizeof(*layout));
+    memcpy(&layout->header_size, base + dib_offset, sizeof(layout->header_size));
+    switch (layout->header_size)
+    {
+    case BITMAPCOREHEADER:
+    case OS22XBITMAPHEADER:
+    case BITMAPINFOHEADER:
+    case BITMAPV2INFOHEADER:
+    case BITMAPV3INFOHEADER:
+    case BITMAPV4HEADER:
+    case BITMAPV5HEADER:
+        break;
+    default:
+        return -1;
+    }
+    if (layout->header_size > size - dib_offset)
     {
         return -1;
     }
 
-    size_t const file_size = V4_DATA_OFFSET + image_size;
-    if (file_size > UINT32_MAX)
+    uint16_t planes = 0;
+    if (layout->header_size == BITMAPCOREHEADER)
+    {
+        bmp_core_header core_header;
+        memcpy(&core_header, base + dib_offset, sizeof(core_header));
+        layout->width = core_header.width;
+        layout->height = core_header.height;
+        layout->top_down = 0;
+        planes = core_header.planes;
+        layout->bits_per_pixel = core_header.bits_per_pixel;
+        layout->compression = BI_RGB;
+        layout->palette_entry_size = sizeof(bmp_pixel24);
+    }
+    else
+    {
+        bmp_info_header info_header;
+        memcpy(&info_header, base + dib_offset, sizeof(info_header));
+        if (info_header.width <= 0 || info_header.height == INT32_MIN)
+        {
+            return -1;
+        }
+        layout->width = (size_t)info_header.width;
+        layout->height = (size_t)((info_header.height < 0) ? -info_header.height : info_header.height);
+        layout->top_down = info_header.height < 0;
+        planes = info_header.planes;
+        layout->bits_per_pixel = info_header.bits_per_pixel;
+        layout->compression = info_header.compression;
+        layout->palette_entry_size = sizeof(bmp_pixel32);
+        layout->palette_size = info_header.colors;
+        layout->pixels_size = info_header.image_size;
+        // OS/2 reuses these values for Huffman and RLE24 compression
+        if (layout->header_size == OS22XBITMAPHEADER && layout->compression > BI_RLE4)
+        {
+            return -1;
+        }
+    }
+    if (layout->width == 0 || layout->height == 0 || planes != 1)
+    {
+        return -1;
+    }
+
+    uint16_t const bpp = layout->bits_per_pixel;
+    if (bpp != 1 && bpp != 4 && bpp != 8 && bpp != 16 && bpp != 24 && bpp != 32)
+    {
+        return -1;
+    }
+
+    size_t masks_size = 0;
+    switch (layout->compression)
+    {
+    case BI_RGB:
+        if (bpp == 16)
+        {
+            layout->masks[0] = 0x7C00;
+            layout->masks[1] = 0x03E0;
+            layout->masks[2] = 0x001F;
+        }
+        else if (bpp > 16)
+        {
+            layout->masks[0] = 0x00FF0000;
+            layout->masks[1] = 0x0000FF00;
+            layout->masks[2] = 0x000000FF;
+        }
+        break;
+    case BI_BITFIELDS:
+    case BI_ALPHABITFIELDS:
+    {
+        if (bpp != 16 && bpp != 32)
+        {
+            return -1;
+        }
+        // The masks directly follow the BITMAPINFOHEADER fields, either inside a
+        // larger header or, for a BITMAPINFOHEADER, after it.
+        size_t const count = (layout->header_size >= BITMAPV3INFOHEADER || layout->compression == BI_ALPHABITFIELDS) ? 4 : 3;
+        size_t const masks_offset = dib_offset + sizeof(bmp_info_header);
+        if (masks_offset + (count * sizeof(uint32_t)) > size)
+        {
+            return -1;
+        }
+        memcpy(layout->masks, base + masks_offset, count * sizeof(uint32_t));
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (!bmp_mask_contiguous(layout->masks[i]))
+            {
+                return -1;
+            }
+        }
+        if (layout->header_size == BITMAPINFOHEADER)
+        {
+            masks_size = count * sizeof(uint32_t);
+        }
+        break;
+    }
+    case BI_RLE8:
+    case BI_RLE4:
+        if (bpp != ((layout->compression == BI_RLE8) ? 8 : 4) || layout->top_down)
+        {
+            return -1;
+        }
+        break;
+    default:
+        return -1;
+    }
+
+    if (bpp <= 8)
+    {
+        uint32_t const max_colors = UINT32_C(1) << bpp;
+        if (layout->palette_size == 0 || layout->palette_size > max_colors)
+        {
+            layout->palette_size = max_colors;
+        }
+    }
+    else
+    {
+        layout->palette_size = 0;
+    }
+    layout->palette_offset = dib_offset + layout->header_size + masks_size;
+    if (layout->palette_offset + (layout->palette_size * layout->palette_entry_size) > size)
+    {
+        return -1;
+    }
+
+    layout->offset = file_header.offset;
+    if (layout->offset < dib_offset + layout->header_size || layout->offset > size)
+    {
+        return -1;
+    }
+
+    layout->row_size = bmp_row_size(bpp, layout->width);
+    if (layout->row_size == 0)
+    {
+        return -1;
+    }
+    if (layout->compression != BI_RLE8 && layout->compression != BI_RLE4)
+    {
+        if (layout->height > SIZE_MAX / layout->row_size)
+        {
+            return -1;
+        }
+        layout->pixels_size = layout->row_size * layout->height;
+    }
+    else if (layout->pixels_size == 0)
+    {
+        layout->pixels_size = size - layout->offset;
+    }
+    if (layout->pixels_size > size - layout->offset)
+    {
+        return -1;
+    }
+
+    if (layout->height > SIZE_MAX / sizeof(bmp_pixel32) / layout->width)
+    {
+        return -1;
+    }
+    layout->decoded_size = layout->width * layout->height * sizeof(bmp_pixel32);
+    return 0;
+}
+
+/// Validates the headers of a mapped BMP file and fills in the header and pixel pointers.
+static int bmp_map_headers(bmp_mapping *mapping)
+{
+    unsigned char const *base = mapping->base;
+    bmp_layout layout;
+    if (bmp_get_layout(base, mapping->size, &layout) != 0 || layout.header_size < BITMAPINFOHEADER)
+    {
+        return -1;
+    }
+    bmp_info_header const *info_header = (bmp_info_header const *)(base + sizeof(bmp_file_header));
+    mapping->file_header = (bmp_file_header const *)base;
+    mapping->info_header = info_header;
+    mapping->v4_header = (info_header->size >= BITMAPV4HEADER) ? (bmp_v4_header const *)info_header : NULL;
+    mapping->pixels = base + layout.offset;
+    mapping->pixels_size = layout.pixels_size;
+    return 0;
+}
+
+int bmp_map(char const *file, bmp_mapping *mapping)
+{
+    if (file == NULL || mapping == NULL)
+    {
+        return -1;
+    }
+    memset(mapping, 0, sizeof(*mapping));
+    mapping->base = map_file(file, &mapping->size);
+    if (mapping->base == NULL)
+    {
+        return -1;
+    }
+    if (bmp_map_headers(mapping) != 0)
+    {
+        bmp_unmap(mapping);
+        return -1;
+    }
+    return 0;
+}
+
+void bmp_unmap(bmp_mapping *mapping)
+{
+    if (mapping == NULL || mapping->base == NULL)
+    {
+        return;
+    }
+    unmap_file(mapping->base, mapping->size);
+    memset(mapping, 0, sizeof(*mapping));
+}
+
+static void bmp_decode_indexed(unsigned char const *src, bmp_pixel32 *dst, size_t width, unsigned bpp, bmp_pixel32 const palette[256])
+{
+    unsigned const index_mask = (1U << bpp) - 1;
+    for (size_t x = 0; x < width; ++x)
+    {
+        size_t const bit = x * bpp;
+        unsigned const shift = 8 - bpp - (unsigned)(bit % 8);
+        dst[x] = palette[(src[bit / 8] >> shift) & index_mask];
+    }
+}
+
+/// Widens 16-bit pixels in chunks so that they can go through the 32-bit mask kernel.
+static void bmp_decode_masked16(unsigned char const *src, bmp_pixel32 *dst, size_t width, uint32_t const masks[static 4])
+{
+    enum
+    {
+        CHUNK = 256,
+    };
+    uint32_t wide[CHUNK];
+    for (size_t x = 0; x < width; x += CHUNK)
+    {
+        size_t const n = (width - x < CHUNK) ? width - x : CHUNK;
+        for (size_t i = 0; i < n; ++i)
+        {
+            uint16_t value;
+            memcpy(&value, &src[(x + i) * sizeof(value)], sizeof(value));
+            wide[i] = value;
+        }
+        bmp_convert_extract_masked(&dst[x], wide, n, masks);
+    }
+}
+
+/// Reads the color table of a parsed BMP file, padding it to 256 opaque black entries.
+static void bmp_read_palette(unsigned char const *base, bmp_layout const *layout, bmp_pixel32 palette[static 256])
+{
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        palette[i] = (bmp_pixel32){ 0, 0, 0, 0xFF };
+    }
+    for (uint32_t i = 0; i < layout->palette_size; ++i)
+    {
+        unsigned char const *entry = base + layout->palette_offset + (i * layout->palette_entry_size);
+        palette[i] = (bmp_pixel32){ entry[0], entry[1], entry[2], 0xFF };
+    }
+}
+
+#define NIBBLES1(x) { (x) >> 4, (x) & 0xF }
+#define NIBBLES4(x) NIBBLES1(x), NIBBLES1((x) + 1), NIBBLES1((x) + 2), NIBBLES1((x) + 3)
+#define NIBBLES16(x) NIBBLES4(x), NIBBLES4((x) + 4), NIBBLES4((x) + 8), NIBBLES4((x) + 12)
+#define NIBBLES64(x) NIBBLES16(x), NIBBLES16((x) + 16), NIBBLES16((x) + 32), NIBBLES16((x) + 48)
+
+/// The two 4-bit indices packed in each byte, high nibble first.
+static uint8_t const NIBBLES[256][2] = { NIBBLES64(0), NIBBLES64(64), NIBBLES64(128), NIBBLES64(192) };
+
+#undef NIBBLES64
+#undef NIBBLES16
+#undef NIBBLES4
+#undef NIBBLES1
+
+/// Fills a run of 4-bit indices that alternate between the two nibbles of a byte.
+static void rle4_fill(uint8_t *dst, size_t n, uint8_t value)
+{
+    uint8_t const *const pair = NIBBLES[value];
+    if (pair[0] == pair[1])
+    {
+        memset(dst, pair[0], n);
+        return;
+    }
+    for (size_t i = 0; i + 1 < n; i += 2)
+    {
+        memcpy(&dst[i], pair, 2);
+    }
+    if (n % 2 != 0)
+    {
+        dst[n - 1] = pair[0];
+    }
+}
+
+/// Expands RLE8 or RLE4 pixel data into one index per pixel, bottom-up.
+///
+/// Pixels skipped by end-of-line and delta codes keep index 0.  Runs that
+/// cross the end of a row are clipped.
+///
+/// @return 0 on success, -1 if the data is truncated.
+static int bmp_decode_rle(unsigned char const *src, size_t size, bmp_layout const *layout, uint8_t *indices)
+{
+    int const rle4 = layout->compression == BI_RLE4;
+    size_t const width = layout->width;
+    size_t const height = layout->height;
+    size_t x = 0;
+    size_t y = 0;
+    size_t i = 0;
+
+    while (y < height)
+    {
+        if (size - i < 2)
+        {
+            // Some encoders leave out the final end-of-bitmap code.
+            return (x == 0 && y > 0) ? 0 : -1;
+        }
+        size_t const count = src[i];
+        uint8_t const value = src[i + 1];
+        i += 2;
+        uint8_t *const row = &indices[y * width];
+
+        if (count > 0)
+        {
+            size_t const n = (count < width - x) ? count : width - x;
+            if (rle4)
+            {
+                rle4_fill(&row[x], n, value);
+            }
+            else
+            {
+                memset(&row[x], value, n);
+            }
+            x += n;
+            continue;
+        }
+
+        switch (value)
+        {
+        case 0: // End of line
+            x = 0;
+            y += 1;
+            break;
+        case 1: // End of bitmap
+            return 0;
+        case 2: // Delta
+            if (size - i < 2)
+            {
+                return -1;
+            }
+            x += src[i];
+            y += src[i + 1];
+            i += 2;
+            if (x > width)
+            {
+                x = width;
+            }
+            break;
+        default: // Absolute run of value pixels, padded to 16 bits
+        {
+            size_t const bytes = rle4 ? ((size_t)value + 1) / 2 : value;
+            if (size - i < bytes)
+            {
+                return -1;
+            }
+            size_t const n = (value < width - x) ? value : width - x;
+            if (rle4)
+            {
+                for (size_t j = 0; j + 1 < n; j += 2)
+                {
+                    memcpy(&row[x + j], NIBBLES[src[i + (j / 2)]], 2);
+                }
+                if (n % 2 != 0)
+                {
+                    row[x + n - 1] = NIBBLES[src[i + (n / 2)]][0];
+                }
+            }
+            else
+            {
+                memcpy(&row[x], &src[i], n);
+            }
+            x += n;
+            i += bytes + (bytes % 2);
+            if (i > size)
+            {
+                i = size;
+            }
+            break;
+        }
+        }
+    }
+    return 0;
+}
+
+/// Decodes RLE8 or RLE4 pixel data into top-down 32-bit pixels.
+static int bmp_decode_rle_pixels(unsigned char const *base, bmp_layout const *layout, bmp_pixel32 *pixels)
+{
+    uint8_t *indices = calloc(layout->width * layout->height, sizeof(*indices));
+    if (indices == NULL)
+    {
+        return -1;
+    }
+
+    int ret = -1;
+    if (bmp_decode_rle(base + layout->offset, layout->pixels_size, layout, indices) != 0)
+    {
+        goto out_free_indices;
+    }
+
+    bmp_pixel32 palette[256];
+    bmp_read_palette(base, layout, palette);
+    for (size_t y = 0; y < layout->height; ++y)
+    {
+        uint8_t const *src = &indices[(layout->height - 1 - y) * layout->width];
+        bmp_pixel32 *dst = &pixels[y * layout->width];
+        for (size_t x = 0; x < layout->width; ++x)
+        {
+            dst[x] = palette[src[x]];
+        }
+    }
+
+    ret = 0;
+out_free_indices:
+    free(indices);
+    return ret;
+}
+
+/// Decodes the pixel data of a parsed BMP file into top-down 32-bit pixels.
+static int bmp_decode(unsigned char const *base, bmp_layout const *layout, bmp_pixel32 *pixels)
+{
+    if (layout->compression == BI_RLE8 || layout->compression == BI_RLE4)
+    {
+        return bmp_decode_rle_pixels(base, layout, pixels);
+    }
+
+    unsigned const bpp = layout->bits_per_pixel;
+    uint32_t const *const masks = layout->masks;
+    int const bgr = masks[0] == 0x00FF0000 && masks[1] == 0x0000FF00 && masks[2] == 0x000000FF;
+
+    bmp_pixel32 palette[256];
+    bmp_read_palette(base, layout, palette);
+
+    for (size_t y = 0; y < layout->height; ++y)
+    {
+        size_t const src_y = layout->top_down ? y : (layout->height - 1 - y);
+        unsigned char const *src = base + layout->offset + (src_y * layout->row_size);
+        bmp_pixel32 *dst = pixels + (y * layout->width);
+        if (bpp <= 8)
+        {
+            bmp_decode_indexed(src, dst, layout->width, bpp, palette);
+        }
+        else if (bpp == 16)
+        {
+            bmp_decode_masked16(src, dst, layout->width, masks);
+        }
+        else if (bpp == 24)
+        {
+            bmp_convert_bgr24_to_bgra32(dst, (bmp_pixel24 const *)src, layout->width);
+        }
+        else if (bgr && masks[3] == 0xFF000000)
+        {
+            memcpy(dst, src, layout->width * sizeof(*dst));
+        }
+        else
+        {
+            bmp_convert_extract_masked(dst, src, layout->width, masks);
+        }
+    }
+    return 0;
+}
+
+int bmp_load(char const *file, bmp_pixel32 **pixels, size_t *width, size_t *height)
+{
+    if (file == NULL || pixels == NULL || width == NULL || height == NULL)
+    {
+        return -1;
+    }
+
+    size_t size = 0;
+    unsigned char *base = map_file(file, &size);
+    if (base == NULL)
+    {
+        return -1;
+    }
+
+    int ret = -1;
+    bmp_layout layout;
+    if (bmp_get_layout(base, size, &layout) != 0)
+    {
+        goto out_unmap_file;
+    }
+    *pixels = malloc(layout.decoded_size);
+    if (*pixels == NULL)
+    {
+        goto out_unmap_file;
+    }
+    if (bmp_decode(base, &layout, *pixels) != 0)
+    {
+        free(*pixels);
+        *pixels = NULL;
+        goto out_unmap_file;
+    }
+    *width = layout.width;
+    *height = layout.height;
+
+    ret = 0;
+out_unmap_file:
+    unmap_file(base, size);
+    return ret;
+}
+
+/// Fills in the headers of a 24- or 32-bit BMP file with a V4 header.
+///
+/// @return 0 on success, -1 if the image cannot be described by the headers.
+static int bmp_v4_headers(size_t width, int32_t height, uint16_t bits_per_pixel, bmp_file_header *file_header, bmp_v4_header *v4_header)
+{
+    if (width == 0 || width > INT32_MAX || height == 0 || height == INT32_MIN)
     {
         return -1;
     }
 
-    bmp_file_header file_header = {
+    size_t const rows = (size_t)((height < 0) ? -(int64_t)height : height);
+    size_t const row_size = bmp_row_size(bits_per_pixel, width);
+    if (row_size == 0 || rows > SIZE_MAX / row_size)
+    {
+        return -1;
+    }
+    size_t const image_size = row_size * rows;
+    size_t const file_size = V4_DATA_OFFSET + image_size;
+
+    *file_header = (bmp_file_header){
         .file_type = FILE_TYPE,
-        .file_size = (uint32_t)file_size,
+        .file_size = (file_size > UINT32_MAX) ? 0 : (uint32_t)file_size,
         .reserved1 = 0,
         .reserved2 = 0,
         .offset = (uint32_t)V4_DATA_OFFSET,
     };
 
-    bmp_v4_header v4_header = {
+    *v4_header = (bmp_v4_header){
         .size = BITMAPV4HEADER,
         .width = (int32_t)width,
-        .height = (int32_t)height,
+        .height = height,
         .planes = 1,
-        .bits_per_pixel = 32,
-        .compression = BI_BITFIELDS,
-        .image_size = (uint32_t)image_size,
+        .bits_per_pixel = bits_per_pixel,
+        .compression = (bits_per_pixel == 32) ? BI_BITFIELDS : BI_RGB,
+        .image_size = (image_size > UINT32_MAX) ? 0 : (uint32_t)image_size,
         .h_res = 0,
         .v_res = 0,
         .colors = 0,
@@ -204,13 +912,45 @@ int bmp_v4_write(bmp_pixel32 const *buffer, size_t width, size_t height, char co
         .r_mask = 0x00FF0000,
         .g_mask = 0x0000FF00,
         .b_mask = 0x000000FF,
-        .a_mask = 0xFF000000,
+        .a_mask = (bits_per_pixel == 32) ? 0xFF000000 : 0,
         .colorspace_type = LCS_WINDOWS_COLOR_SPACE,
         .colorspace = { 0 },
         .r_gamma = 0,
         .g_gamma = 0,
         .b_gamma = 0,
     };
+    return 0;
+}
+
+int bmp_v4_write(bmp_pixel32 const *buffer, size_t width, size_t height, char const *file)
+{
+    if (buffer == NULL || file == NULL)
+    {
+        return -1;
+    }
+    if (width > INT32_MAX || height > INT32_MAX)
+    {
+        return -1;
+    }
+
+    size_t const image_size = (width * height) * sizeof(bmp_pixel32);
+    if (image_size > UINT32_MAX)
+    {
+        return -1;
+    }
+
+    size_t const file_size = V4_DATA_OFFSET + image_size;
+    if (file_size > UINT32_MAX)
+    {
+        return -1;
+    }
+
+    bmp_file_header file_header;
+    bmp_v4_header v4_header;
+    if (bmp_v4_headers(width, (int32_t)height, 32, &file_header, &v4_header) != 0)
+    {
+        return -1;
+    }
 
     int ret = -1;
 
@@ -243,3 +983,386 @@ out_fclose_file_handle:
     fclose(file_handle);
     return ret;
 }
+
+enum
+{
+    RLE_MAX_RUN = 255,
+    RLE_MIN_RUN = 3,
+    RLE_COLORS = 256,
+    RLE_SLOTS = 2 * RLE_COLORS,
+};
+
+/// Maps the colors of an image to palette indices, ignoring alpha.
+///
+/// @return The number of colors, or 0 if there are more than RLE_COLORS.
+static uint32_t rle8_palette(bmp_pixel32 const *buffer, size_t count, uint8_t *indices, uint32_t palette[static RLE_COLORS])
+{
+    uint32_t keys[RLE_SLOTS];
+    int16_t slots[RLE_SLOTS];
+    memset(slots, -1, sizeof(slots));
+    uint32_t colors = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint32_t key;
+        memcpy(&key, &buffer[i], sizeof(key));
+        key &= 0x00FFFFFF;
+        size_t slot = (key * UINT32_C(2654435761)) >> 23;
+        while (slots[slot] >= 0 && keys[slot] != key)
+        {
+            slot = (slot + 1) % RLE_SLOTS;
+        }
+        if (slots[slot] < 0)
+        {
+            if (colors == RLE_COLORS)
+            {
+                return 0;
+            }
+            keys[slot] = key;
+            slots[slot] = (int16_t)colors;
+            palette[colors++] = key;
+        }
+        indices[i] = (uint8_t)slots[slot];
+    }
+    return colors;
+}
+
+/// Encodes one row of indices as RLE8 runs and absolute runs, without the end-of-line code.
+///
+/// @return The number of bytes written to out, at most 2 * width.
+static size_t rle8_encode_row(uint8_t const *row, size_t width, uint8_t *out)
+{
+    size_t o = 0;
+    size_t x = 0;
+    while (x < width)
+    {
+        size_t run = 1;
+        while (x + run < width && run < RLE_MAX_RUN && row[x + run] == row[x])
+        {
+            ++run;
+        }
+        if (run > 1)
+        {
+            out[o++] = (uint8_t)run;
+            out[o++] = row[x];
+            x += run;
+            continue;
+        }
+
+        // Collect pixels until a run worth encoding starts.
+        size_t n = 1;
+        while (x + n < width && n < RLE_MAX_RUN)
+        {
+            uint8_t const *p = &row[x + n];
+            if (x + n + RLE_MIN_RUN <= width && p[0] == p[1] && p[0] == p[2])
+            {
+                break;
+            }
+            ++n;
+        }
+        if (n < RLE_MIN_RUN)
+        {
+            // Absolute runs must be at least three pixels long.
+            for (size_t j = 0; j < n; ++j)
+            {
+                out[o++] = 1;
+                out[o++] = row[x + j];
+            }
+        }
+        else
+        {
+            out[o++] = 0;
+            out[o++] = (uint8_t)n;
+            memcpy(&out[o], &row[x], n);
+            o += n;
+            if (n % 2 != 0)
+            {
+                out[o++] = 0;
+            }
+        }
+        x += n;
+    }
+    return o;
+}
+
+int bmp_rle8_write(bmp_pixel32 const *buffer, size_t width, size_t height, char const *file)
+{
+    if (buffer == NULL || file == NULL || width == 0 || height == 0)
+    {
+        return -1;
+    }
+    if (width > INT32_MAX || height > INT32_MAX || height > SIZE_MAX / width)
+    {
+        return -1;
+    }
+
+    uint8_t *indices = malloc(width * height);
+    if (indices == NULL)
+    {
+        return -1;
+    }
+    int ret = -1;
+    uint32_t palette[RLE_COLORS];
+    uint32_t const colors = rle8_palette(buffer, width * height, indices, palette);
+    if (colors == 0)
+    {
+        goto out_free_indices;
+    }
+
+    uint8_t *out = malloc((2 * width) + 4);
+    if (out == NULL)
+    {
+        goto out_free_indices;
+    }
+
+    FILE *file_handle = fopen(file, "wb");
+    if (file_handle == NULL)
+    {
+        goto out_free_out;
+    }
+
+    // The headers are written last, once the size of the pixel data is known.
+    long const palette_offset = (long)(sizeof(bmp_file_header) + sizeof(bmp_info_header));
+    uint32_t const offset = (uint32_t)palette_offset + (colors * (uint32_t)sizeof(*palette));
+    if (fseek(file_handle, palette_offset, SEEK_SET) != 0 || fwrite(palette, sizeof(*palette), colors, file_handle) != colors)
+    {
+        goto out_fclose_file_handle;
+    }
+
+    size_t image_size = 0;
+    for (size_t y = 0; y < height; ++y)
+    {
+        size_t n = rle8_encode_row(&indices[y * width], width, out);
+        out[n++] = 0;
+        out[n++] = (y + 1 < height) ? 0 : 1; // End of line, or end of bitmap
+        if (fwrite(out, n, 1, file_handle) != 1)
+        {
+            goto out_fclose_file_handle;
+        }
+        image_size += n;
+        if (image_size > UINT32_MAX - offset)
+        {
+            goto out_fclose_file_handle;
+        }
+    }
+
+    bmp_file_header const file_header = {
+        .file_type = FILE_TYPE,
+        .file_size = (uint32_t)(offset + image_size),
+        .reserved1 = 0,
+        .reserved2 = 0,
+        .offset = offset,
+    };
+    bmp_info_header const info_header = {
+        .size = BITMAPINFOHEADER,
+        .width = (int32_t)width,
+        .height = (int32_t)height,
+        .planes = 1,
+        .bits_per_pixel = 8,
+        .compression = BI_RLE8,
+        .image_size = (uint32_t)image_size,
+        .h_res = 0,
+        .v_res = 0,
+        .colors = colors,
+        .imp_colors = 0,
+    };
+    if (fseek(file_handle, 0, SEEK_SET) != 0)
+    {
+        goto out_fclose_file_handle;
+    }
+    if (fwrite(&file_header, sizeof(file_header), 1, file_handle) != 1)
+    {
+        goto out_fclose_file_handle;
+    }
+    if (fwrite(&info_header, sizeof(info_header), 1, file_handle) != 1)
+    {
+        goto out_fclose_file_handle;
+    }
+
+    ret = 0;
+out_fclose_file_handle:
+    if (fclose(file_handle) != 0)
+    {
+        ret = -1;
+    }
+out_free_out:
+    free(out);
+out_free_indices:
+    free(indices);
+    return ret;
+}
+
+enum
+{
+    WRITER_ALIGNMENT = 4096,
+    WRITER_BUFFER_SIZE = 1 << 20,
+};
+
+struct bmp_writer
+{
+    FILE *file_handle;
+    unsigned char *buffer; // Aligned staging buffer for whole rows
+    size_t capacity;       // Size of buffer (bytes)
+    size_t used;           // Bytes staged in buffer
+    size_t width;          // Image width (pixels)
+    size_t height;         // Image height (pixels)
+    size_t row_size;       // Size of a row including padding (bytes)
+    size_t rows_written;   // Rows accepted so far
+    uint16_t bits_per_pixel;
+    int failed;            // Non-zero after a write error
+};
+
+static void *writer_buffer_alloc(size_t size)
+{
+#ifdef _WIN32
+    return _aligned_malloc(size, WRITER_ALIGNMENT);
+#else
+    return aligned_alloc(WRITER_ALIGNMENT, size);
+#endif
+}
+
+static void writer_buffer_free(void *buffer)
+{
+#ifdef _WIN32
+    _aligned_free(buffer);
+#else
+    free(buffer);
+#endif
+}
+
+static int bmp_writer_flush(bmp_writer *writer)
+{
+    if (writer->used > 0 && fwrite(writer->buffer, writer->used, 1, writer->file_handle) != 1)
+    {
+        writer->failed = 1;
+        return -1;
+    }
+    writer->used = 0;
+    return 0;
+}
+
+bmp_writer *bmp_writer_open(char const *file, size_t width, size_t height, uint16_t bits_per_pixel)
+{
+    if (file == NULL || height > INT32_MAX || (bits_per_pixel != 24 && bits_per_pixel != 32))
+    {
+        return NULL;
+    }
+
+    bmp_file_header file_header;
+    bmp_v4_header v4_header;
+    if (bmp_v4_headers(width, -(int32_t)height, bits_per_pixel, &file_header, &v4_header) != 0)
+    {
+        return NULL;
+    }
+
+    bmp_writer *writer = calloc(1, sizeof(*writer));
+    if (writer == NULL)
+    {
+        return NULL;
+    }
+    writer->width = width;
+    writer->height = height;
+    writer->bits_per_pixel = bits_per_pixel;
+    writer->row_size = bmp_row_size(bits_per_pixel, width);
+
+    // Stage as many whole rows as fit, but always at least one.
+    size_t const rows = (writer->row_size < WRITER_BUFFER_SIZE) ? WRITER_BUFFER_SIZE / writer->row_size : 1;
+    size_t const capacity = rows * writer->row_size;
+    writer->capacity = capacity;
+    writer->buffer = writer_buffer_alloc(((capacity + WRITER_ALIGNMENT - 1) / WRITER_ALIGNMENT) * WRITER_ALIGNMENT);
+    if (writer->buffer == NULL)
+    {
+        goto out_free_writer;
+    }
+
+    writer->file_handle = fopen(file, "wb");
+    if (writer->file_handle == NULL)
+    {
+        goto out_free_buffer;
+    }
+    // Rows are staged in our own buffer, so stdio buffering would only add a copy.
+    (void)setvbuf(writer->file_handle, NULL, _IONBF, 0);
+
+    memcpy(writer->buffer, &file_header, sizeof(file_header));
+    memcpy(writer->buffer + sizeof(file_header), &v4_header, sizeof(v4_header));
+    if (fwrite(writer->buffer, V4_DATA_OFFSET, 1, writer->file_handle) != 1)
+    {
+        goto out_fclose_file_handle;
+    }
+    return writer;
+
+out_fclose_file_handle:
+    fclose(writer->file_handle);
+out_free_buffer:
+    writer_buffer_free(writer->buffer);
+out_free_writer:
+    free(writer);
+    return NULL;
+}
+
+int bmp_writer_write_rows(bmp_writer *writer, bmp_pixel32 const *rows, size_t n)
+{
+    if (writer == NULL || rows == NULL || writer->failed)
+    {
+        return -1;
+    }
+    if (n > writer->height - writer->rows_written)
+    {
+        return -1;
+    }
+
+    for (size_t y = 0; y < n; ++y)
+    {
+        if (writer->capacity - writer->used < writer->row_size && bmp_writer_flush(writer) != 0)
+        {
+            return -1;
+        }
+
+        bmp_pixel32 const *src = &rows[y * writer->width];
+        unsigned char *dst = &writer->buffer[writer->used];
+        size_t pixel_bytes = writer->width * sizeof(*src);
+        if (writer->bits_per_pixel == 32)
+        {
+            memcpy(dst, src, pixel_bytes);
+        }
+        else
+        {
+            for (size_t x = 0; x < writer->width; ++x)
+            {
+                memcpy(&dst[x * sizeof(bmp_pixel24)], &src[x], sizeof(bmp_pixel24));
+            }
+            pixel_bytes = writer->width * sizeof(bmp_pixel24);
+        }
+        memset(&dst[pixel_bytes], 0, writer->row_size - pixel_bytes);
+        writer->used += writer->row_size;
+    }
+    writer->rows_written += n;
+    return 0;
+}
+
+int bmp_writer_close(bmp_writer *writer)
+{
+    if (writer == NULL)
+    {
+        return -1;
+    }
+
+    int ret = -1;
+    if (writer->failed || bmp_writer_flush(writer) != 0)
+    {
+        goto out_fclose_file_handle;
+    }
+    if (writer->rows_written != writer->height)
+    {
+        goto out_fclose_file_handle;
+    }
+
+    ret = 0;
+out_fclose_file_handle:
+    if (fclose(writer->file_handle) != 0)
+    {
+        ret = -1;
+    }
+    writer_buffer_free(writer->buffer);
+    free(writer);
+    return ret;
+}
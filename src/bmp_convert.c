@@ -0,0 +1,455 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bmp.h"
+#include "bmp_convert.h"
+#include "cpu_isa.h"
+#include "macro.h"
+
+#ifdef CPU_ISA_X86
+#    include <immintrin.h>
+#endif
+
+STATIC_ASSERT(sizeof(bmp_pixel24) == 3);
+STATIC_ASSERT(sizeof(bmp_pixel32) == 4);
+
+enum
+{
+    RED = 0,
+    GREEN = 1,
+    BLUE = 2,
+    ALPHA = 3,
+};
+
+/// Byte position of each channel, in mask order, within a little-endian BGRA32 pixel.
+static unsigned const CHANNEL_POSITION[4] = { 2, 1, 0, 3 };
+
+/// Shifts that move a masked channel to the top of a 32-bit word and widen it to 8 bits.
+typedef struct channel_shifts
+{
+    unsigned left[4]; // Left shift that aligns the top of the mask with bit 31, or 32 if empty
+    unsigned bits[4]; // Width of the mask
+    uint32_t fill;    // Bits set for empty masks (opaque alpha)
+} channel_shifts;
+
+static void channel_shifts_init(channel_shifts *shifts, uint32_t const masks[static 4])
+{
+    shifts->fill = 0;
+    for (size_t c = 0; c < 4; ++c)
+    {
+        if (masks[c] == 0)
+        {
+            shifts->left[c] = 32;
+            shifts->bits[c] = 0;
+            if (c == ALPHA)
+            {
+                shifts->fill |= UINT32_C(0xFF) << (CHANNEL_POSITION[c] * 8);
+            }
+            continue;
+        }
+        unsigned const shift = (unsigned)__builtin_ctz(masks[c]);
+        shifts->bits[c] = (unsigned)__builtin_popcount(masks[c]);
+        shifts->left[c] = 32 - shift - shifts->bits[c];
+    }
+}
+
+// Scalar
+
+static void bgr24_to_bgra32_scalar(bmp_pixel32 *dst, bmp_pixel24 const *src, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        dst[i] = (bmp_pixel32){ src[i].b, src[i].g, src[i].r, 0xFF };
+    }
+}
+
+static void swap_red_blue_scalar(bmp_pixel32 *dst, bmp_pixel32 const *src, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        bmp_pixel32 const p = src[i];
+        dst[i] = (bmp_pixel32){ p.r, p.g, p.b, p.a };
+    }
+}
+
+static inline uint32_t extract_channel(uint32_t value, uint32_t mask, unsigned left, unsigned bits)
+{
+    if (bits == 0)
+    {
+        return 0;
+    }
+    uint32_t t = (value & mask) << left;
+    for (unsigned s = bits; s < 8; s *= 2)
+    {
+        t |= t >> s;
+    }
+    return t >> 24;
+}
+
+static void extract_masked_scalar(bmp_pixel32 *dst, void const *src, size_t n, uint32_t const masks[static 4])
+{
+    channel_shifts shifts;
+    channel_shifts_init(&shifts, masks);
+    unsigned char const *s = src;
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint32_t value;
+        memcpy(&value, &s[i * sizeof(value)], sizeof(value));
+        uint32_t out = shifts.fill;
+        for (size_t c = 0; c < 4; ++c)
+        {
+            out |= extract_channel(value, masks[c], shifts.left[c], shifts.bits[c]) << (CHANNEL_POSITION[c] * 8);
+        }
+        memcpy(&dst[i], &out, sizeof(out));
+    }
+}
+
+static inline uint8_t premultiply(uint8_t c, uint8_t a)
+{
+    unsigned const t = ((unsigned)c * a) + 128;
+    return (uint8_t)((t + (t >> 8)) >> 8);
+}
+
+static void premultiply_alpha_scalar(bmp_pixel32 *dst, bmp_pixel32 const *src, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        bmp_pixel32 const p = src[i];
+        dst[i] = (bmp_pixel32){ premultiply(p.b, p.a), premultiply(p.g, p.a), premultiply(p.r, p.a), p.a };
+    }
+}
+
+static void swap_rows_scalar(void *a, void *b, size_t size)
+{
+    unsigned char *x = a;
+    unsigned char *y = b;
+    for (size_t i = 0; i < size; ++i)
+    {
+        unsigned char const t = x[i];
+        x[i] = y[i];
+        y[i] = t;
+    }
+}
+
+static bmp_convert_kernels const KERNELS_SCALAR = {
+    .bgr24_to_bgra32 = bgr24_to_bgra32_scalar,
+    .swap_red_blue = swap_red_blue_scalar,
+    .extract_masked = extract_masked_scalar,
+    .premultiply_alpha = premultiply_alpha_scalar,
+    .swap_rows = swap_rows_scalar,
+};
+
+#ifdef CPU_ISA_X86
+
+// SSE2
+
+__attribute__((target("sse2"))) static void bgr24_to_bgra32_sse2(bmp_pixel32 *dst, bmp_pixel24 const *src, size_t n)
+{
+    __m128i const m0 = _mm_setr_epi32(0x00FFFFFF, 0, 0, 0);
+    __m128i const m1 = _mm_setr_epi32(0, 0x00FFFFFF, 0, 0);
+    __m128i const m2 = _mm_setr_epi32(0, 0, 0x00FFFFFF, 0);
+    __m128i const m3 = _mm_setr_epi32(0, 0, 0, 0x00FFFFFF);
+    __m128i const alpha = _mm_set1_epi32((int)0xFF000000);
+    size_t i = 0;
+    // Each iteration reads 16 bytes but consumes 12, so stop while a full load is in bounds.
+    for (; i + 6 <= n; i += 4)
+    {
+        __m128i const v = _mm_loadu_si128((__m128i const *)&src[i]);
+        __m128i x = _mm_and_si128(v, m0);
+        x = _mm_or_si128(x, _mm_and_si128(_mm_slli_si128(v, 1), m1));
+        x = _mm_or_si128(x, _mm_and_si128(_mm_slli_si128(v, 2), m2));
+        x = _mm_or_si128(x, _mm_and_si128(_mm_slli_si128(v, 3), m3));
+        _mm_storeu_si128((__m128i *)&dst[i], _mm_or_si128(x, alpha));
+    }
+    bgr24_to_bgra32_scalar(&dst[i], &src[i], n - i);
+}
+
+__attribute__((target("sse2"))) static void swap_red_blue_sse2(bmp_pixel32 *dst, bmp_pixel32 const *src, size_t n)
+{
+    __m128i const keep = _mm_set1_epi32((int)0xFF00FF00);
+    __m128i const low = _mm_set1_epi32(0x000000FF);
+    __m128i const high = _mm_set1_epi32(0x00FF0000);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i const v = _mm_loadu_si128((__m128i const *)&src[i]);
+        __m128i x = _mm_and_si128(v, keep);
+        x = _mm_or_si128(x, _mm_and_si128(_mm_srli_epi32(v, 16), low));
+        x = _mm_or_si128(x, _mm_and_si128(_mm_slli_epi32(v, 16), high));
+        _mm_storeu_si128((__m128i *)&dst[i], x);
+    }
+    swap_red_blue_scalar(&dst[i], &src[i], n - i);
+}
+
+__attribute__((target("sse2"))) static inline __m128i extract_channel_sse2(__m128i v, uint32_t mask, unsigned left, unsigned bits, unsigned position)
+{
+    __m128i t = _mm_sll_epi32(_mm_and_si128(v, _mm_set1_epi32((int)mask)), _mm_cvtsi32_si128((int)left));
+    t = _mm_or_si128(t, _mm_srl_epi32(t, _mm_cvtsi32_si128((int)bits)));
+    t = _mm_or_si128(t, _mm_srl_epi32(t, _mm_cvtsi32_si128((int)(bits * 2))));
+    t = _mm_or_si128(t, _mm_srl_epi32(t, _mm_cvtsi32_si128((int)(bits * 4))));
+    return _mm_sll_epi32(_mm_srli_epi32(t, 24), _mm_cvtsi32_si128((int)(position * 8)));
+}
+
+__attribute__((target("sse2"))) static void extract_masked_sse2(bmp_pixel32 *dst, void const *src, size_t n, uint32_t const masks[static 4])
+{
+    channel_shifts shifts;
+    channel_shifts_init(&shifts, masks);
+    __m128i const fill = _mm_set1_epi32((int)shifts.fill);
+    unsigned char const *s = src;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i const v = _mm_loadu_si128((__m128i const *)&s[i * sizeof(uint32_t)]);
+        __m128i x = fill;
+        for (size_t c = 0; c < 4; ++c)
+        {
+            x = _mm_or_si128(x, extract_channel_sse2(v, masks[c], shifts.left[c], shifts.bits[c], CHANNEL_POSITION[c]));
+        }
+        _mm_storeu_si128((__m128i *)&dst[i], x);
+    }
+    extract_masked_scalar(&dst[i], &s[i * sizeof(uint32_t)], n - i, masks);
+}
+
+__attribute__((target("sse2"))) static inline __m128i premultiply_sse2(__m128i v)
+{
+    __m128i const color = _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+    __m128i const opaque = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+    __m128i const bias = _mm_set1_epi16(128);
+    __m128i const a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xFF), 0xFF);
+    __m128i const m = _mm_or_si128(_mm_and_si128(a, color), opaque);
+    __m128i const t = _mm_add_epi16(_mm_mullo_epi16(v, m), bias);
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+__attribute__((target("sse2"))) static void premultiply_alpha_sse2(bmp_pixel32 *dst, bmp_pixel32 const *src, size_t n)
+{
+    __m128i const zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i const v = _mm_loadu_si128((__m128i const *)&src[i]);
+        __m128i const lo = premultiply_sse2(_mm_unpacklo_epi8(v, zero));
+        __m128i const hi = premultiply_sse2(_mm_unpackhi_epi8(v, zero));
+        _mm_storeu_si128((__m128i *)&dst[i], _mm_packus_epi16(lo, hi));
+    }
+    premultiply_alpha_scalar(&dst[i], &src[i], n - i);
+}
+
+__attribute__((target("sse2"))) static void swap_rows_sse2(void *a, void *b, size_t size)
+{
+    unsigned char *x = a;
+    unsigned char *y = b;
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i const u = _mm_loadu_si128((__m128i const *)&x[i]);
+        __m128i const v = _mm_loadu_si128((__m128i const *)&y[i]);
+        _mm_storeu_si128((__m128i *)&x[i], v);
+        _mm_storeu_si128((__m128i *)&y[i], u);
+    }
+    swap_rows_scalar(&x[i], &y[i], size - i);
+}
+
+static bmp_convert_kernels const KERNELS_SSE2 = {
+    .bgr24_to_bgra32 = bgr24_to_bgra32_sse2,
+    .swap_red_blue = swap_red_blue_sse2,
+    .extract_masked = extract_masked_sse2,
+    .premultiply_alpha = premultiply_alpha_sse2,
+    .swap_rows = swap_rows_sse2,
+};
+
+// AVX2
+
+__attribute__((target("avx2"))) static void bgr24_to_bgra32_avx2(bmp_pixel32 *dst, bmp_pixel24 const *src, size_t n)
+{
+    __m256i const shuffle = _mm256_setr_epi8(
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    __m256i const alpha = _mm256_set1_epi32((int)0xFF000000);
+    size_t i = 0;
+    // The upper load starts 12 bytes in and reads 16, so 28 bytes must be in bounds.
+    for (; i + 10 <= n; i += 8)
+    {
+        __m128i const lo = _mm_loadu_si128((__m128i const *)&src[i]);
+        __m128i const hi = _mm_loadu_si128((__m128i const *)&src[i + 4]);
+        __m256i const v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        _mm256_storeu_si256((__m256i *)&dst[i], _mm256_or_si256(_mm256_shuffle_epi8(v, shuffle), alpha));
+    }
+    bgr24_to_bgra32_scalar(&dst[i], &src[i], n - i);
+}
+
+__attribute__((target("avx2"))) static void swap_red_blue_avx2(bmp_pixel32 *dst, bmp_pixel32 const *src, size_t n)
+{
+    __m256i const shuffle = _mm256_setr_epi8(
+        2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+        2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i const v = _mm256_loadu_si256((__m256i const *)&src[i]);
+        _mm256_storeu_si256((__m256i *)&dst[i], _mm256_shuffle_epi8(v, shuffle));
+    }
+    swap_red_blue_scalar(&dst[i], &src[i], n - i);
+}
+
+__attribute__((target("avx2"))) static inline __m256i extract_channel_avx2(__m256i v, uint32_t mask, unsigned left, unsigned bits, unsigned position)
+{
+    __m256i t = _mm256_sll_epi32(_mm256_and_si256(v, _mm256_set1_epi32((int)mask)), _mm_cvtsi32_si128((int)left));
+    t = _mm256_or_si256(t, _mm256_srl_epi32(t, _mm_cvtsi32_si128((int)bits)));
+    t = _mm256_or_si256(t, _mm256_srl_epi32(t, _mm_cvtsi32_si128((int)(bits * 2))));
+    t = _mm256_or_si256(t, _mm256_srl_epi32(t, _mm_cvtsi32_si128((int)(bits * 4))));
+    return _mm256_sll_epi32(_mm256_srli_epi32(t, 24), _mm_cvtsi32_si128((int)(position * 8)));
+}
+
+__attribute__((target("avx2"))) static void extract_masked_avx2(bmp_pixel32 *dst, void const *src, size_t n, uint32_t const masks[static 4])
+{
+    channel_shifts shifts;
+    channel_shifts_init(&shifts, masks);
+    __m256i const fill = _mm256_set1_epi32((int)shifts.fill);
+    unsigned char const *s = src;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i const v = _mm256_loadu_si256((__m256i const *)&s[i * sizeof(uint32_t)]);
+        __m256i x = fill;
+        for (size_t c = 0; c < 4; ++c)
+        {
+            x = _mm256_or_si256(x, extract_channel_avx2(v, masks[c], shifts.left[c], shifts.bits[c], CHANNEL_POSITION[c]));
+        }
+        _mm256_storeu_si256((__m256i *)&dst[i], x);
+    }
+    extract_masked_scalar(&dst[i], &s[i * sizeof(uint32_t)], n - i, masks);
+}
+
+__attribute__((target("avx2"))) static inline __m256i premultiply_avx2(__m256i v)
+{
+    __m256i const color = _mm256_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0);
+    __m256i const opaque = _mm256_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255);
+    __m256i const bias = _mm256_set1_epi16(128);
+    __m256i const a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(v, 0xFF), 0xFF);
+    __m256i const m = _mm256_or_si256(_mm256_and_si256(a, color), opaque);
+    __m256i const t = _mm256_add_epi16(_mm256_mullo_epi16(v, m), bias);
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+__attribute__((target("avx2"))) static void premultiply_alpha_avx2(bmp_pixel32 *dst, bmp_pixel32 const *src, size_t n)
+{
+    __m256i const zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        // Unpack and pack both work within 128-bit lanes, so the pixel order is preserved.
+        __m256i const v = _mm256_loadu_si256((__m256i const *)&src[i]);
+        __m256i const lo = premultiply_avx2(_mm256_unpacklo_epi8(v, zero));
+        __m256i const hi = premultiply_avx2(_mm256_unpackhi_epi8(v, zero));
+        _mm256_storeu_si256((__m256i *)&dst[i], _mm256_packus_epi16(lo, hi));
+    }
+    premultiply_alpha_scalar(&dst[i], &src[i], n - i);
+}
+
+__attribute__((target("avx2"))) static void swap_rows_avx2(void *a, void *b, size_t size)
+{
+    unsigned char *x = a;
+    unsigned char *y = b;
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        __m256i const u = _mm256_loadu_si256((__m256i const *)&x[i]);
+        __m256i const v = _mm256_loadu_si256((__m256i const *)&y[i]);
+        _mm256_storeu_si256((__m256i *)&x[i], v);
+        _mm256_storeu_si256((__m256i *)&y[i], u);
+    }
+    swap_rows_scalar(&x[i], &y[i], size - i);
+}
+
+static bmp_convert_kernels const KERNELS_AVX2 = {
+    .bgr24_to_bgra32 = bgr24_to_bgra32_avx2,
+    .swap_red_blue = swap_red_blue_avx2,
+    .extract_masked = extract_masked_avx2,
+    .premultiply_alpha = premultiply_alpha_avx2,
+    .swap_rows = swap_rows_avx2,
+};
+
+#endif // CPU_ISA_X86
+
+bmp_convert_kernels const *bmp_convert_get_kernels(cpu_isa isa)
+{
+    if (!cpu_isa_supported(isa))
+    {
+        return NULL;
+    }
+    switch (isa)
+    {
+    case CPU_ISA_SCALAR:
+        return &KERNELS_SCALAR;
+#ifdef CPU_ISA_X86
+    case CPU_ISA_SSE2:
+        return &KERNELS_SSE2;
+    case CPU_ISA_AVX2:
+        return &KERNELS_AVX2;
+#endif
+    default:
+        return NULL;
+    }
+}
+
+bmp_convert_kernels const *bmp_convert_best_kernels(void)
+{
+    return bmp_convert_get_kernels(cpu_isa_best());
+}
+
+void bmp_convert_bgr24_to_bgra32(bmp_pixel32 *dst, bmp_pixel24 const *src, size_t n)
+{
+    bmp_convert_best_kernels()->bgr24_to_bgra32(dst, src, n);
+}
+
+void bmp_convert_swap_red_blue(bmp_pixel32 *dst, bmp_pixel32 const *src, size_t n)
+{
+    bmp_convert_best_kernels()->swap_red_blue(dst, src, n);
+}
+
+void bmp_convert_extract_masked(bmp_pixel32 *dst, void const *src, size_t n, uint32_t const masks[static 4])
+{
+    bmp_convert_best_kernels()->extract_masked(dst, src, n, masks);
+}
+
+void bmp_convert_premultiply_alpha(bmp_pixel32 *dst, bmp_pixel32 const *src, size_t n)
+{
+    bmp_convert_best_kernels()->premultiply_alpha(dst, src, n);
+}
+
+void bmp_convert_mono_table_init(bmp_convert_mono_table *table, bmp_pixel32 zero, bmp_pixel32 one)
+{
+    for (unsigned byte = 0; byte < 256; ++byte)
+    {
+        for (unsigned bit = 0; bit < 8; ++bit)
+        {
+            table->pixels[byte][bit] = ((byte >> (7 - bit)) & 1) ? one : zero;
+        }
+    }
+}
+
+void bmp_convert_expand_mono(bmp_pixel32 *dst, uint8_t const *src, size_t n, bmp_convert_mono_table const *table)
+{
+    size_t const bytes = n / 8;
+    for (size_t i = 0; i < bytes; ++i)
+    {
+        memcpy(&dst[i * 8], table->pixels[src[i]], sizeof(table->pixels[0]));
+    }
+    size_t const rest = n % 8;
+    if (rest > 0)
+    {
+        memcpy(&dst[bytes * 8], table->pixels[src[bytes]], rest * sizeof(*dst));
+    }
+}
+
+void bmp_convert_flip(void *pixels, size_t row_size, size_t height)
+{
+    bmp_convert_kernels const *kernels = bmp_convert_best_kernels();
+    unsigned char *const p = pixels;
+    for (size_t y = 0; y < height / 2; ++y)
+    {
+        kernels->swap_rows(&p[y * row_size], &p[(height - 1 - y) * row_size], row_size);
+    }
+}
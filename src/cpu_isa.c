@@ -0,0 +1,53 @@
+#include "cpu_isa.h"
+
+#include <stdatomic.h>
+
+static char const *const NAMES[CPU_ISA_MAX] = {
+    [CPU_ISA_SCALAR] = "scalar",
+    [CPU_ISA_SSE2] = "sse2",
+    [CPU_ISA_AVX2] = "avx2",
+};
+
+/// Returns a set with bit isa set for each supported instruction set.
+static unsigned detect(void)
+{
+    unsigned supported = 1u << CPU_ISA_SCALAR;
+#ifdef CPU_ISA_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+        supported |= 1u << CPU_ISA_SSE2;
+    if (__builtin_cpu_supports("avx2"))
+        supported |= 1u << CPU_ISA_AVX2;
+#endif
+    return supported;
+}
+
+int cpu_isa_supported(cpu_isa isa)
+{
+    // The set is never empty once detected, and threads racing on the first call all store the same set.
+    static _Atomic unsigned supported = 0;
+    unsigned set = atomic_load_explicit(&supported, memory_order_relaxed);
+    if (set == 0)
+    {
+        set = detect();
+        atomic_store_explicit(&supported, set, memory_order_relaxed);
+    }
+    return (unsigned)isa < CPU_ISA_MAX && (set & (1u << isa)) != 0;
+}
+
+cpu_isa cpu_isa_best(void)
+{
+    for (int isa = CPU_ISA_MAX - 1; isa > CPU_ISA_SCALAR; --isa)
+    {
+        if (cpu_isa_supported((cpu_isa)isa))
+        {
+            return (cpu_isa)isa;
+        }
+    }
+    return CPU_ISA_SCALAR;
+}
+
+char const *cpu_isa_name(cpu_isa isa)
+{
+    return ((unsigned)isa < CPU_ISA_MAX) ? NAMES[isa] : "unknown";
+}
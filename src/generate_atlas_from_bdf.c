@@ -1,12 +1,20 @@
 #include <assert.h>
 #include <limits.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
+#include <SDL.h>
+
+#include "atlas.h"
 #include "bmp.h"
+#include "bmp_convert.h"
+#include "sdf.h"
 
 #define eprintf(...) (void)fprintf(stderr, __VA_ARGS__)
 
@@ -14,221 +22,648 @@
 
 STATIC_ASSERT(CHAR_BIT == 8);
 
-#define SELECT_BIT(c, pos) (((pos) >= CHAR_BIT) ? 0 : ((c) & (1 << (CHAR_BIT + ~(pos)))))
-
-#define SELECT_BIT_TESTS         \
-    X(0b10000000, 0, 0b10000000) \
-    X(0b01000000, 1, 0b01000000) \
-    X(0b00100000, 2, 0b00100000) \
-    X(0b00010000, 3, 0b00010000) \
-    X(0b00001000, 4, 0b00001000) \
-    X(0b00000100, 5, 0b00000100) \
-    X(0b00000010, 6, 0b00000010) \
-    X(0b00000001, 7, 0b00000001) \
-    X(0b11111111, 0, 0b10000000) \
-    X(0b11111111, 7, 0b00000001) \
-    X(0b00000000, 0, 0b00000000) \
-    X(0b00000000, 7, 0b00000000) \
-    X(0b00000000, 8, 0b00000000)
-
-#define X(in, pos, out) STATIC_ASSERT(SELECT_BIT((in), (pos)) == (out));
-SELECT_BIT_TESTS
-#undef X
-
-#define GET_BIT(c, pos) (((pos) >= CHAR_BIT) ? 0 : (((c) >> (CHAR_BIT + ~(pos)) & 1)))
-
-#define GET_BIT_TESTS            \
-    X(0b10000000, 0, 0b00000001) \
-    X(0b01000000, 1, 0b00000001) \
-    X(0b00100000, 2, 0b00000001) \
-    X(0b00010000, 3, 0b00000001) \
-    X(0b00001000, 4, 0b00000001) \
-    X(0b00000100, 5, 0b00000001) \
-    X(0b00000010, 6, 0b00000001) \
-    X(0b00000001, 7, 0b00000001) \
-    X(0b11111111, 0, 0b00000001) \
-    X(0b11111111, 7, 0b00000001) \
-    X(0b00000000, 0, 0b00000000) \
-    X(0b00000000, 7, 0b00000000) \
-    X(0b00000000, 8, 0b00000000)
-
-#define X(in, pos, out) STATIC_ASSERT(GET_BIT((in), (pos)) == (out));
-GET_BIT_TESTS
-#undef X
-
 enum
 {
-    WIDTH = 10,
-    HEIGHT = 20,
-    LOW = '!',
-    HIGH = '~',
-    CODES_SIZE = (HIGH - LOW) + 1,
+    DEFAULT_WIDTH = 10,
+    DEFAULT_HEIGHT = 20,
+    DEFAULT_LOW = ' ',
+    DEFAULT_HIGH = '~',
+    MAX_RANGES = 64,
+    MAX_CODE = 0x10FFFF,
+    CHUNK_SIZE = 64, // Glyphs claimed by a worker at a time
+    PADDING = 1,
+    MAX_SIZE = 4096,
+    MAX_SPREAD = 64,
 };
 
-static char const *const FONT_FILE = "./assets/ucs-fonts/10x20.bdf";
-static char const *const BMP_FILE = "./assets/10x20.bmp";
+static char const *const DEFAULT_FONT_FILE = "./assets/ucs-fonts/10x20.bdf";
+static char const *const DEFAULT_BMP_FILE = "./assets/10x20.bmp";
+static char const *const METRICS_EXT = ".atlas";
 
 static bmp_pixel32 const WHITE = { 0xFF, 0xFF, 0xFF, 0x00 };
 static bmp_pixel32 const BLACK = { 0x00, 0x00, 0x00, 0xFF };
 
-// https://freetype.org/freetype2/docs/reference/ft2-basic_types.html#ft_bitmap
-static void render_bitmap_char(FT_GlyphSlot slot, char *target, size_t const code_size, size_t const offset)
+/// Expands glyph bits straight to atlas pixels, filled in by main() before rendering starts.
+static bmp_convert_mono_table mono_table;
+
+/// An inclusive range of codepoints.
+typedef struct code_range
 {
-    unsigned char const *buffer = slot->bitmap.buffer;
-    size_t const rows = (size_t)slot->bitmap.rows;
-    size_t const width = (size_t)slot->bitmap.width;
-    size_t const pitch = (size_t)abs(slot->bitmap.pitch);
-    size_t const stride = width * code_size;
+    uint32_t low;
+    uint32_t high;
+} code_range;
 
-    assert(width == WIDTH);
+struct args
+{
+    char const *font_file;
+    char const *bmp_file;
+    unsigned width;  // Glyph width passed to FT_Set_Pixel_Sizes (pixels)
+    unsigned height; // Glyph height passed to FT_Set_Pixel_Sizes (pixels)
+    uint32_t threads;
+    unsigned sdf_spread; // Distance field spread (pixels), 0 for a coverage atlas
+    size_t range_count;
+    code_range ranges[MAX_RANGES];
+};
 
-    for (size_t y = 0, p = 0; y < rows; ++y, p += pitch)
-    {
-        for (size_t i = 0; i < pitch; ++i)
-        {
-            for (size_t j = 0, x; j < CHAR_BIT; ++j)
-            {
-                x = j + (i * CHAR_BIT);
-                if (x >= width)
-                    continue;
+/// Rendered glyphs, before and after packing.
+typedef struct glyph_set
+{
+    atlas_metrics metrics; // Glyph metrics, positions filled in by pack_glyphs()
+    bmp_pixel32 **images;  // Image of each glyph
+} glyph_set;
 
-                target[(y * stride) + (x + (offset * width))] = GET_BIT(buffer[p + i], j);
-            }
-        }
-    }
+/// Glyphs shared by the render workers.
+typedef struct render_job
+{
+    struct args const *as;
+    glyph_set *set;
+    _Atomic size_t next;  // Index of the next unclaimed glyph
+    _Atomic int failed;   // Non-zero once a worker has failed
+} render_job;
+
+static void usage(char const *prog)
+{
+    (void)fprintf(stderr,
+                  "Usage: %s [-f FONT] [-s WIDTHxHEIGHT] [-r LOW-HIGH[,LOW-HIGH...]] [-j THREADS] [-d SPREAD] [OUTPUT]\n"
+                  "\n"
+                  "Renders the glyphs of FONT in the given codepoint ranges into the atlas OUTPUT,\n"
+                  "and writes their metrics next to it with a %s extension.\n"
+                  "\n"
+                  "Scalable fonts are rendered at the pixel size given by -s.  Bitmap fonts, such\n"
+                  "as BDF fonts, must have a strike of exactly that size.\n"
+                  "\n"
+                  "With -d, the alpha channel of OUTPUT holds a signed distance field of every\n"
+                  "glyph instead of its coverage, saturating SPREAD pixels from the edge.  Glyphs\n"
+                  "grow by SPREAD pixels on every side to make room for the field.\n"
+                  "\n"
+                  "Defaults: -f %s -s %dx%d -r 0x%X-0x%X -j <CPU count> %s\n",
+                  prog, METRICS_EXT, DEFAULT_FONT_FILE, DEFAULT_WIDTH, DEFAULT_HEIGHT, DEFAULT_LOW, DEFAULT_HIGH,
+                  DEFAULT_BMP_FILE);
 }
 
-static int render_bitmap_chars(FT_Face face, char const codes[CODES_SIZE], char *image)
+static int parse_uint(char const *str, unsigned long max, char **end, unsigned long *out)
 {
-    int rc = FT_Set_Pixel_Sizes(face, WIDTH, HEIGHT);
-    if (rc != 0)
-    {
-        eprintf("FT_Set_Pixel_Sizes failed.  Error code: %d", rc);
+    if (*str < '0' || *str > '9')
         return -1;
+
+    unsigned long const value = strtoul(str, end, 0);
+    if (value > max)
+        return -1;
+
+    *out = value;
+    return 0;
+}
+
+static int parse_size(char const *str, struct args *as)
+{
+    char *end = NULL;
+    unsigned long width = 0;
+    unsigned long height = 0;
+    if (parse_uint(str, MAX_SIZE, &end, &width) != 0 || *end != 'x')
+        return -1;
+
+    if (parse_uint(end + 1, MAX_SIZE, &end, &height) != 0 || *end != '\0' || width == 0 || height == 0)
+        return -1;
+
+    as->width = (unsigned)width;
+    as->height = (unsigned)height;
+    return 0;
+}
+
+/// Parses a comma-separated list of codepoints and inclusive codepoint ranges.
+static int parse_ranges(char const *str, struct args *as)
+{
+    as->range_count = 0;
+    for (char *end = NULL;; str = end + 1)
+    {
+        if (as->range_count == MAX_RANGES)
+            return -1;
+
+        unsigned long low = 0;
+        unsigned long high = 0;
+        if (parse_uint(str, MAX_CODE, &end, &low) != 0)
+            return -1;
+
+        high = low;
+        if (*end == '-' && parse_uint(end + 1, MAX_CODE, &end, &high) != 0)
+            return -1;
+
+        if (high < low)
+            return -1;
+
+        as->ranges[as->range_count++] = (code_range){ (uint32_t)low, (uint32_t)high };
+        if (*end == '\0')
+            return 0;
+
+        if (*end != ',')
+            return -1;
     }
+}
 
-    FT_GlyphSlot slot = NULL;
-    for (size_t i = 0; i < CODES_SIZE; ++i)
+static int parse_args(int argc, char *argv[], struct args *as)
+{
+    char *arg = NULL;
+    unsigned long threads = 0;
+    for (int i = 1; i < argc;)
     {
-        rc = FT_Load_Char(face, (FT_ULong)codes[i], FT_LOAD_NO_SCALE | FT_LOAD_MONOCHROME);
-        if (rc != 0)
+        arg = argv[i++];
+        if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0)
+            return -1;
+
+        if (arg[0] != '-')
         {
-            eprintf("FT_Load_Char failed.  Error code: %d", rc);
+            as->bmp_file = arg;
+            continue;
+        }
+        if (i >= argc)
             return -1;
+
+        char *end = NULL;
+        if (strcmp(arg, "-f") == 0 || strcmp(arg, "--font") == 0)
+            as->font_file = argv[i++];
+        else if (strcmp(arg, "-s") == 0 || strcmp(arg, "--size") == 0)
+        {
+            if (parse_size(argv[i++], as) != 0)
+                return -1;
         }
-        slot = face->glyph;
-        rc = FT_Render_Glyph(slot, FT_RENDER_MODE_MONO);
-        if (rc != 0)
+        else if (strcmp(arg, "-r") == 0 || strcmp(arg, "--ranges") == 0)
         {
-            eprintf("FT_Render_Glyph failed.  Error code: %d", rc);
-            return -1;
+            if (parse_ranges(argv[i++], as) != 0)
+                return -1;
+        }
+        else if (strcmp(arg, "-j") == 0 || strcmp(arg, "--threads") == 0)
+        {
+            if (parse_uint(argv[i++], UINT16_MAX, &end, &threads) != 0 || *end != '\0' || threads == 0)
+                return -1;
+
+            as->threads = (uint32_t)threads;
+        }
+        else if (strcmp(arg, "-d") == 0 || strcmp(arg, "--sdf") == 0)
+        {
+            unsigned long spread = 0;
+            if (parse_uint(argv[i++], MAX_SPREAD, &end, &spread) != 0 || *end != '\0' || spread == 0)
+                return -1;
+
+            as->sdf_spread = (unsigned)spread;
         }
-        assert(slot->format == FT_GLYPH_FORMAT_BITMAP);
-        assert(slot->bitmap.pixel_mode == FT_PIXEL_MODE_MONO);
-        render_bitmap_char(slot, image, CODES_SIZE, i);
+        else
+            return -1;
     }
+    return 0;
+}
 
+/// Replaces the extension of path, or appends one if it has none.
+static char *replace_ext(char const *path, char const *ext)
+{
+    char const *slash = strrchr(path, '/');
+    char const *dot = strrchr(path, '.');
+    size_t const stem = (dot != NULL && (slash == NULL || dot > slash)) ? (size_t)(dot - path) : strlen(path);
+    size_t const size = stem + strlen(ext) + 1;
+    char *ret = malloc(size);
+    if (ret == NULL)
+        return NULL;
+
+    memcpy(ret, path, stem);
+    memcpy(&ret[stem], ext, size - stem);
+    return ret;
+}
+
+static int in_ranges(struct args const *as, uint32_t code)
+{
+    for (size_t i = 0; i < as->range_count; ++i)
+    {
+        if (code >= as->ranges[i].low && code <= as->ranges[i].high)
+            return 1;
+    }
     return 0;
 }
 
-static int render_chars(char const codes[CODES_SIZE], char *image)
+// https://freetype.org/freetype2/docs/reference/ft2-basic_types.html#ft_bitmap
+static void render_bitmap_char(FT_GlyphSlot slot, bmp_pixel32 *target, size_t const stride)
 {
-    int ret = -1;
+    unsigned char const *buffer = slot->bitmap.buffer;
+    size_t const rows = (size_t)slot->bitmap.rows;
+    size_t const width = (size_t)slot->bitmap.width;
+    size_t const pitch = (size_t)abs(slot->bitmap.pitch);
 
-    FT_Library lib = NULL;
-    int rc = FT_Init_FreeType(&lib);
+    for (size_t y = 0, p = 0; y < rows; ++y, p += pitch)
+    {
+        bmp_convert_expand_mono(&target[y * stride], &buffer[p], width, &mono_table);
+    }
+}
+
+/// Opens the font at the requested size.  Every thread needs its own library
+/// and face, because FreeType faces must not be shared between threads.
+static int open_face(struct args const *as, FT_Library *lib, FT_Face *face)
+{
+    int rc = FT_Init_FreeType(lib);
     if (rc != 0)
     {
-        eprintf("FT_Init_FreeType failed.  Error code: %d", rc);
+        eprintf("FT_Init_FreeType failed.  Error code: %d\n", rc);
         return -1;
     }
 
-    FT_Face face = NULL;
-    rc = FT_New_Face(lib, FONT_FILE, 0, &face);
+    rc = FT_New_Face(*lib, as->font_file, 0, face);
     if (rc != 0)
     {
-        eprintf("FT_New_Face failed.  Error code: %d", rc);
+        eprintf("FT_New_Face failed.  Error code: %d\n", rc);
         goto out_done_lib;
     }
 
-    rc = render_bitmap_chars(face, codes, image);
+    // Scalable fonts are scaled to any size, bitmap fonts only have their strikes.
+    rc = FT_Set_Pixel_Sizes(*face, as->width, as->height);
     if (rc != 0)
     {
+        if (!FT_IS_SCALABLE(*face))
+            eprintf("%s has no %ux%u bitmap strike.\n", as->font_file, as->width, as->height);
+        else
+            eprintf("FT_Set_Pixel_Sizes failed.  Error code: %d\n", rc);
         goto out_done_face;
     }
+    return 0;
 
-    ret = 0;
 out_done_face:
-    FT_Done_Face(face);
+    FT_Done_Face(*face);
 out_done_lib:
+    FT_Done_FreeType(*lib);
+    return -1;
+}
+
+static void close_face(FT_Library lib, FT_Face face)
+{
+    FT_Done_Face(face);
     FT_Done_FreeType(lib);
+}
+
+/// Replaces the alpha of a glyph image with the signed distance field of its coverage.
+static int convert_to_sdf(bmp_pixel32 *image, size_t width, size_t height, unsigned spread)
+{
+    size_t const size = width * height;
+    uint8_t *mask = malloc(size * 2);
+    if (mask == NULL)
+        return -1;
+
+    uint8_t *const field = &mask[size];
+    for (size_t i = 0; i < size; ++i)
+        mask[i] = image[i].a;
+
+    int const rc = sdf_generate(field, mask, width, height, (double)spread);
+    if (rc == 0)
+    {
+        for (size_t i = 0; i < size; ++i)
+            image[i] = (bmp_pixel32){ 0xFF, 0xFF, 0xFF, field[i] };
+    }
+    free(mask);
+    return rc;
+}
+
+static int render_bitmap_glyph(FT_Face face, unsigned spread, glyph_set *set, size_t i)
+{
+    atlas_glyph *const glyph = &set->metrics.glyphs[i];
+    int rc = FT_Load_Char(face, glyph->code, FT_LOAD_TARGET_MONO);
+    if (rc != 0)
+    {
+        eprintf("FT_Load_Char failed for U+%04X.  Error code: %d\n", (unsigned)glyph->code, rc);
+        return -1;
+    }
+    FT_GlyphSlot slot = face->glyph;
+    rc = FT_Render_Glyph(slot, FT_RENDER_MODE_MONO);
+    if (rc != 0)
+    {
+        eprintf("FT_Render_Glyph failed for U+%04X.  Error code: %d\n", (unsigned)glyph->code, rc);
+        return -1;
+    }
+    assert(slot->format == FT_GLYPH_FORMAT_BITMAP);
+    assert(slot->bitmap.pixel_mode == FT_PIXEL_MODE_MONO);
+
+    // A distance field reaches spread pixels past the edges of the bitmap.
+    unsigned const width = slot->bitmap.width + (2 * spread);
+    unsigned const rows = slot->bitmap.rows + (2 * spread);
+    if (width > MAX_SIZE || rows > MAX_SIZE)
+    {
+        eprintf("glyph U+%04X is too large.\n", (unsigned)glyph->code);
+        return -1;
+    }
+    glyph->width = (uint16_t)width;
+    glyph->height = (uint16_t)rows;
+    glyph->bearing_x = (int16_t)(slot->bitmap_left - (int)spread);
+    glyph->bearing_y = (int16_t)(slot->bitmap_top + (int)spread);
+    glyph->advance = (int16_t)(slot->advance.x >> 6);
+
+    set->images[i] = calloc(((size_t)width * rows) + 1, sizeof(bmp_pixel32));
+    if (set->images[i] == NULL)
+    {
+        eprintf("alloc_glyph failed.\n");
+        return -1;
+    }
+    if (spread == 0)
+    {
+        render_bitmap_char(slot, set->images[i], width);
+        return 0;
+    }
+
+    render_bitmap_char(slot, &set->images[i][(spread * width) + spread], width);
+    if (convert_to_sdf(set->images[i], width, rows, spread) != 0)
+    {
+        eprintf("sdf_generate failed for U+%04X.\n", (unsigned)glyph->code);
+        return -1;
+    }
+    return 0;
+}
+
+/// Renders chunks of glyphs until none are left.
+static int render_worker(void *data)
+{
+    render_job *const job = data;
+    size_t const count = job->set->metrics.count;
+
+    FT_Library lib = NULL;
+    FT_Face face = NULL;
+    if (open_face(job->as, &lib, &face) != 0)
+    {
+        atomic_store(&job->failed, 1);
+        return -1;
+    }
+
+    int ret = 0;
+    while (ret == 0 && atomic_load_explicit(&job->failed, memory_order_relaxed) == 0)
+    {
+        size_t const begin = atomic_fetch_add_explicit(&job->next, CHUNK_SIZE, memory_order_relaxed);
+        if (begin >= count)
+            break;
+
+        size_t const end = (count - begin < CHUNK_SIZE) ? count : begin + CHUNK_SIZE;
+        for (size_t i = begin; i < end && ret == 0; ++i)
+        {
+            ret = render_bitmap_glyph(face, job->as->sdf_spread, job->set, i);
+        }
+    }
+    if (ret != 0)
+        atomic_store(&job->failed, 1);
+
+    close_face(lib, face);
     return ret;
 }
 
+/// Lists the codepoints of the font in the requested ranges, and the line metrics.
+static int collect_codes(struct args const *as, glyph_set *set)
+{
+    FT_Library lib = NULL;
+    FT_Face face = NULL;
+    if (open_face(as, &lib, &face) != 0)
+        return -1;
+
+    int ret = -1;
+    set->metrics.line_height = (int32_t)(face->size->metrics.height >> 6);
+    set->metrics.ascent = (int32_t)(face->size->metrics.ascender >> 6);
+
+    size_t count = 0;
+    size_t capacity = 256;
+    atlas_glyph *glyphs = calloc(capacity, sizeof(*glyphs));
+    if (glyphs == NULL)
+        goto out_close_face;
+
+    FT_UInt index = 0;
+    for (FT_ULong code = FT_Get_First_Char(face, &index); index != 0; code = FT_Get_Next_Char(face, code, &index))
+    {
+        if (code > MAX_CODE || !in_ranges(as, (uint32_t)code))
+            continue;
+
+        if (count == capacity)
+        {
+            capacity *= 2;
+            atlas_glyph *grown = realloc(glyphs, capacity * sizeof(*glyphs));
+            if (grown == NULL)
+            {
+                free(glyphs);
+                goto out_close_face;
+            }
+            glyphs = grown;
+        }
+        glyphs[count++] = (atlas_glyph){ .code = (uint32_t)code };
+    }
+
+    set->images = calloc(count + 1, sizeof(*set->images));
+    if (set->images == NULL)
+    {
+        free(glyphs);
+        goto out_close_face;
+    }
+    set->metrics.glyphs = glyphs;
+    set->metrics.count = count;
+
+    ret = 0;
+out_close_face:
+    close_face(lib, face);
+    return ret;
+}
+
+/// Renders every glyph in the set across the given number of threads.
+static int render_glyphs(struct args const *as, glyph_set *set)
+{
+    render_job job = { .as = as, .set = set };
+    atomic_init(&job.next, 0);
+    atomic_init(&job.failed, 0);
+
+    size_t const chunks = (set->metrics.count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    uint32_t const threads = (chunks < as->threads) ? (uint32_t)SDL_max(chunks, 1) : as->threads;
+    SDL_Thread **workers = calloc(threads, sizeof(*workers));
+    if (workers == NULL)
+        return -1;
+
+    uint32_t started = 0;
+    for (; started < threads; ++started)
+    {
+        workers[started] = SDL_CreateThread(render_worker, "render_worker", &job);
+        if (workers[started] == NULL)
+        {
+            eprintf("SDL_CreateThread failed: %s\n", SDL_GetError());
+            atomic_store(&job.failed, 1);
+            break;
+        }
+    }
+    for (uint32_t i = 0; i < started; ++i)
+    {
+        SDL_WaitThread(workers[i], NULL);
+    }
+    free(workers);
+    return atomic_load(&job.failed) ? -1 : 0;
+}
+
+static void free_glyphs(glyph_set *set)
+{
+    for (size_t i = 0; set->images != NULL && i < set->metrics.count; ++i)
+        free(set->images[i]);
+
+    free(set->images);
+    atlas_metrics_free(&set->metrics);
+}
+
+/// Places every glyph in the atlas and sets the atlas size.
+static int pack_glyphs(glyph_set *set)
+{
+    atlas_metrics *const metrics = &set->metrics;
+    atlas_rect *rects = calloc(metrics->count + 1, sizeof(*rects));
+    if (rects == NULL)
+    {
+        eprintf("alloc_rects failed.\n");
+        return -1;
+    }
+    for (size_t i = 0; i < metrics->count; ++i)
+    {
+        rects[i].width = metrics->glyphs[i].width;
+        rects[i].height = metrics->glyphs[i].height;
+    }
+
+    int const rc = atlas_pack(rects, metrics->count, PADDING, MAX_SIZE, &metrics->width, &metrics->height);
+    if (rc != 0)
+    {
+        eprintf("atlas_pack failed.\n");
+        free(rects);
+        return -1;
+    }
+    for (size_t i = 0; i < metrics->count; ++i)
+    {
+        metrics->glyphs[i].x = (uint16_t)rects[i].x;
+        metrics->glyphs[i].y = (uint16_t)rects[i].y;
+    }
+    free(rects);
+    return 0;
+}
+
+/// Copies the glyph images to their places in the atlas.
+static void draw_glyphs(glyph_set const *set, bmp_pixel32 *image)
+{
+    atlas_metrics const *const metrics = &set->metrics;
+    for (size_t i = 0; i < (size_t)metrics->width * metrics->height; ++i)
+        image[i] = WHITE;
+
+    for (size_t i = 0; i < metrics->count; ++i)
+    {
+        atlas_glyph const *g = &metrics->glyphs[i];
+        for (size_t y = 0; y < g->height; ++y)
+        {
+            memcpy(&image[((g->y + y) * metrics->width) + g->x], &set->images[i][y * g->width], g->width * sizeof(*image));
+        }
+    }
+}
+
 #ifdef DRAW_IMAGE
-static void draw_image(char const *image, size_t const width, size_t const height)
+static void draw_image(bmp_pixel32 const *image, size_t const width, size_t const height)
 {
     for (size_t y = 0; y < height; ++y)
     {
         printf("%2zd|", y);
 
         for (size_t x = 0; x < width; ++x)
-            putchar(image[(y * width) + x] ? '*' : ' ');
+            putchar(image[(y * width) + x].a ? '*' : ' ');
 
         printf("|\n");
     }
 }
 #else
 static inline void draw_image(
-    __attribute__((unused)) char const *image,
+    __attribute__((unused)) bmp_pixel32 const *image,
     __attribute__((unused)) size_t const width,
     __attribute__((unused)) size_t const height)
 {
 }
 #endif
 
-int main(void)
+static int write_atlas(char const *file, bmp_pixel32 const *image, size_t const width, size_t const height)
 {
-    int ret = EXIT_FAILURE;
+    bmp_writer *writer = bmp_writer_open(file, width, height, 32);
+    if (writer == NULL)
+    {
+        eprintf("bmp_writer_open failed.\n");
+        return -1;
+    }
 
-    char codes[CODES_SIZE] = { 0 };
-    for (int i = 0; i < CODES_SIZE; ++i)
-        codes[i] = (char)(i + LOW);
+    int const rc = bmp_writer_write_rows(writer, image, height);
+    int const close_rc = bmp_writer_close(writer);
+    if (rc != 0 || close_rc != 0)
+    {
+        eprintf("writing %s failed.\n", file);
+        return -1;
+    }
+    return 0;
+}
 
-    size_t const width = (size_t)WIDTH * CODES_SIZE;
-    size_t const height = HEIGHT;
-    char *image = calloc(width * height, sizeof(*image));
-    if (image == NULL)
+int main(int argc, char *argv[])
+{
+    int ret = EXIT_FAILURE;
+
+    int const cpus = SDL_GetCPUCount();
+    struct args as = {
+        .font_file = DEFAULT_FONT_FILE,
+        .bmp_file = DEFAULT_BMP_FILE,
+        .width = DEFAULT_WIDTH,
+        .height = DEFAULT_HEIGHT,
+        .threads = (uint32_t)SDL_max(cpus, 1),
+        .range_count = 1,
+        .ranges = { { DEFAULT_LOW, DEFAULT_HIGH } },
+    };
+    if (parse_args(argc, argv, &as) != 0)
     {
-        eprintf("alloc_image failed.");
+        usage(argv[0]);
         return EXIT_FAILURE;
     }
 
-    int rc = render_chars(codes, image);
+    char *metrics_file = replace_ext(as.bmp_file, METRICS_EXT);
+    if (metrics_file == NULL)
+        return EXIT_FAILURE;
+
+    bmp_convert_mono_table_init(&mono_table, WHITE, BLACK);
+
+    glyph_set set = { 0 };
+    int rc = collect_codes(&as, &set);
     if (rc != 0)
-        goto out_free_image;
+        goto out_free_metrics_file;
 
+    set.metrics.sdf_spread = as.sdf_spread;
+    if (set.metrics.count == 0)
+    {
+        eprintf("%s has no glyphs in the requested ranges.\n", as.font_file);
+        goto out_free_glyphs;
+    }
+
+    rc = render_glyphs(&as, &set);
+    if (rc != 0)
+        goto out_free_glyphs;
+
+    rc = pack_glyphs(&set);
+    if (rc != 0)
+        goto out_free_glyphs;
+
+    size_t const width = set.metrics.width;
+    size_t const height = set.metrics.height;
+    bmp_pixel32 *image = calloc(width * height, sizeof(*image));
+    if (image == NULL)
+    {
+        eprintf("alloc_image failed.\n");
+        goto out_free_glyphs;
+    }
+
+    draw_glyphs(&set, image);
     draw_image(image, width, height);
 
-    bmp_pixel32 *buffer = calloc(width * height, sizeof(*buffer));
-    if (buffer == NULL)
+    rc = write_atlas(as.bmp_file, image, width, height);
+    if (rc != 0)
         goto out_free_image;
 
-    for (size_t y = height, i = 0; y-- > 0;)
-        for (size_t x = 0; x < width; ++x, ++i)
-            buffer[i] = image[(y * width) + x] ? BLACK : WHITE;
-
-    rc = bmp_v4_write(buffer, width, height, BMP_FILE);
+    rc = atlas_metrics_write(&set.metrics, metrics_file);
     if (rc != 0)
     {
-        eprintf("bmp_v4_write failed.  Error code: %d", rc);
-        goto out_free_buffer;
+        eprintf("writing %s failed.\n", metrics_file);
+        goto out_free_image;
     }
 
     ret = EXIT_SUCCESS;
-out_free_buffer:
-    free(buffer);
 out_free_image:
     free(image);
+out_free_glyphs:
+    free_glyphs(&set);
+out_free_metrics_file:
+    free(metrics_file);
     return ret;
 }
@@ -1,5 +1,7 @@
 #include <assert.h>
 #include <float.h>
+#include <inttypes.h>
+#include <limits.h>
 #include <math.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -11,14 +13,26 @@
 #include <lua.h>
 #include <lualib.h>
 
+#include "asset_loader.h"
+#include "atlas.h"
+#include "audio_latency.h"
+#include "audio_timing.h"
+#include "bmp.h"
 #include "macro.h"
 #include "message_queue.h"
+#include "mixer.h"
 #include "prelude_sdl.h"
 #include "prelude_stdlib.h"
+#include "sample_bank.h"
+#include "text.h"
+#include "text_cache.h"
 
 enum
 {
     AUDIO_NUM_CHANNELS = 2,
+    AUDIO_MAX_COMMANDS = 256,
+    AUDIO_MIN_FRAMES = 64,   // Smallest buffer size accepted from the config
+    AUDIO_MAX_FRAMES = 4096, // Largest buffer size, for the config and for adapting
     CENTERED = SDL_WINDOWPOS_CENTERED,
 };
 
@@ -57,6 +71,37 @@ static char const *const WINDOW_TYPE_STR[] = {
 #undef X
 };
 
+/// Bitmaps loaded from the asset directory at startup.
+#define ASSET_VARIANTS        \
+    X(ASSET_TEST, "test.bmp") \
+    X(ASSET_FONT, "10x20.bmp")
+
+enum
+{
+#define X(variant, file) variant,
+    ASSET_VARIANTS
+#undef X
+    ASSET_MAX,
+};
+
+static char const *const ASSETS[] = {
+#define X(variant, file) [variant] = (file),
+    ASSET_VARIANTS
+#undef X
+};
+
+/// Directory under the asset directory holding decoded assets.
+static char const *const ASSET_CACHE_DIR = ".cache";
+
+/// Glyph metrics of ASSET_FONT, written next to it by generate_atlas_from_bdf.
+static char const *const FONT_METRICS = "10x20.atlas";
+
+/// Short sound loaded whole from the asset directory, played with F2.
+static char const *const SOUND_EFFECT = "effect.wav";
+
+/// Long track streamed from the asset directory, muted and unmuted with F3.
+static char const *const SOUND_MUSIC = "music.wav";
+
 struct config
 {
     int window_type;
@@ -66,16 +111,27 @@ struct config
     int height;
     int frame_rate;
     char *asset_dir;
+    int audio_buffer_size; ///< Samples per buffer, or the smallest if adaptive
+    int audio_adaptive;    ///< Non-zero to grow the buffer while the audio glitches
 };
 
 struct audio_state
 {
-    int const sample_rate;      ///< Samples per second
-    uint16_t const buffer_size; ///< Samples per buffer
-    double const frequency;     ///< Frequency of the sine wave
-    double const max_volume;    ///< Maximum volume
-    double volume;              ///< Current volume, 0.0 to max_volume
-    uint64_t elapsed;           ///< Number of buffer fills
+    int const sample_rate;        ///< Samples per second
+    uint16_t buffer_size;         ///< Samples per buffer of the open device
+    uint32_t const max_voices;    ///< Voices the mixer can play at once
+    double const frequency;       ///< Frequency of the sine wave
+    double const max_volume;      ///< Maximum volume
+    struct mixer *mixer;          ///< Mixes every voice in the audio callback
+    uint32_t tone;                ///< Voice playing the sine wave, while tone_stat is 1
+    struct sample_bank *bank;     ///< Sounds in the output format of the mixer
+    struct sample const *effect;  ///< SOUND_EFFECT, NULL if it could not be loaded
+    struct sample_stream *music;  ///< SOUND_MUSIC, NULL if it could not be opened
+    uint32_t music_voice;         ///< Voice playing the music, audible while music_stat is 1
+    struct audio_timing *timing;  ///< Timing of every callback
+    uint32_t overruns;            ///< Overruns already logged
+    uint32_t gaps;                ///< Gaps already logged
+    struct audio_latency latency; ///< Picks buffer_size, if cfg.audio_adaptive
 };
 
 struct state
@@ -84,6 +140,7 @@ struct state
     struct audio_state audio;
     int loop_stat;
     int tone_stat;
+    int music_stat;
 };
 
 struct window
@@ -94,6 +151,12 @@ struct window
 
 static double const SECOND = 1000.0;
 
+static SDL_Color const HUD_COLOR = { 0xFF, 0xFF, 0x00, 0xFF };
+static float const HUD_MARGIN = 8.0f;
+
+/// Memory for cached text layouts, enough for a few screens of HUD text.
+static size_t const TEXT_CACHE_BUDGET = 256 * 1024;
+
 static uint32_t const QUEUE_CAP = 4U;
 
 static uint64_t perf_freq = 0;
@@ -108,20 +171,31 @@ static struct config cfg = {
     .height = 720,
     .frame_rate = 60,
     .asset_dir = "./assets",
+    .audio_buffer_size = 256,
+    .audio_adaptive = 1,
 };
 
 static struct state st = {
     .audio_device = 0,
     .audio = {
         .sample_rate = 48000,
-        .buffer_size = 2048,
+        .buffer_size = 0,
+        .max_voices = 128,
         .frequency = 440.0,
         .max_volume = 0.25,
-        .volume = 0.0,
-        .elapsed = 0,
+        .mixer = NULL,
+        .tone = 0,
+        .bank = NULL,
+        .effect = NULL,
+        .music = NULL,
+        .music_voice = 0,
+        .timing = NULL,
+        .overruns = 0,
+        .gaps = 0,
     },
     .loop_stat = 1,
     .tone_stat = 0,
+    .music_stat = 0,
 };
 
 /// Parses command line arguments and populates args with the results.
@@ -202,9 +276,33 @@ static int load_config(char const *file, struct config *cfg)
         goto out_close_state;
     }
 
-    cfg->width = (int)lua_tonumber(state, -3);
-    cfg->height = (int)lua_tonumber(state, -2);
-    cfg->frame_rate = (int)lua_tonumber(state, -1);
+    // The audio settings are optional.
+    lua_getglobal(state, "audio_buffer_size");
+    lua_getglobal(state, "audio_adaptive");
+    int audio_buffer_size = cfg->audio_buffer_size;
+    if (!lua_isnil(state, -2))
+    {
+        audio_buffer_size = lua_isnumber(state, -2) ? (int)lua_tonumber(state, -2) : 0;
+        if (audio_buffer_size < AUDIO_MIN_FRAMES || audio_buffer_size > AUDIO_MAX_FRAMES
+            || (audio_buffer_size & (audio_buffer_size - 1)) != 0)
+        {
+            SDL_LogError(ERR, "%s: audio_buffer_size is not a power of two from %d to %d", __func__, AUDIO_MIN_FRAMES,
+                         AUDIO_MAX_FRAMES);
+            goto out_close_state;
+        }
+    }
+    if (!lua_isnil(state, -1) && !lua_isboolean(state, -1))
+    {
+        SDL_LogError(ERR, "%s: audio_adaptive is not a boolean", __func__);
+        goto out_close_state;
+    }
+
+    cfg->width = (int)lua_tonumber(state, -5);
+    cfg->height = (int)lua_tonumber(state, -4);
+    cfg->frame_rate = (int)lua_tonumber(state, -3);
+    cfg->audio_buffer_size = audio_buffer_size;
+    if (!lua_isnil(state, -1))
+        cfg->audio_adaptive = lua_toboolean(state, -1);
 
     ret = 0;
 out_close_state:
@@ -212,36 +310,6 @@ out_close_state:
     return ret;
 }
 
-/// Calculates a sine wave and write it to the stream.
-///
-/// @param userdata The userdata passed to SDL_OpenAudioDevice
-/// @param stream The stream to write to
-/// @param len The length of the stream
-static void calc_sine(void *userdata, uint8_t *stream, int len)
-{
-    struct audio_state *as = userdata;
-    float *const fstream = (float *)stream;
-
-    STATIC_ASSERT(sizeof(*fstream) == 4);
-    STATIC_ASSERT(AUDIO_NUM_CHANNELS != 0);
-    assert((len / ((int)sizeof(*fstream) * AUDIO_NUM_CHANNELS)) == as->buffer_size);
-    (void)len;
-
-    double const sample_rate = (double)as->sample_rate;
-    uint64_t const buffer_size = (uint64_t)as->buffer_size;
-    uint64_t const offset = as->elapsed * buffer_size;
-
-    for (uint64_t i = 0; i < buffer_size; ++i)
-    {
-        double const time = (double)(offset + i) / sample_rate;
-        double const x = 2.0 * M_PI * time * as->frequency;
-        double const y = as->volume * sin(x);
-        fstream[(AUDIO_NUM_CHANNELS * i) + 0] = (float)y;
-        fstream[(AUDIO_NUM_CHANNELS * i) + 1] = (float)y;
-    }
-    as->elapsed += 1;
-}
-
 /// Calculates the time in milliseconds for a frame.
 ///
 /// @param frame_rate The frame rate
@@ -386,54 +454,197 @@ static int get_rect(struct window win[static 1], SDL_Rect rect[static 1])
     return 0;
 }
 
-/// Creates a texture from a bitmap file.
+/// Creates a texture from a decoded asset.
+///
+/// Must be called on the render thread.
 ///
 /// @param win The window.
-/// @param path The path to the bitmap file.
+/// @param asset The decoded asset.
 /// @return The texture on success, NULL on failure.
-static SDL_Texture *create_texture(struct window win[static 1], char const path[static 1])
+static SDL_Texture *create_texture(struct window win[static 1], struct asset const asset[static 1])
 {
-    SDL_Surface *surface = SDL_LoadBMP(path);
-    if (surface == NULL)
+    if (asset->width > INT_MAX / sizeof(*asset->pixels) || asset->height > INT_MAX)
     {
-        log_sdl_error("SDL_LoadBMP failed");
+        SDL_LogError(ERR, "bitmap too large: %s", ASSETS[asset->id]);
         return NULL;
     }
-    SDL_Texture *texture = SDL_CreateTextureFromSurface(win->renderer, surface);
-    SDL_FreeSurface(surface);
+
+    int const width = (int)asset->width;
+    int const height = (int)asset->height;
+    SDL_Texture *texture = SDL_CreateTexture(win->renderer, SDL_PIXELFORMAT_BGRA32, SDL_TEXTUREACCESS_STATIC, width, height);
     if (texture == NULL)
     {
-        log_sdl_error("SDL_CreateTextureFromSurface failed");
+        log_sdl_error("SDL_CreateTexture failed");
+        return NULL;
+    }
+    int const rc = SDL_UpdateTexture(texture, NULL, asset->pixels, width * (int)sizeof(*asset->pixels));
+    if (rc != 0)
+    {
+        log_sdl_error("SDL_UpdateTexture failed");
+        SDL_DestroyTexture(texture);
         return NULL;
     }
+    (void)SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
     return texture;
 }
 
+/// Destroys the textures created by load_assets().
+///
+/// @param textures The textures, NULL entries are skipped.
+static void destroy_textures(SDL_Texture *textures[static ASSET_MAX])
+{
+    for (size_t i = 0; i < ASSET_MAX; ++i)
+    {
+        if (textures[i] != NULL)
+        {
+            SDL_DestroyTexture(textures[i]);
+            textures[i] = NULL;
+        }
+    }
+}
+
+/// Creates the text renderer from the font atlas and its metrics.
+///
+/// @param win The window.
+/// @param asset The decoded font atlas.
+/// @return The text renderer on success, NULL on failure.
+static struct text_renderer *create_text(struct window win[static 1], struct asset const asset[static 1])
+{
+    char *const path = joinpath2(cfg.asset_dir, FONT_METRICS);
+    atlas_metrics metrics;
+    int const rc = atlas_metrics_read(path, &metrics);
+    free(path);
+    if (rc != 0)
+    {
+        SDL_LogError(ERR, "atlas_metrics_read failed: %s", FONT_METRICS);
+        return NULL;
+    }
+    if (metrics.width != asset->width || metrics.height != asset->height)
+    {
+        SDL_LogError(ERR, "%s does not match %s", FONT_METRICS, ASSETS[asset->id]);
+        atlas_metrics_free(&metrics);
+        return NULL;
+    }
+
+    struct text_renderer *text = text_renderer_create(win->renderer, &metrics, asset->pixels, TEXT_CACHE_BUDGET);
+    if (text == NULL)
+    {
+        log_sdl_error("text_renderer_create failed");
+        atlas_metrics_free(&metrics);
+    }
+    return text;
+}
+
+/// Loads every asset into a texture, and the font into a text renderer.
+///
+/// The bitmaps are decoded in parallel by an asset loader, and each one is
+/// uploaded as soon as it arrives, so the total time is bounded by the largest
+/// asset rather than by the sum of all of them.  Decoded pixels are cached
+/// under the asset directory, so later runs map them instead of decoding.
+///
+/// The font is generated rather than shipped, so failing to load it only
+/// disables text.
+///
+/// @param win The window.
+/// @param textures The textures, indexed like ASSETS, with no texture for ASSET_FONT.
+/// @param text The text renderer, NULL if the font could not be loaded.
+/// @return 0 on success, -1 on failure.
+static int load_assets(struct window win[static 1], SDL_Texture *textures[static ASSET_MAX], struct text_renderer **text)
+{
+    int const cpus = SDL_GetCPUCount();
+    uint32_t const threads = (uint32_t)SDL_clamp(cpus, 1, ASSET_MAX);
+    char *cache_dir = joinpath2(cfg.asset_dir, ASSET_CACHE_DIR);
+    if (asset_cache_init(cache_dir) != 0)
+    {
+        SDL_LogWarn(APP, "asset cache disabled: cannot create %s", cache_dir);
+        free(cache_dir);
+        cache_dir = NULL;
+    }
+    struct asset_loader *loader = asset_loader_create(threads, ASSET_MAX, cache_dir);
+    free(cache_dir);
+    if (loader == NULL)
+    {
+        SDL_LogError(ERR, "asset_loader_create failed");
+        return -1;
+    }
+
+    int ret = -1;
+    for (size_t i = 0; i < ASSET_MAX; ++i)
+    {
+        char *const path = joinpath2(cfg.asset_dir, ASSETS[i]);
+        if (path == NULL)
+            goto out_destroy_loader;
+
+        int const rc = asset_loader_submit(loader, path, (intptr_t)i);
+        free(path);
+        if (rc != 0)
+        {
+            SDL_LogError(ERR, "asset_loader_submit failed: %s", ASSETS[i]);
+            goto out_destroy_loader;
+        }
+    }
+
+    ret = 0;
+    struct asset asset;
+    int rc = 0;
+    while ((rc = asset_loader_get(loader, &asset)) == 0)
+    {
+        if (asset.id == ASSET_FONT)
+        {
+            *text = (asset.status == 0) ? create_text(win, &asset) : NULL;
+            asset_release(&asset);
+            if (*text == NULL)
+                SDL_LogWarn(APP, "text disabled: cannot load %s", ASSETS[ASSET_FONT]);
+            continue;
+        }
+        if (asset.status != 0)
+        {
+            SDL_LogError(ERR, "bmp_load failed: %s", ASSETS[asset.id]);
+            ret = -1;
+            continue;
+        }
+        textures[asset.id] = create_texture(win, &asset);
+        asset_release(&asset);
+        if (textures[asset.id] == NULL)
+            ret = -1;
+    }
+    if (rc < 0)
+    {
+        SDL_LogError(ERR, "asset_loader_get failed: %s", message_queue_failure_str(-rc));
+        ret = -1;
+    }
+
+out_destroy_loader:
+    asset_loader_destroy(loader);
+    if (ret != 0)
+    {
+        destroy_textures(textures);
+        text_renderer_destroy(*text);
+        *text = NULL;
+    }
+    return ret;
+}
+
 /// Handles events.
 ///
 /// @param data The data passed to the thread.
 /// @return 0 on success, -1 on failure.
 static int handle(void *data)
 {
-    struct message_queue *queue = data;
-    (void)queue;
+    struct message_spsc_queue *queue = data;
 
-    SDL_Event event = {
-        .user = {
-            .type = EVENT_0,
-            .code = 0,
-            .data1 = NULL,
-            .data2 = NULL,
-        },
+    struct message msg = {
+        .tag = MSG_TAG_SOME,
+        .value = 0,
     };
-    int const rc = SDL_PushEvent(&event);
-    if (rc == 0)
+    int const rc = message_spsc_queue_put(queue, &msg);
+    if (rc == 1)
     {
-        SDL_LogDebug(APP, "SDL_PushEvent filtered");
+        SDL_LogDebug(APP, "message_spsc_queue_put: queue full");
     }
     else if (rc < 0)
     {
-        log_sdl_error("SDL_PushEvent failed");
+        SDL_LogError(ERR, "message_spsc_queue_put failed: %s", message_queue_failure_str(-rc));
         return -1;
     }
     return 0;
@@ -451,12 +662,42 @@ static void handle_keydown(SDL_KeyboardEvent *key, struct state *st)
         st->loop_stat = 0;
         break;
     case SDLK_F1:
-        st->tone_stat = (st->tone_stat == 1) ? 0 : 1;
-        SDL_LockAudioDevice(st->audio_device);
-        st->audio.volume = st->tone_stat * st->audio.max_volume;
-        st->audio.elapsed = 0;
-        SDL_UnlockAudioDevice(st->audio_device);
+    {
+        struct audio_state *const audio = &st->audio;
+        int const rc = (st->tone_stat == 0)
+                         ? mixer_play_tone(audio->mixer, audio->frequency, (float)audio->max_volume, &audio->tone)
+                         : mixer_stop(audio->mixer, audio->tone);
+        if (rc == 0)
+            st->tone_stat = (st->tone_stat == 1) ? 0 : 1;
+        else
+            SDL_LogWarn(APP, "mixer_play_tone/mixer_stop failed: %d", rc);
+        break;
+    }
+    case SDLK_F2:
+    {
+        struct audio_state *const audio = &st->audio;
+        if (audio->effect == NULL)
+            break;
+        uint32_t voice = 0;
+        int const rc = mixer_play_samples(audio->mixer, audio->effect->samples, audio->effect->frames,
+                                          (float)audio->max_volume, 0, &voice);
+        if (rc != 0)
+            SDL_LogWarn(APP, "mixer_play_samples failed: %d", rc);
+        break;
+    }
+    case SDLK_F3:
+    {
+        struct audio_state *const audio = &st->audio;
+        if (audio->music == NULL)
+            break;
+        float const gain = (st->music_stat == 0) ? (float)audio->max_volume : 0.0f;
+        int const rc = mixer_set_gain(audio->mixer, audio->music_voice, gain);
+        if (rc == 0)
+            st->music_stat = (st->music_stat == 1) ? 0 : 1;
+        else
+            SDL_LogWarn(APP, "mixer_set_gain failed: %d", rc);
         break;
+    }
     default:
         break;
     }
@@ -496,15 +737,106 @@ static void handle_events(struct state *st)
     }
 }
 
+/// Drains messages sent by the handler thread.
+///
+/// @param queue The message queue.
+/// @param st The state.
+static void handle_messages(struct message_spsc_queue *queue, __attribute__((unused)) struct state *st)
+{
+    struct message msg = { 0 };
+    while (message_spsc_queue_try_get(queue, &msg) == 0)
+    {
+        SDL_LogDebug(APP, "MSG_TAG_%s: %" PRIdPTR, message_tag_str(msg.tag), msg.value);
+    }
+}
+
+/// Logs the audio callbacks that overran their deadline or started late since the last call.
+///
+/// @param audio The audio state.
+/// @param stats The timing of the open device.
+static void log_audio_glitches(struct audio_state audio[static 1], struct audio_timing_stats const stats[static 1])
+{
+    if (stats->overruns != audio->overruns)
+    {
+        SDL_LogWarn(APP, "audio callback overran its %.2f ms deadline %" PRIu32 " times, longest %.2f ms",
+                    stats->deadline_us / 1000.0, stats->overruns - audio->overruns, stats->max_duration_us / 1000.0);
+        audio->overruns = stats->overruns;
+    }
+    if (stats->gaps != audio->gaps)
+    {
+        SDL_LogWarn(APP, "audio callback started late %" PRIu32 " times, longest interval %.2f ms",
+                    stats->gaps - audio->gaps, stats->max_interval_us / 1000.0);
+        audio->gaps = stats->gaps;
+    }
+}
+
+/// Logs the non-empty buckets of a time histogram.
+///
+/// @param name The name of the histogram.
+/// @param histogram The histogram.
+static void log_time_histogram(char const *name, struct audio_timing_histogram const histogram[static 1])
+{
+    for (size_t i = 0; i < AUDIO_TIMING_BUCKETS; ++i)
+    {
+        if (histogram->counts[i] == 0)
+            continue;
+        uint32_t const low = (i == 0) ? 0 : 1U << i;
+        if (i == AUDIO_TIMING_BUCKETS - 1)
+            SDL_LogDebug(APP, "audio %s >= %" PRIu32 " us: %" PRIu32, name, low, histogram->counts[i]);
+        else
+            SDL_LogDebug(APP, "audio %s %" PRIu32 "-%" PRIu32 " us: %" PRIu32, name, low, (2U << i) - 1,
+                         histogram->counts[i]);
+    }
+}
+
+/// Logs the histograms of the audio callback timing.
+///
+/// @param timing The timing.
+static void log_audio_timing(struct audio_timing const *timing)
+{
+    if (timing == NULL)
+        return;
+
+    struct audio_timing_stats stats;
+    audio_timing_read(timing, &stats);
+    SDL_LogDebug(APP, "audio: %" PRIu32 " callbacks, %.2f ms deadline, %" PRIu32 " overruns, %" PRIu32 " gaps",
+                 stats.callbacks, stats.deadline_us / 1000.0, stats.overruns, stats.gaps);
+    log_time_histogram("duration", &stats.duration);
+    log_time_histogram("interval", &stats.interval);
+    for (size_t i = 0; i < AUDIO_TIMING_BUCKETS; ++i)
+    {
+        if (stats.load[i] == 0)
+            continue;
+        if (i == AUDIO_TIMING_BUCKETS - 1)
+            SDL_LogDebug(APP, "audio load >= %zu%%: %" PRIu32, 10 * i, stats.load[i]);
+        else
+            SDL_LogDebug(APP, "audio load %zu-%zu%%: %" PRIu32, 10 * i, (10 * i) + 9, stats.load[i]);
+    }
+}
+
 static void update(__attribute__((unused)) double delta) { }
 
-/// Renders the texture to the window.
+/// Queues the frame statistics for drawing.
+///
+/// @param text The text renderer
+/// @param delta The time in milliseconds of the last frame
+/// @return 0 on success, -1 on failure.
+static int draw_hud(struct text_renderer *text, double delta)
+{
+    char hud[64];
+    (void)snprintf(hud, sizeof(hud), "%5.1f fps\n%5.2f ms", SECOND / delta, delta);
+    return text_draw(text, hud, HUD_MARGIN, HUD_MARGIN, HUD_COLOR);
+}
+
+/// Renders the texture to the window, with the HUD on top if there is text.
 ///
 /// @param renderer The renderer
 /// @param texture The texture
 /// @param win_rect The window rectangle
+/// @param text The text renderer, or NULL
+/// @param delta The time in milliseconds of the last frame
 /// @return 0 on success, -1 on failure.
-static int render(SDL_Renderer *renderer, SDL_Texture *texture, SDL_Rect *win_rect)
+static int render(SDL_Renderer *renderer, SDL_Texture *texture, SDL_Rect *win_rect, struct text_renderer *text, double delta)
 {
     int rc = SDL_RenderClear(renderer);
     if (rc != 0)
@@ -518,10 +850,156 @@ static int render(SDL_Renderer *renderer, SDL_Texture *texture, SDL_Rect *win_re
         log_sdl_error("SDL_RenderCopy failed");
         return -1;
     }
+    if (text != NULL)
+    {
+        rc = draw_hud(text, delta);
+        if (rc == 0)
+            rc = text_flush(text);
+        if (rc != 0)
+        {
+            log_sdl_error("drawing text failed");
+            return -1;
+        }
+    }
     SDL_RenderPresent(renderer);
     return 0;
 }
 
+/// Loads the sound effect and starts the music, muted.
+///
+/// Sounds are optional, so a missing or unreadable file only disables it.
+///
+/// @param audio The audio state, with the mixer and the sample bank created.
+static void load_sounds(struct audio_state audio[static 1])
+{
+    char *path = joinpath2(cfg.asset_dir, SOUND_EFFECT);
+    audio->effect = sample_bank_load(audio->bank, path);
+    free(path);
+    if (audio->effect == NULL)
+        SDL_LogWarn(APP, "sound disabled: cannot load %s", SOUND_EFFECT);
+
+    path = joinpath2(cfg.asset_dir, SOUND_MUSIC);
+    audio->music = sample_bank_open_stream(audio->bank, path, 1);
+    free(path);
+    if (audio->music == NULL)
+    {
+        SDL_LogWarn(APP, "music disabled: cannot open %s", SOUND_MUSIC);
+        return;
+    }
+    int const rc = mixer_play_source(audio->mixer, sample_stream_read, audio->music, 0.0f, &audio->music_voice);
+    if (rc != 0)
+    {
+        SDL_LogWarn(APP, "mixer_play_source failed: %d", rc);
+        audio->music = NULL;
+    }
+}
+
+/// Mixes the voices into the device buffer and records how long it took.
+///
+/// @param userdata The audio state.
+/// @param stream The stream to write to.
+/// @param len The length of the stream in bytes.
+static void audio_callback(void *userdata, uint8_t *stream, int len)
+{
+    struct audio_state *const audio = userdata;
+    uint64_t const begin = SDL_GetPerformanceCounter();
+    mixer_callback(audio->mixer, stream, len);
+    audio_timing_record(audio->timing, begin, SDL_GetPerformanceCounter());
+}
+
+/// Opens the audio device, starts timing its callback, and starts playing.
+///
+/// @param st The state, with the mixer created.
+/// @param frames Samples per buffer.
+/// @return 0 on success, -1 on failure.
+static int open_audio_device(struct state *st, uint16_t frames)
+{
+    SDL_AudioSpec want = {
+        .freq = st->audio.sample_rate,
+        .format = AUDIO_F32,
+        .channels = AUDIO_NUM_CHANNELS,
+        .samples = frames,
+        .callback = audio_callback,
+        .userdata = (void *)&st->audio,
+    };
+    SDL_AudioSpec have = { 0 };
+    st->audio_device = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
+    if (st->audio_device < 2)
+    {
+        log_sdl_error("SDL_OpenAudio failed");
+        st->audio_device = 0;
+        return -1;
+    }
+
+    // The device starts paused, so the callback cannot run before this.
+    st->audio.timing = audio_timing_create(have.freq, have.samples, perf_freq);
+    if (st->audio.timing == NULL)
+    {
+        SDL_LogError(ERR, "audio_timing_create failed");
+        SDL_CloseAudioDevice(st->audio_device);
+        st->audio_device = 0;
+        return -1;
+    }
+    st->audio.buffer_size = have.samples;
+    st->audio.overruns = 0;
+    st->audio.gaps = 0;
+    SDL_LogDebug(APP, "audio device: %d Hz, %u samples per buffer, %.2f ms", have.freq, have.samples,
+                 SECOND * have.samples / have.freq);
+
+    SDL_PauseAudioDevice(st->audio_device, 0);
+    return 0;
+}
+
+/// Closes the audio device, waiting for its callback to return.
+///
+/// @param st The state.
+static void close_audio_device(struct state *st)
+{
+    if (st->audio_device != 0)
+        SDL_CloseAudioDevice(st->audio_device);
+    st->audio_device = 0;
+    audio_timing_destroy(st->audio.timing);
+    st->audio.timing = NULL;
+}
+
+/// Logs audio glitches and, if adaptive, resizes the device buffer.
+///
+/// The mixer keeps every voice while the device is reopened, so sounds carry
+/// on after a short dropout.
+///
+/// @param st The state.
+static void update_audio(struct state *st)
+{
+    if (st->audio.timing == NULL)
+        return;
+
+    struct audio_timing_stats stats;
+    audio_timing_read(st->audio.timing, &stats);
+    log_audio_glitches(&st->audio, &stats);
+    if (!cfg.audio_adaptive)
+        return;
+
+    struct audio_latency *const latency = &st->audio.latency;
+    switch (audio_latency_update(latency, &stats))
+    {
+    case AUDIO_LATENCY_SETTLED:
+        SDL_LogInfo(APP, "audio latency settled at %u samples, %.2f ms", st->audio.buffer_size,
+                    stats.deadline_us / 1000.0);
+        break;
+    case AUDIO_LATENCY_RESIZE:
+    {
+        uint16_t const frames = (uint16_t)audio_latency_frames(latency);
+        SDL_LogInfo(APP, "audio buffer resized from %u to %u samples", st->audio.buffer_size, frames);
+        close_audio_device(st);
+        if (open_audio_device(st, frames) != 0)
+            SDL_LogError(ERR, "audio disabled: cannot reopen the device");
+        break;
+    }
+    default:
+        break;
+    }
+}
+
 /// Initializes SDL with video and audio subsystems, sets up audio
 /// device, and registers events.
 ///
@@ -547,25 +1025,35 @@ int init(void)
     }
     assert(event_start == EVENT_0);
 
-    SDL_AudioSpec want = {
-        .freq = st.audio.sample_rate,
-        .format = AUDIO_F32,
-        .channels = 2,
-        .samples = st.audio.buffer_size,
-        .callback = calc_sine,
-        .userdata = (void *)&st.audio,
-    };
-    SDL_AudioSpec have = { 0 };
-    st.audio_device = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
-    if (st.audio_device < 2)
+    st.audio.mixer = mixer_create(st.audio.sample_rate, st.audio.max_voices, AUDIO_MAX_COMMANDS);
+    if (st.audio.mixer == NULL)
     {
-        log_sdl_error("SDL_OpenAudio failed");
+        SDL_LogError(ERR, "mixer_create failed");
         return -1;
     }
 
-    SDL_PauseAudioDevice(st.audio_device, 0);
+    st.audio.bank = sample_bank_create(st.audio.sample_rate);
+    if (st.audio.bank == NULL)
+    {
+        SDL_LogError(ERR, "sample_bank_create failed");
+        goto out_destroy_mixer;
+    }
+
+    load_sounds(&st.audio);
+
+    audio_latency_init(&st.audio.latency, (uint32_t)cfg.audio_buffer_size, AUDIO_MAX_FRAMES);
+    if (open_audio_device(&st, (uint16_t)audio_latency_frames(&st.audio.latency)) != 0)
+        goto out_destroy_bank;
 
     return 0;
+
+out_destroy_bank:
+    sample_bank_destroy(st.audio.bank);
+    st.audio.bank = NULL;
+out_destroy_mixer:
+    mixer_destroy(st.audio.mixer);
+    st.audio.mixer = NULL;
+    return -1;
 }
 
 int main(int argc, char *argv[])
@@ -590,19 +1078,15 @@ int main(int argc, char *argv[])
     if (rc != 0)
         goto out_destroy_window;
 
-    char const *const test_bmp = "test.bmp";
-    char *const bmp_file = joinpath2(cfg.asset_dir, test_bmp);
-    if (bmp_file == NULL)
-        goto out_destroy_window;
-
-    SDL_Texture *texture = create_texture(win, bmp_file);
-    free(bmp_file);
-    if (texture == NULL)
+    SDL_Texture *textures[ASSET_MAX] = { 0 };
+    struct text_renderer *text = NULL;
+    rc = load_assets(win, textures, &text);
+    if (rc != 0)
         goto out_destroy_window;
 
-    struct message_queue *const queue = message_queue_create(QUEUE_CAP);
+    struct message_spsc_queue *const queue = message_spsc_queue_create(QUEUE_CAP);
     if (queue == NULL)
-        goto out_destroy_texture;
+        goto out_message_queue_destroy;
 
     SDL_Thread *const handler = SDL_CreateThread(handle, "handler", queue);
     if (handler == NULL)
@@ -618,9 +1102,13 @@ int main(int argc, char *argv[])
     {
         handle_events(&st);
 
+        handle_messages(queue, &st);
+
+        update_audio(&st);
+
         update(delta);
 
-        rc = render(win->renderer, texture, &win_rect);
+        rc = render(win->renderer, textures[ASSET_TEST], &win_rect, text, delta);
         if (rc != 0)
             goto out_wait_thread;
 
@@ -632,16 +1120,31 @@ int main(int argc, char *argv[])
 
     SDL_PauseAudioDevice(st.audio_device, 1);
 
+    if (text != NULL)
+    {
+        struct text_cache_stats stats;
+        text_get_cache_stats(text, &stats);
+        SDL_LogDebug(APP, "text cache: %" PRIu64 " hits, %" PRIu64 " patches, %" PRIu64 " misses, %" PRIu64 " evictions",
+                     stats.hits, stats.patches, stats.misses, stats.evictions);
+    }
+
+    log_audio_timing(st.audio.timing);
+    SDL_LogDebug(APP, "mixer: %" PRIu32 " voices dropped", mixer_dropped_voices(st.audio.mixer));
+    if (st.audio.music != NULL)
+        SDL_LogDebug(APP, "music: %" PRIu32 " underruns", sample_stream_underruns(st.audio.music));
+
     ret = EXIT_SUCCESS;
 out_wait_thread:
     SDL_WaitThread(handler, NULL);
 out_message_queue_destroy:
-    message_queue_destroy(queue);
-out_destroy_texture:
-    SDL_DestroyTexture(texture);
+    message_spsc_queue_destroy(queue);
+    text_renderer_destroy(text);
+    destroy_textures(textures);
 out_destroy_window:
     window_destroy(win);
 out_close_audio_device:
-    SDL_CloseAudioDevice(st.audio_device);
+    close_audio_device(&st);
+    mixer_destroy(st.audio.mixer);
+    sample_bank_destroy(st.audio.bank);
     return ret;
 }
@@ -1,16 +1,47 @@
 #include "message_queue.h"
 
+#include <stdatomic.h>
+#include <string.h>
+
 #include <SDL.h>
 
+#include "macro.h"
+
+enum
+{
+    CACHE_LINE_SIZE = 64,
+    SPIN_LIMIT = 1024,
+};
+
+/// Rounds up to the next power of two, or returns 0 if the result does not fit.
+static uint32_t next_pow2(uint32_t n)
+{
+    if (n == 0 || n > (UINT32_C(1) << 31))
+    {
+        return 0;
+    }
+    n -= 1;
+    n |= n >> 1;
+    n |= n >> 2;
+    n |= n >> 4;
+    n |= n >> 8;
+    n |= n >> 16;
+    return n + 1;
+}
+
 struct message_queue
 {
-    struct message *buffer; // Buffer to hold messages
-    uint32_t capacity;      // Maximum size of the buffer
-    size_t front;           // Index of the front message in the buffer
-    size_t rear;            // Index of the rear message in the buffer
-    SDL_sem *empty;         // Semaphore to track empty slots in the buffer
-    SDL_sem *full;          // Semaphore to track filled slots in the buffer
-    SDL_mutex *lock;        // Mutex lock to protect buffer access
+    _Atomic uint32_t enqueue_pos; // Position of the next slot to fill, shared by producers
+    char enqueue_pad[CACHE_LINE_SIZE - sizeof(uint32_t)];
+    _Atomic uint32_t dequeue_pos; // Position of the next slot to drain, shared by consumers
+    char dequeue_pad[CACHE_LINE_SIZE - sizeof(uint32_t)];
+    _Atomic uint32_t sleepers;    // Number of consumers blocked on nonempty
+    _Atomic uint32_t producers;   // Number of puts in progress
+    _Atomic int closed;           // Non-zero once message_queue_close() has been called
+    struct message *buffer;       // Buffer to hold messages
+    _Atomic uint32_t *seqs;       // Sequence number of each slot in the buffer
+    uint32_t mask;                // Capacity minus one, capacity is a power of two
+    SDL_sem *nonempty;            // Semaphore posted for sleeping consumers when messages are added
 };
 
 static int message_queue_init(struct message_queue *queue, uint32_t capacity)
@@ -19,34 +50,39 @@ static int message_queue_init(struct message_queue *queue, uint32_t capacity)
     {
         return -MSGQ_FAILURE_NULL_POINTER;
     }
-    queue->buffer = calloc((size_t)capacity, sizeof(*queue->buffer));
+    // A queue always holds at least one message
+    uint32_t const cap = next_pow2((capacity == 0) ? 1 : capacity);
+    if (cap == 0)
+    {
+        return -MSGQ_FAILURE_MALLOC;
+    }
+    queue->buffer = calloc((size_t)cap, sizeof(*queue->buffer));
     if (queue->buffer == NULL)
     {
         return -MSGQ_FAILURE_MALLOC;
     }
-    queue->capacity = capacity;
-    queue->front = 0;
-    queue->rear = 0;
-    queue->empty = SDL_CreateSemaphore(capacity);
-    if (queue->empty == NULL)
+    queue->seqs = calloc((size_t)cap, sizeof(*queue->seqs));
+    if (queue->seqs == NULL)
     {
         free(queue->buffer);
-        return -MSGQ_FAILURE_SEM_CREATE;
+        return -MSGQ_FAILURE_MALLOC;
     }
-    queue->full = SDL_CreateSemaphore(0);
-    if (queue->full == NULL)
+    for (uint32_t i = 0; i < cap; ++i)
     {
-        SDL_DestroySemaphore(queue->empty);
-        free(queue->buffer);
-        return -MSGQ_FAILURE_SEM_CREATE;
+        atomic_init(&queue->seqs[i], i);
     }
-    queue->lock = SDL_CreateMutex();
-    if (queue->lock == NULL)
+    queue->mask = cap - 1;
+    atomic_init(&queue->enqueue_pos, 0);
+    atomic_init(&queue->dequeue_pos, 0);
+    atomic_init(&queue->sleepers, 0);
+    atomic_init(&queue->producers, 0);
+    atomic_init(&queue->closed, 0);
+    queue->nonempty = SDL_CreateSemaphore(0);
+    if (queue->nonempty == NULL)
     {
-        SDL_DestroySemaphore(queue->full);
-        SDL_DestroySemaphore(queue->empty);
+        free(queue->seqs);
         free(queue->buffer);
-        return -MSGQ_FAILURE_MUTEX_CREATE;
+        return -MSGQ_FAILURE_SEM_CREATE;
     }
     return 0;
 }
@@ -57,28 +93,21 @@ static void message_queue_finish(struct message_queue *queue)
     {
         return;
     }
-    queue->capacity = 0;
-    queue->front = 0;
-    queue->rear = 0;
+    queue->mask = 0;
     if (queue->buffer != NULL)
     {
         free(queue->buffer);
         queue->buffer = NULL;
     }
-    if (queue->empty != NULL)
-    {
-        SDL_DestroySemaphore(queue->empty);
-        queue->empty = NULL;
-    }
-    if (queue->full != NULL)
+    if (queue->seqs != NULL)
     {
-        SDL_DestroySemaphore(queue->full);
-        queue->full = NULL;
+        free(queue->seqs);
+        queue->seqs = NULL;
     }
-    if (queue->lock != NULL)
+    if (queue->nonempty != NULL)
     {
-        SDL_DestroyMutex(queue->lock);
-        queue->lock = NULL;
+        SDL_DestroySemaphore(queue->nonempty);
+        queue->nonempty = NULL;
     }
 }
 
@@ -108,69 +137,516 @@ void message_queue_destroy(struct message_queue *queue)
     free(queue);
 }
 
+/// Claims up to n consecutive slots whose sequence numbers are offset from their positions by lag.
+///
+/// Producers claim free slots (lag 0) and consumers claim filled slots (lag 1).
+///
+/// @param pos_counter The enqueue or dequeue position.
+/// @param first Set to the position of the first claimed slot.
+/// @return The number of slots claimed, or 0 if the queue is full (for producers) or empty (for consumers).
+static uint32_t message_queue_claim(struct message_queue *queue, _Atomic uint32_t *pos_counter, uint32_t lag, uint32_t n, uint32_t *first)
+{
+    uint32_t const mask = queue->mask;
+    uint32_t pos = atomic_load_explicit(pos_counter, memory_order_relaxed);
+    for (;;)
+    {
+        uint32_t const seq = atomic_load_explicit(&queue->seqs[pos & mask], memory_order_acquire);
+        int32_t const diff = (int32_t)(seq - (pos + lag));
+        if (diff < 0)
+        {
+            return 0;
+        }
+        if (diff > 0)
+        {
+            // Another thread claimed this slot, catch up
+            pos = atomic_load_explicit(pos_counter, memory_order_relaxed);
+            continue;
+        }
+        uint32_t k = 1;
+        while (k < n && k <= mask && atomic_load_explicit(&queue->seqs[(pos + k) & mask], memory_order_acquire) == pos + k + lag)
+        {
+            ++k;
+        }
+        if (atomic_compare_exchange_weak_explicit(pos_counter, &pos, pos + k, memory_order_relaxed, memory_order_relaxed))
+        {
+            *first = pos;
+            return k;
+        }
+    }
+}
+
+/// Releases n claimed slots starting at first, setting each sequence number to its position plus step.
+static void message_queue_publish(struct message_queue *queue, uint32_t first, uint32_t n, uint32_t step)
+{
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        uint32_t const pos = first + i;
+        atomic_store_explicit(&queue->seqs[pos & queue->mask], pos + step, memory_order_release);
+    }
+}
+
+/// Wakes up to n consumers that are blocked waiting for messages.
+static int message_queue_wake(struct message_queue *queue, uint32_t n)
+{
+    // Pairs with the fence in message_queue_get_timeout() so that either the sleeper sees the
+    // new messages or the close, or we see the sleeper.
+    atomic_thread_fence(memory_order_seq_cst);
+    uint32_t const sleepers = atomic_load_explicit(&queue->sleepers, memory_order_relaxed);
+    for (uint32_t i = 0, posts = SDL_min(n, sleepers); i < posts; ++i)
+    {
+        if (SDL_SemPost(queue->nonempty) < 0)
+        {
+            return -MSGQ_FAILURE_SEM_POST;
+        }
+    }
+    return 0;
+}
+
 int message_queue_put(struct message_queue *queue, struct message *in)
 {
-    int rc = SDL_SemTryWait(queue->empty);
-    if (rc == SDL_MUTEX_TIMEDOUT)
+    int const rc = message_queue_put_many(queue, in, 1);
+    if (rc < 0)
+    {
+        return rc;
+    }
+    return (rc == 0) ? 1 : 0;
+}
+
+int message_queue_put_many(struct message_queue *queue, struct message const *in, uint32_t n)
+{
+    if (queue == NULL || in == NULL)
+    {
+        return -MSGQ_FAILURE_NULL_POINTER;
+    }
+    // Count the put before checking for a close.  A consumer that sees the close then either sees
+    // the put in progress and waits for it, or sees it finished and its messages published.
+    atomic_fetch_add_explicit(&queue->producers, 1, memory_order_seq_cst);
+    int const closed = atomic_load_explicit(&queue->closed, memory_order_seq_cst);
+    uint32_t puts = 0;
+    if (closed == 0 && n > 0)
     {
-        return 1;
+        uint32_t pos = 0;
+        puts = message_queue_claim(queue, &queue->enqueue_pos, 0, n, &pos);
+        uint32_t const index = pos & queue->mask;
+        uint32_t const first = SDL_min(puts, queue->mask + 1 - index);
+        memcpy(&queue->buffer[index], in, first * sizeof(*in));
+        memcpy(queue->buffer, &in[first], (puts - first) * sizeof(*in));
+        message_queue_publish(queue, pos, puts, 1);
     }
+    atomic_fetch_sub_explicit(&queue->producers, 1, memory_order_seq_cst);
+    // Consumers that found the queue closed but this put in progress may have gone to sleep, so
+    // once the queue is closed every put wakes them all to check again.
+    int const closing = atomic_load_explicit(&queue->closed, memory_order_seq_cst);
+    int const rc = message_queue_wake(queue, (closing != 0) ? UINT32_MAX : puts);
     if (rc < 0)
     {
-        return -MSGQ_FAILURE_SEM_TRY_WAIT;
+        return rc;
     }
-    rc = SDL_LockMutex(queue->lock);
-    if (rc == -1)
+    return (closed != 0) ? -MSGQ_FAILURE_CLOSED : (int)puts;
+}
+
+int message_queue_get_many(struct message_queue *queue, struct message *out, uint32_t max)
+{
+    if (queue == NULL || out == NULL)
     {
-        return -MSGQ_FAILURE_MUTEX_LOCK;
+        return -MSGQ_FAILURE_NULL_POINTER;
     }
-    queue->buffer[queue->rear] = *in;
-    queue->rear = (queue->rear + 1) % queue->capacity;
-    rc = SDL_UnlockMutex(queue->lock);
-    if (rc == -1)
+    uint32_t pos = 0;
+    uint32_t gets = (max == 0) ? 0 : message_queue_claim(queue, &queue->dequeue_pos, 1, max, &pos);
+    if (gets == 0)
     {
-        return -MSGQ_FAILURE_MUTEX_UNLOCK;
+        // Once closed, the queue is drained only when no put is in progress and nothing was
+        // published since the claim above.  Pairs with the counter in message_queue_put_many().
+        if (atomic_load_explicit(&queue->closed, memory_order_seq_cst) == 0
+            || atomic_load_explicit(&queue->producers, memory_order_seq_cst) != 0)
+        {
+            return 0;
+        }
+        gets = (max == 0) ? 0 : message_queue_claim(queue, &queue->dequeue_pos, 1, max, &pos);
+        if (gets == 0)
+        {
+            return -MSGQ_FAILURE_CLOSED;
+        }
     }
-    rc = SDL_SemPost(queue->full);
+    uint32_t const index = pos & queue->mask;
+    uint32_t const first = SDL_min(gets, queue->mask + 1 - index);
+    memcpy(out, &queue->buffer[index], first * sizeof(*out));
+    memcpy(&out[first], queue->buffer, (gets - first) * sizeof(*out));
+    message_queue_publish(queue, pos, gets, queue->mask + 1);
+    return (int)gets;
+}
+
+int message_queue_try_get(struct message_queue *queue, struct message *out)
+{
+    int const rc = message_queue_get_many(queue, out, 1);
     if (rc < 0)
     {
-        return -MSGQ_FAILURE_SEM_POST;
+        return rc;
+    }
+    return (rc == 0) ? 1 : 0;
+}
+
+int message_queue_get_timeout(struct message_queue *queue, struct message *out, uint32_t ms)
+{
+    uint32_t const start = SDL_GetTicks();
+    for (uint32_t spins = 0;; ++spins)
+    {
+        int rc = message_queue_try_get(queue, out);
+        if (rc != 1 || ms == 0)
+        {
+            return rc;
+        }
+        if (spins < SPIN_LIMIT)
+        {
+            continue;
+        }
+        uint32_t wait = SDL_MUTEX_MAXWAIT;
+        if (ms != SDL_MUTEX_MAXWAIT)
+        {
+            uint32_t const elapsed = SDL_GetTicks() - start;
+            if (elapsed >= ms)
+            {
+                return 1;
+            }
+            wait = ms - elapsed;
+        }
+        // The queue is truly empty, so sleep until a producer or message_queue_close() wakes us
+        atomic_fetch_add_explicit(&queue->sleepers, 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        rc = message_queue_try_get(queue, out);
+        if (rc == 1 && SDL_SemWaitTimeout(queue->nonempty, wait) < 0)
+        {
+            rc = -MSGQ_FAILURE_SEM_WAIT;
+        }
+        atomic_fetch_sub_explicit(&queue->sleepers, 1, memory_order_relaxed);
+        if (rc != 1)
+        {
+            return rc;
+        }
     }
-    return 0;
 }
 
 int message_queue_get(struct message_queue *queue, struct message *out)
 {
-    int rc = SDL_SemWait(queue->full);
-    if (rc < 0)
+    return message_queue_get_timeout(queue, out, SDL_MUTEX_MAXWAIT);
+}
+
+void message_queue_close(struct message_queue *queue)
+{
+    if (queue == NULL)
     {
-        return -MSGQ_FAILURE_SEM_WAIT;
+        return;
     }
-    rc = SDL_LockMutex(queue->lock);
-    if (rc == -1)
+    atomic_store_explicit(&queue->closed, 1, memory_order_seq_cst);
+    (void)message_queue_wake(queue, UINT32_MAX);
+}
+
+uint32_t message_queue_size(struct message_queue *queue)
+{
+    if (queue == NULL)
     {
-        return -MSGQ_FAILURE_MUTEX_LOCK;
+        return 0;
     }
-    *out = queue->buffer[queue->front];
-    queue->front = (queue->front + 1) % queue->capacity;
-    rc = SDL_UnlockMutex(queue->lock);
-    if (rc == -1)
+    uint32_t const dequeue_pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_acquire);
+    uint32_t const enqueue_pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_acquire);
+    return SDL_min(enqueue_pos - dequeue_pos, queue->mask + 1);
+}
+
+struct message_spsc_queue
+{
+    _Atomic uint32_t tail;   // Index of the next free slot, written by the producer
+    uint32_t cached_head;    // Producer's last observed value of head
+    char tail_pad[CACHE_LINE_SIZE - (2 * sizeof(uint32_t))];
+    _Atomic uint32_t head;   // Index of the next message, written by the consumer
+    uint32_t cached_tail;    // Consumer's last observed value of tail
+    char head_pad[CACHE_LINE_SIZE - (2 * sizeof(uint32_t))];
+    struct message *buffer;  // Buffer to hold messages
+    uint32_t mask;           // Capacity minus one, capacity is a power of two
+};
+
+struct message_spsc_queue *message_spsc_queue_create(uint32_t capacity)
+{
+    // A queue always holds at least one message
+    uint32_t const cap = next_pow2((capacity == 0) ? 1 : capacity);
+    if (cap == 0)
     {
-        return -MSGQ_FAILURE_MUTEX_UNLOCK;
+        return NULL;
     }
-    rc = SDL_SemPost(queue->empty);
-    if (rc < 0)
+    struct message_spsc_queue *queue = calloc(1, sizeof(*queue));
+    if (queue == NULL)
     {
-        return -MSGQ_FAILURE_SEM_POST;
+        return NULL;
     }
+    queue->buffer = calloc((size_t)cap, sizeof(*queue->buffer));
+    if (queue->buffer == NULL)
+    {
+        free(queue);
+        return NULL;
+    }
+    queue->mask = cap - 1;
+    atomic_init(&queue->tail, 0);
+    atomic_init(&queue->head, 0);
+    queue->cached_head = 0;
+    queue->cached_tail = 0;
+    return queue;
+}
+
+void message_spsc_queue_destroy(struct message_spsc_queue *queue)
+{
+    if (queue == NULL)
+    {
+        return;
+    }
+    free(queue->buffer);
+    free(queue);
+}
+
+int message_spsc_queue_put(struct message_spsc_queue *queue, struct message *in)
+{
+    if (queue == NULL || in == NULL)
+    {
+        return -MSGQ_FAILURE_NULL_POINTER;
+    }
+    uint32_t const tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    if (tail - queue->cached_head > queue->mask)
+    {
+        queue->cached_head = atomic_load_explicit(&queue->head, memory_order_acquire);
+        if (tail - queue->cached_head > queue->mask)
+        {
+            return 1;
+        }
+    }
+    queue->buffer[tail & queue->mask] = *in;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
     return 0;
 }
 
-uint32_t message_queue_size(struct message_queue *queue)
+int message_spsc_queue_try_get(struct message_spsc_queue *queue, struct message *out)
+{
+    if (queue == NULL || out == NULL)
+    {
+        return -MSGQ_FAILURE_NULL_POINTER;
+    }
+    uint32_t const head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    if (head == queue->cached_tail)
+    {
+        queue->cached_tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+        if (head == queue->cached_tail)
+        {
+            return 1;
+        }
+    }
+    *out = queue->buffer[head & queue->mask];
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return 0;
+}
+
+int message_spsc_queue_get(struct message_spsc_queue *queue, struct message *out)
+{
+    for (uint32_t spins = 0;; ++spins)
+    {
+        int const rc = message_spsc_queue_try_get(queue, out);
+        if (rc != 1)
+        {
+            return rc;
+        }
+        if (spins >= SPIN_LIMIT)
+        {
+            SDL_Delay(1);
+        }
+    }
+}
+
+uint32_t message_spsc_queue_size(struct message_spsc_queue *queue)
 {
     if (queue == NULL)
     {
         return 0;
     }
-    return SDL_SemValue(queue->full);
+    uint32_t const head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    uint32_t const tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    return tail - head;
+}
+
+typedef struct message_ring_header
+{
+    uint32_t size; // Payload size in bytes, or RING_NONE for padding up to the end of the ring
+    uint32_t tag;  // Message tag
+} message_ring_header;
+
+enum
+{
+    RING_ALIGN = 8,
+    RING_MIN_CAPACITY = 64,
+};
+
+STATIC_ASSERT(sizeof(message_ring_header) == RING_ALIGN);
+
+static uint32_t const RING_NONE = UINT32_MAX;
+
+struct message_ring
+{
+    _Atomic uint32_t tail;  // Byte position of the next record, written by the producer
+    uint32_t cached_head;   // Producer's last observed value of head
+    uint32_t reserved_pos;  // Position of the reserved record, after any padding
+    uint32_t reserved_size; // Size of the reserved payload, or RING_NONE
+    char tail_pad[CACHE_LINE_SIZE - (4 * sizeof(uint32_t))];
+    _Atomic uint32_t head;  // Byte position of the front record, written by the consumer
+    uint32_t cached_tail;   // Consumer's last observed value of tail
+    uint32_t read_size;     // Size of the payload being read, or RING_NONE
+    char head_pad[CACHE_LINE_SIZE - (3 * sizeof(uint32_t))];
+    unsigned char *buffer;  // Buffer to hold records
+    uint32_t mask;          // Capacity minus one, capacity is a power of two
+};
+
+/// Returns the size of the record holding a payload of the given size.
+static inline uint32_t message_ring_record_size(uint32_t size)
+{
+    return (uint32_t)sizeof(message_ring_header) + ((size + (RING_ALIGN - 1)) & ~(uint32_t)(RING_ALIGN - 1));
+}
+
+struct message_ring *message_ring_create(uint32_t capacity)
+{
+    uint32_t const cap = next_pow2(SDL_max(capacity, (uint32_t)RING_MIN_CAPACITY));
+    if (cap == 0)
+    {
+        return NULL;
+    }
+    struct message_ring *ring = calloc(1, sizeof(*ring));
+    if (ring == NULL)
+    {
+        return NULL;
+    }
+    ring->buffer = calloc((size_t)cap, sizeof(*ring->buffer));
+    if (ring->buffer == NULL)
+    {
+        free(ring);
+        return NULL;
+    }
+    ring->mask = cap - 1;
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->head, 0);
+    ring->cached_head = 0;
+    ring->cached_tail = 0;
+    ring->reserved_pos = 0;
+    ring->reserved_size = RING_NONE;
+    ring->read_size = RING_NONE;
+    return ring;
+}
+
+void message_ring_destroy(struct message_ring *ring)
+{
+    if (ring == NULL)
+    {
+        return;
+    }
+    free(ring->buffer);
+    free(ring);
+}
+
+int message_ring_reserve(struct message_ring *ring, uint32_t size, void **data)
+{
+    if (ring == NULL || data == NULL)
+    {
+        return -MSGQ_FAILURE_NULL_POINTER;
+    }
+    uint32_t const cap = ring->mask + 1;
+    // A record is its payload plus a header and alignment, and a record that wraps also
+    // needs the padding before it, which is just short of a record.  With payloads within
+    // a quarter of the ring, a record and its padding take at most cap / 2 + 8 bytes, which
+    // fits in an empty ring of at least RING_MIN_CAPACITY.  Half of the ring would not.
+    if (size > (cap / 4))
+    {
+        return -MSGQ_FAILURE_TOO_LARGE;
+    }
+    uint32_t const need = message_ring_record_size(size);
+    uint32_t const tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t const index = tail & ring->mask;
+    uint32_t const skip = (index + need > cap) ? cap - index : 0;
+    if (skip + need > cap - (tail - ring->cached_head))
+    {
+        ring->cached_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (skip + need > cap - (tail - ring->cached_head))
+        {
+            return 1;
+        }
+    }
+    ring->reserved_pos = tail + skip;
+    ring->reserved_size = size;
+    *data = &ring->buffer[(ring->reserved_pos & ring->mask) + sizeof(message_ring_header)];
+    return 0;
+}
+
+int message_ring_commit(struct message_ring *ring, enum message_tag tag, uint32_t size)
+{
+    if (ring == NULL)
+    {
+        return -MSGQ_FAILURE_NULL_POINTER;
+    }
+    if (ring->reserved_size == RING_NONE || size > ring->reserved_size)
+    {
+        return -MSGQ_FAILURE_NOT_PENDING;
+    }
+    uint32_t const tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    if (ring->reserved_pos != tail)
+    {
+        message_ring_header const pad = { .size = RING_NONE, .tag = MSG_TAG_NONE };
+        memcpy(&ring->buffer[tail & ring->mask], &pad, sizeof(pad));
+    }
+    message_ring_header const header = { .size = size, .tag = (uint32_t)tag };
+    memcpy(&ring->buffer[ring->reserved_pos & ring->mask], &header, sizeof(header));
+    atomic_store_explicit(&ring->tail, ring->reserved_pos + message_ring_record_size(size), memory_order_release);
+    ring->reserved_size = RING_NONE;
+    return 0;
+}
+
+int message_ring_try_read(struct message_ring *ring, struct message_payload *out)
+{
+    if (ring == NULL || out == NULL)
+    {
+        return -MSGQ_FAILURE_NULL_POINTER;
+    }
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    for (;;)
+    {
+        if (head == ring->cached_tail)
+        {
+            ring->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+            if (head == ring->cached_tail)
+            {
+                return 1;
+            }
+        }
+        uint32_t const index = head & ring->mask;
+        message_ring_header header = { 0 };
+        memcpy(&header, &ring->buffer[index], sizeof(header));
+        if (header.size == RING_NONE)
+        {
+            // Skip the padding at the end of the ring
+            head += (ring->mask + 1) - index;
+            atomic_store_explicit(&ring->head, head, memory_order_release);
+            continue;
+        }
+        ring->read_size = header.size;
+        out->tag = (enum message_tag)header.tag;
+        out->size = header.size;
+        out->data = &ring->buffer[index + sizeof(header)];
+        return 0;
+    }
+}
+
+int message_ring_release(struct message_ring *ring)
+{
+    if (ring == NULL)
+    {
+        return -MSGQ_FAILURE_NULL_POINTER;
+    }
+    if (ring->read_size == RING_NONE)
+    {
+        return -MSGQ_FAILURE_NOT_PENDING;
+    }
+    uint32_t const head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    atomic_store_explicit(&ring->head, head + message_ring_record_size(ring->read_size), memory_order_release);
+    ring->read_size = RING_NONE;
+    return 0;
 }
@@ -0,0 +1,395 @@
+#include "mixer.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "message_queue.h"
+#include "synth.h"
+
+enum
+{
+    CHANNELS = 2,
+    CHUNK_FRAMES = 256, // Frames mixed per pass over the voices
+};
+
+enum mixer_op
+{
+    MIXER_OP_PLAY_TONE = 0,
+    MIXER_OP_PLAY_SAMPLES = 1,
+    MIXER_OP_SET_GAIN = 2,
+    MIXER_OP_SET_FREQUENCY = 3,
+    MIXER_OP_STOP = 4,
+    MIXER_OP_PLAY_SOURCE = 5,
+};
+
+enum mixer_voice_kind
+{
+    MIXER_VOICE_TONE = 0,
+    MIXER_VOICE_SAMPLES = 1,
+    MIXER_VOICE_SOURCE = 2,
+};
+
+/// A command from the game thread, carried as a message_ring payload.
+struct mixer_command
+{
+    uint32_t op;          // enum mixer_op
+    uint32_t voice;       // Voice handle
+    float gain;           // PLAY_*, SET_GAIN
+    int loop;             // PLAY_SAMPLES
+    double frequency;     // PLAY_TONE, SET_FREQUENCY
+    float const *samples; // PLAY_SAMPLES
+    size_t frames;        // PLAY_SAMPLES
+    mixer_source_fn read; // PLAY_SOURCE
+    void *userdata;       // PLAY_SOURCE
+};
+
+/// A playing voice, owned by the audio thread.
+struct mixer_voice
+{
+    uint32_t id;
+    enum mixer_voice_kind kind;
+    float gain;           // Amplitude at the start of the next mix
+    float target;         // Amplitude at the end of the next mix
+    int stopping;         // Non-zero to free the voice once it has faded out
+    synth_osc osc;        // MIXER_VOICE_TONE, with a gain of 1
+    float const *samples; // MIXER_VOICE_SAMPLES
+    size_t frames;
+    size_t position;      // Next frame to play
+    int loop;
+    mixer_source_fn read; // MIXER_VOICE_SOURCE
+    void *userdata;
+};
+
+struct mixer
+{
+    struct message_ring *commands;
+    uint32_t next_id;           // Last handle given out, producer only
+    int sample_rate;
+    synth_kernels const *synth;
+    struct mixer_voice *voices; // Active voices first, audio thread only
+    uint32_t voice_count;       // Number of active voices
+    uint32_t max_voices;
+    _Atomic uint32_t active;    // voice_count, published for other threads
+    _Atomic uint32_t dropped;   // Voices that found no free slot
+    float scratch[CHUNK_FRAMES * CHANNELS];
+};
+
+struct mixer *mixer_create(int sample_rate, uint32_t max_voices, uint32_t max_commands)
+{
+    if (sample_rate <= 0 || max_voices == 0 || max_commands == 0)
+        return NULL;
+
+    // Each record is the payload plus an 8-byte header, and one more record
+    // covers the padding where the ring wraps.  The ring also only takes
+    // payloads of up to a quarter of its size.
+    uint32_t const record_size = (uint32_t)sizeof(struct mixer_command) + 8;
+    if (max_commands >= UINT32_MAX / 4 / record_size)
+        return NULL;
+
+    uint32_t const ring_size = (max_commands < 4) ? 4 * record_size : (max_commands + 1) * record_size;
+
+    struct mixer *mixer = calloc(1, sizeof(*mixer));
+    if (mixer == NULL)
+        return NULL;
+
+    mixer->voices = calloc(max_voices, sizeof(*mixer->voices));
+    if (mixer->voices == NULL)
+        goto out_free_mixer;
+
+    mixer->commands = message_ring_create(ring_size);
+    if (mixer->commands == NULL)
+        goto out_free_voices;
+
+    mixer->sample_rate = sample_rate;
+    mixer->max_voices = max_voices;
+    mixer->synth = synth_best_kernels();
+    atomic_init(&mixer->active, 0);
+    atomic_init(&mixer->dropped, 0);
+    return mixer;
+
+out_free_voices:
+    free(mixer->voices);
+out_free_mixer:
+    free(mixer);
+    return NULL;
+}
+
+void mixer_destroy(struct mixer *mixer)
+{
+    if (mixer == NULL)
+        return;
+
+    message_ring_destroy(mixer->commands);
+    free(mixer->voices);
+    free(mixer);
+}
+
+// Game thread
+
+static int send_command(struct mixer *mixer, struct mixer_command const *command)
+{
+    void *data = NULL;
+    int const rc = message_ring_reserve(mixer->commands, sizeof(*command), &data);
+    if (rc != 0)
+        return (rc == 1) ? 1 : -1;
+
+    memcpy(data, command, sizeof(*command));
+    return (message_ring_commit(mixer->commands, MSG_TAG_SOME, sizeof(*command)) == 0) ? 0 : -1;
+}
+
+/// Sends a command starting a new voice, and hands out its handle if it was sent.
+static int send_play(struct mixer *mixer, struct mixer_command *command, uint32_t *voice)
+{
+    // Handles are never 0, so a zeroed handle never names a voice.
+    uint32_t const id = (mixer->next_id == UINT32_MAX) ? 1 : mixer->next_id + 1;
+    command->voice = id;
+    int const rc = send_command(mixer, command);
+    if (rc == 0)
+    {
+        mixer->next_id = id;
+        *voice = id;
+    }
+    return rc;
+}
+
+int mixer_play_tone(struct mixer *mixer, double frequency, float gain, uint32_t *voice)
+{
+    if (mixer == NULL || voice == NULL)
+        return -1;
+
+    struct mixer_command command = { .op = MIXER_OP_PLAY_TONE, .gain = gain, .frequency = frequency };
+    return send_play(mixer, &command, voice);
+}
+
+int mixer_play_samples(struct mixer *mixer, float const *samples, size_t frames, float gain, int loop, uint32_t *voice)
+{
+    if (mixer == NULL || voice == NULL || (samples == NULL && frames > 0))
+        return -1;
+
+    struct mixer_command command = {
+        .op = MIXER_OP_PLAY_SAMPLES,
+        .gain = gain,
+        .loop = loop,
+        .samples = samples,
+        .frames = frames,
+    };
+    return send_play(mixer, &command, voice);
+}
+
+int mixer_play_source(struct mixer *mixer, mixer_source_fn read, void *userdata, float gain, uint32_t *voice)
+{
+    if (mixer == NULL || read == NULL || voice == NULL)
+        return -1;
+
+    struct mixer_command command = { .op = MIXER_OP_PLAY_SOURCE, .gain = gain, .read = read, .userdata = userdata };
+    return send_play(mixer, &command, voice);
+}
+
+int mixer_set_gain(struct mixer *mixer, uint32_t voice, float gain)
+{
+    if (mixer == NULL)
+        return -1;
+
+    struct mixer_command const command = { .op = MIXER_OP_SET_GAIN, .voice = voice, .gain = gain };
+    return send_command(mixer, &command);
+}
+
+int mixer_set_frequency(struct mixer *mixer, uint32_t voice, double frequency)
+{
+    if (mixer == NULL)
+        return -1;
+
+    struct mixer_command const command = { .op = MIXER_OP_SET_FREQUENCY, .voice = voice, .frequency = frequency };
+    return send_command(mixer, &command);
+}
+
+int mixer_stop(struct mixer *mixer, uint32_t voice)
+{
+    if (mixer == NULL)
+        return -1;
+
+    struct mixer_command const command = { .op = MIXER_OP_STOP, .voice = voice };
+    return send_command(mixer, &command);
+}
+
+// Audio thread
+
+static struct mixer_voice *find_voice(struct mixer *mixer, uint32_t id)
+{
+    for (uint32_t i = 0; i < mixer->voice_count; ++i)
+    {
+        if (mixer->voices[i].id == id)
+            return &mixer->voices[i];
+    }
+    return NULL;
+}
+
+static void apply(struct mixer *mixer, struct mixer_command const *command)
+{
+    if (command->op == MIXER_OP_PLAY_TONE || command->op == MIXER_OP_PLAY_SAMPLES || command->op == MIXER_OP_PLAY_SOURCE)
+    {
+        if (mixer->voice_count == mixer->max_voices)
+        {
+            atomic_fetch_add_explicit(&mixer->dropped, 1, memory_order_relaxed);
+            return;
+        }
+        struct mixer_voice *v = &mixer->voices[mixer->voice_count++];
+        *v = (struct mixer_voice){ .id = command->voice, .target = command->gain };
+        if (command->op == MIXER_OP_PLAY_TONE)
+        {
+            // Tones fade in, samples start as recorded.
+            v->kind = MIXER_VOICE_TONE;
+            v->osc.gain = 1.0f;
+            synth_osc_set_frequency(&v->osc, command->frequency, mixer->sample_rate);
+        }
+        else if (command->op == MIXER_OP_PLAY_SOURCE)
+        {
+            v->kind = MIXER_VOICE_SOURCE;
+            v->gain = command->gain;
+            v->read = command->read;
+            v->userdata = command->userdata;
+        }
+        else
+        {
+            v->kind = MIXER_VOICE_SAMPLES;
+            v->gain = command->gain;
+            v->samples = command->samples;
+            v->frames = command->frames;
+            v->loop = command->loop;
+        }
+        return;
+    }
+
+    struct mixer_voice *v = find_voice(mixer, command->voice);
+    if (v == NULL)
+        return;
+
+    switch (command->op)
+    {
+    case MIXER_OP_SET_GAIN:
+        if (!v->stopping)
+            v->target = command->gain;
+        break;
+    case MIXER_OP_SET_FREQUENCY:
+        if (v->kind == MIXER_VOICE_TONE)
+            synth_osc_set_frequency(&v->osc, command->frequency, mixer->sample_rate);
+        break;
+    case MIXER_OP_STOP:
+        v->stopping = 1;
+        v->target = 0.0f;
+        break;
+    default:
+        break;
+    }
+}
+
+static void drain(struct mixer *mixer)
+{
+    struct message_payload payload;
+    while (message_ring_try_read(mixer->commands, &payload) == 0)
+    {
+        struct mixer_command command;
+        memcpy(&command, payload.data, sizeof(command));
+        (void)message_ring_release(mixer->commands);
+        apply(mixer, &command);
+    }
+}
+
+/// Adds n frames of src to dst, scaled by a gain that starts at gain and moves by step every frame.
+static void accumulate(float *dst, float const *src, size_t n, float gain, float step)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        float const g = gain + (step * (float)i);
+        dst[(CHANNELS * i) + 0] += src[(CHANNELS * i) + 0] * g;
+        dst[(CHANNELS * i) + 1] += src[(CHANNELS * i) + 1] * g;
+    }
+}
+
+/// Mixes up to n frames of a sample voice, and returns the number of frames it played.
+static size_t mix_samples(struct mixer_voice *v, float *dst, size_t n, float gain, float step)
+{
+    size_t done = 0;
+    while (done < n)
+    {
+        if (v->position == v->frames)
+        {
+            if (!v->loop || v->frames == 0)
+                break;
+
+            v->position = 0;
+        }
+        size_t const count = (v->frames - v->position < n - done) ? v->frames - v->position : n - done;
+        accumulate(&dst[CHANNELS * done], &v->samples[CHANNELS * v->position], count, gain + (step * (float)done), step);
+        v->position += count;
+        done += count;
+    }
+    return done;
+}
+
+void mixer_mix(struct mixer *mixer, float *dst, size_t frames)
+{
+    if (mixer == NULL || dst == NULL)
+        return;
+
+    drain(mixer);
+    memset(dst, 0, frames * CHANNELS * sizeof(*dst));
+    if (frames == 0)
+        return;
+
+    for (uint32_t i = 0; i < mixer->voice_count;)
+    {
+        struct mixer_voice *v = &mixer->voices[i];
+        float const step = (v->target - v->gain) / (float)frames;
+        int ended = 0;
+        for (size_t offset = 0; offset < frames && !ended; offset += CHUNK_FRAMES)
+        {
+            size_t const n = (frames - offset < CHUNK_FRAMES) ? frames - offset : CHUNK_FRAMES;
+            float const gain = v->gain + (step * (float)offset);
+            float *const out = &dst[CHANNELS * offset];
+            if (v->kind == MIXER_VOICE_TONE)
+            {
+                mixer->synth->sine_stereo(mixer->scratch, n, &v->osc);
+                accumulate(out, mixer->scratch, n, gain, step);
+            }
+            else if (v->kind == MIXER_VOICE_SOURCE)
+            {
+                size_t const got = v->read(v->userdata, mixer->scratch, n);
+                accumulate(out, mixer->scratch, (got < n) ? got : n, gain, step);
+                ended = got < n;
+            }
+            else
+            {
+                ended = mix_samples(v, out, n, gain, step) < n;
+            }
+        }
+        v->gain = v->target;
+
+        if (ended || (v->stopping && v->gain == 0.0f))
+        {
+            // Keep the active voices packed, order does not matter.
+            *v = mixer->voices[--mixer->voice_count];
+            continue;
+        }
+        ++i;
+    }
+    atomic_store_explicit(&mixer->active, mixer->voice_count, memory_order_relaxed);
+}
+
+void mixer_callback(void *userdata, uint8_t *stream, int len)
+{
+    size_t const frames = (len > 0) ? (size_t)len / (CHANNELS * sizeof(float)) : 0;
+    mixer_mix(userdata, (float *)stream, frames);
+}
+
+uint32_t mixer_active_voices(struct mixer const *mixer)
+{
+    return (mixer == NULL) ? 0 : atomic_load_explicit(&mixer->active, memory_order_relaxed);
+}
+
+uint32_t mixer_dropped_voices(struct mixer const *mixer)
+{
+    return (mixer == NULL) ? 0 : atomic_load_explicit(&mixer->dropped, memory_order_relaxed);
+}
@@ -0,0 +1,430 @@
+#include "sample_bank.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+enum
+{
+    CHANNELS = 2,
+    FRAME_SIZE = CHANNELS * sizeof(float), // Output bytes per frame
+    STREAM_FRAMES = 4096,                  // Frames per stream buffer, about 85 ms at 48 kHz
+    READ_SIZE = 16 * 1024,                 // Bytes read from the file at a time
+    READER_DELAY = 5,                      // Time the reader sleeps while both buffers are full (ms)
+    MIN_SAMPLES = 8,                       // Initial capacity of the sample list
+};
+
+enum wav_tag
+{
+    WAV_PCM = 0x0001,
+    WAV_FLOAT = 0x0003,
+    WAV_EXTENSIBLE = 0xFFFE,
+};
+
+/// The parts of a WAV file a stream needs.
+struct wav_info
+{
+    SDL_AudioFormat format;
+    uint8_t channels;
+    int rate;
+    uint32_t frame_size;  // Bytes per frame
+    int64_t data_offset;  // Position of the first frame in the file
+    uint32_t data_size;   // Bytes of frames, a multiple of frame_size
+};
+
+/// Converted samples handed from the reader thread to the audio thread.
+struct stream_buffer
+{
+    _Atomic int full; // Non-zero while the audio thread owns the buffer
+    size_t frames;    // Frames in samples
+    int last;         // Non-zero if the track ends with this buffer
+    float samples[STREAM_FRAMES * CHANNELS];
+};
+
+struct sample_stream
+{
+    struct sample_stream *next; // Next stream in the bank
+    struct stream_buffer buffers[2];
+
+    // Reader thread
+    SDL_Thread *reader;
+    _Atomic int stopping;      // Non-zero once the bank is being destroyed
+    SDL_RWops *file;
+    SDL_AudioStream *convert;  // From the file format to the output format
+    struct wav_info wav;
+    uint32_t data_read;        // Bytes of frames read so far
+    int loop;
+    int eof;                   // Non-zero once everything has been put into convert
+    unsigned fill;             // Index of the next buffer to fill
+    unsigned char chunk[READ_SIZE];
+
+    // Audio thread
+    unsigned play;             // Index of the buffer being played
+    size_t position;           // Next frame to play in that buffer
+    int done;                  // Non-zero once the last buffer has been played
+    _Atomic uint32_t underruns;
+};
+
+struct sample_bank
+{
+    int sample_rate;
+    struct sample **samples;
+    size_t sample_count;
+    size_t sample_capacity;
+    struct sample_stream *streams;
+};
+
+static void sample_free(struct sample *sample)
+{
+    if (sample == NULL)
+        return;
+
+    free(sample->samples);
+    free(sample);
+}
+
+static int ids_equal(char const id[static 4], char const *expected)
+{
+    return memcmp(id, expected, 4) == 0;
+}
+
+/// Maps a WAV format tag and sample size to an SDL audio format.
+static SDL_AudioFormat wav_format(uint16_t tag, uint16_t bits)
+{
+    if (tag == WAV_PCM && bits == 8)
+        return AUDIO_U8;
+
+    if (tag == WAV_PCM && bits == 16)
+        return AUDIO_S16LSB;
+
+    if (tag == WAV_PCM && bits == 32)
+        return AUDIO_S32LSB;
+
+    if (tag == WAV_FLOAT && bits == 32)
+        return AUDIO_F32LSB;
+
+    return 0;
+}
+
+/// Reads the format of a WAV file and leaves the file at its first frame.
+static int wav_read_header(SDL_RWops *rw, struct wav_info *wav)
+{
+    char id[4];
+    if (SDL_RWread(rw, id, sizeof(id), 1) != 1 || !ids_equal(id, "RIFF"))
+        return -1;
+
+    (void)SDL_ReadLE32(rw);
+    if (SDL_RWread(rw, id, sizeof(id), 1) != 1 || !ids_equal(id, "WAVE"))
+        return -1;
+
+    int have_format = 0;
+    for (;;)
+    {
+        if (SDL_RWread(rw, id, sizeof(id), 1) != 1)
+            return -1;
+
+        uint32_t const size = SDL_ReadLE32(rw);
+        int64_t const start = SDL_RWtell(rw);
+        if (start < 0)
+            return -1;
+
+        if (ids_equal(id, "fmt ") && size >= 16)
+        {
+            uint16_t tag = SDL_ReadLE16(rw);
+            uint16_t const channels = SDL_ReadLE16(rw);
+            uint32_t const rate = SDL_ReadLE32(rw);
+            (void)SDL_ReadLE32(rw); // Bytes per second
+            uint16_t const block_align = SDL_ReadLE16(rw);
+            uint16_t const bits = SDL_ReadLE16(rw);
+            if (tag == WAV_EXTENSIBLE && size >= 40)
+            {
+                (void)SDL_ReadLE16(rw); // Size of the extension
+                (void)SDL_ReadLE16(rw); // Valid bits per sample
+                (void)SDL_ReadLE32(rw); // Channel mask
+                tag = SDL_ReadLE16(rw); // First two bytes of the subformat GUID
+            }
+            wav->format = wav_format(tag, bits);
+            if (wav->format == 0 || channels == 0 || channels > UINT8_MAX || rate == 0 || rate > INT32_MAX
+                || block_align != channels * (bits / 8))
+                return -1;
+
+            wav->channels = (uint8_t)channels;
+            wav->rate = (int)rate;
+            wav->frame_size = block_align;
+            have_format = 1;
+        }
+        else if (ids_equal(id, "data"))
+        {
+            if (!have_format)
+                return -1;
+
+            wav->data_offset = start;
+            wav->data_size = size - (size % wav->frame_size);
+            return 0;
+        }
+
+        // Chunks are padded to an even size.
+        if (SDL_RWseek(rw, start + size + (size & 1), RW_SEEK_SET) < 0)
+            return -1;
+    }
+}
+
+/// Puts file data into the converter until it holds want bytes of output or the track ends.
+static void stream_decode(struct sample_stream *stream, int want)
+{
+    while (!stream->eof && SDL_AudioStreamAvailable(stream->convert) < want)
+    {
+        if (stream->data_read == stream->wav.data_size)
+        {
+            if (stream->loop && stream->wav.data_size > 0
+                && SDL_RWseek(stream->file, stream->wav.data_offset, RW_SEEK_SET) >= 0)
+            {
+                stream->data_read = 0;
+                continue;
+            }
+            (void)SDL_AudioStreamFlush(stream->convert);
+            stream->eof = 1;
+            break;
+        }
+
+        uint32_t size = stream->wav.data_size - stream->data_read;
+        if (size > READ_SIZE)
+            size = READ_SIZE - (READ_SIZE % stream->wav.frame_size);
+
+        size_t const got = SDL_RWread(stream->file, stream->chunk, 1, size);
+        size_t const whole = got - (got % stream->wav.frame_size);
+        if (whole > 0 && SDL_AudioStreamPut(stream->convert, stream->chunk, (int)whole) != 0)
+        {
+            (void)SDL_AudioStreamFlush(stream->convert);
+            stream->eof = 1;
+            break;
+        }
+        stream->data_read += (uint32_t)whole;
+
+        // A truncated file ends the track early.
+        if (whole < size)
+            stream->wav.data_size = stream->data_read;
+    }
+}
+
+/// Decodes the next buffer and hands it to the audio thread.
+static void stream_fill(struct sample_stream *stream, struct stream_buffer *buffer)
+{
+    int const want = STREAM_FRAMES * FRAME_SIZE;
+    stream_decode(stream, want);
+    int const got = SDL_AudioStreamGet(stream->convert, buffer->samples, want);
+    buffer->frames = (got > 0) ? (size_t)got / FRAME_SIZE : 0;
+    buffer->last = (got < want) || (stream->eof && SDL_AudioStreamAvailable(stream->convert) == 0);
+    atomic_store_explicit(&buffer->full, 1, memory_order_release);
+}
+
+static int stream_read_thread(void *data)
+{
+    struct sample_stream *stream = data;
+    while (atomic_load_explicit(&stream->stopping, memory_order_relaxed) == 0)
+    {
+        struct stream_buffer *buffer = &stream->buffers[stream->fill];
+        if (atomic_load_explicit(&buffer->full, memory_order_acquire) != 0)
+        {
+            SDL_Delay(READER_DELAY);
+            continue;
+        }
+        stream_fill(stream, buffer);
+        stream->fill ^= 1;
+        if (buffer->last)
+            break;
+    }
+    return 0;
+}
+
+static void stream_close(struct sample_stream *stream)
+{
+    if (stream->reader != NULL)
+    {
+        atomic_store_explicit(&stream->stopping, 1, memory_order_relaxed);
+        SDL_WaitThread(stream->reader, NULL);
+    }
+    SDL_FreeAudioStream(stream->convert);
+    (void)SDL_RWclose(stream->file);
+    free(stream);
+}
+
+struct sample_bank *sample_bank_create(int sample_rate)
+{
+    if (sample_rate <= 0)
+        return NULL;
+
+    struct sample_bank *bank = calloc(1, sizeof(*bank));
+    if (bank == NULL)
+        return NULL;
+
+    bank->sample_rate = sample_rate;
+    return bank;
+}
+
+void sample_bank_destroy(struct sample_bank *bank)
+{
+    if (bank == NULL)
+        return;
+
+    for (struct sample_stream *stream = bank->streams, *next = NULL; stream != NULL; stream = next)
+    {
+        next = stream->next;
+        stream_close(stream);
+    }
+    for (size_t i = 0; i < bank->sample_count; ++i)
+    {
+        sample_free(bank->samples[i]);
+    }
+    free(bank->samples);
+    free(bank);
+}
+
+struct sample const *sample_bank_load(struct sample_bank *bank, char const *path)
+{
+    if (bank == NULL || path == NULL)
+        return NULL;
+
+    if (bank->sample_count == bank->sample_capacity)
+    {
+        size_t const capacity = (bank->sample_capacity == 0) ? MIN_SAMPLES : bank->sample_capacity * 2;
+        struct sample **samples = realloc(bank->samples, capacity * sizeof(*samples));
+        if (samples == NULL)
+            return NULL;
+
+        bank->samples = samples;
+        bank->sample_capacity = capacity;
+    }
+
+    SDL_AudioSpec spec;
+    uint8_t *wav = NULL;
+    uint32_t wav_size = 0;
+    if (SDL_LoadWAV(path, &spec, &wav, &wav_size) == NULL)
+        return NULL;
+
+    struct sample *sample = NULL;
+    SDL_AudioCVT cvt;
+    int const rc = SDL_BuildAudioCVT(&cvt, spec.format, spec.channels, spec.freq, AUDIO_F32SYS, CHANNELS, bank->sample_rate);
+    if (rc < 0 || wav_size > INT32_MAX / (uint32_t)cvt.len_mult)
+        goto out_free_wav;
+
+    // SDL converts in place, in a buffer len_mult times the size of the input.
+    cvt.len = (int)wav_size;
+    cvt.buf = malloc((size_t)wav_size * (size_t)cvt.len_mult);
+    if (cvt.buf == NULL)
+        goto out_free_wav;
+
+    memcpy(cvt.buf, wav, wav_size);
+    cvt.len_cvt = cvt.len;
+    if (rc == 1 && SDL_ConvertAudio(&cvt) != 0)
+        goto out_free_buf;
+
+    sample = malloc(sizeof(*sample));
+    if (sample == NULL)
+        goto out_free_buf;
+
+    sample->frames = (size_t)cvt.len_cvt / FRAME_SIZE;
+    sample->samples = realloc(cvt.buf, (sample->frames > 0) ? sample->frames * FRAME_SIZE : FRAME_SIZE);
+    if (sample->samples == NULL)
+        sample->samples = (float *)cvt.buf;
+
+    bank->samples[bank->sample_count++] = sample;
+    SDL_FreeWAV(wav);
+    return sample;
+
+out_free_buf:
+    free(cvt.buf);
+out_free_wav:
+    SDL_FreeWAV(wav);
+    return NULL;
+}
+
+struct sample_stream *sample_bank_open_stream(struct sample_bank *bank, char const *path, int loop)
+{
+    if (bank == NULL || path == NULL)
+        return NULL;
+
+    struct sample_stream *stream = calloc(1, sizeof(*stream));
+    if (stream == NULL)
+        return NULL;
+
+    atomic_init(&stream->stopping, 0);
+    atomic_init(&stream->underruns, 0);
+    atomic_init(&stream->buffers[0].full, 0);
+    atomic_init(&stream->buffers[1].full, 0);
+    stream->loop = loop;
+
+    stream->file = SDL_RWFromFile(path, "rb");
+    if (stream->file == NULL)
+        goto out_free_stream;
+
+    if (wav_read_header(stream->file, &stream->wav) != 0)
+    {
+        SDL_SetError("%s: unsupported WAV file", path);
+        goto out_close_file;
+    }
+
+    stream->convert = SDL_NewAudioStream(stream->wav.format, stream->wav.channels, stream->wav.rate, AUDIO_F32SYS,
+                                         CHANNELS, bank->sample_rate);
+    if (stream->convert == NULL)
+        goto out_close_file;
+
+    stream_fill(stream, &stream->buffers[0]);
+    stream->fill = 1;
+    if (!stream->buffers[0].last)
+    {
+        stream->reader = SDL_CreateThread(stream_read_thread, "sample_stream", stream);
+        if (stream->reader == NULL)
+            goto out_free_convert;
+    }
+
+    stream->next = bank->streams;
+    bank->streams = stream;
+    return stream;
+
+out_free_convert:
+    SDL_FreeAudioStream(stream->convert);
+out_close_file:
+    (void)SDL_RWclose(stream->file);
+out_free_stream:
+    free(stream);
+    return NULL;
+}
+
+size_t sample_stream_read(void *data, float *dst, size_t frames)
+{
+    struct sample_stream *stream = data;
+    size_t done = 0;
+    while (done < frames && !stream->done)
+    {
+        struct stream_buffer *buffer = &stream->buffers[stream->play];
+        if (atomic_load_explicit(&buffer->full, memory_order_acquire) == 0)
+        {
+            // The reader has fallen behind.  Play silence rather than wait.
+            atomic_fetch_add_explicit(&stream->underruns, 1, memory_order_relaxed);
+            memset(&dst[CHANNELS * done], 0, (frames - done) * FRAME_SIZE);
+            return frames;
+        }
+
+        size_t const left = buffer->frames - stream->position;
+        size_t const n = (left < frames - done) ? left : frames - done;
+        memcpy(&dst[CHANNELS * done], &buffer->samples[CHANNELS * stream->position], n * FRAME_SIZE);
+        stream->position += n;
+        done += n;
+        if (stream->position == buffer->frames)
+        {
+            stream->done = buffer->last;
+            stream->position = 0;
+            stream->play ^= 1;
+            atomic_store_explicit(&buffer->full, 0, memory_order_release);
+        }
+    }
+    return done;
+}
+
+uint32_t sample_stream_underruns(struct sample_stream const *stream)
+{
+    return (stream == NULL) ? 0 : atomic_load_explicit(&stream->underruns, memory_order_relaxed);
+}
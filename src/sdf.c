@@ -0,0 +1,129 @@
+#include "sdf.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/// Squared distance standing in for "no feature pixel".  It is large enough to
+/// lose against any real distance and small enough that differences between
+/// two such values still compare sensibly.
+static double const FAR = 1e20;
+
+/// Scratch space for the 1D transforms.
+typedef struct sdf_scratch
+{
+    double *f; // Input samples of one row or column
+    double *d; // Output samples of one row or column
+    double *z; // Boundaries between parabolas, n + 1 entries
+    size_t *v; // Apexes of the parabolas in the lower envelope
+} sdf_scratch;
+
+/// Squared distance transform of the n samples in s->f, written to s->d.
+///
+/// Computes d[q] = min over p of (q - p)^2 + f[p] from the lower envelope of
+/// the parabolas rooted at every sample.
+static void transform_1d(sdf_scratch *s, size_t n)
+{
+    double const *const f = s->f;
+    double *const d = s->d;
+    double *const z = s->z;
+    size_t *const v = s->v;
+
+    // The samples are finite, so no boundary is ever below z[0] and k stays non-negative.
+    size_t k = 0;
+    v[0] = 0;
+    z[0] = -HUGE_VAL;
+    z[1] = HUGE_VAL;
+    for (size_t q = 1; q < n; ++q)
+    {
+        double const dq = (double)q;
+        double sep = 0.0;
+        for (;; --k)
+        {
+            double const dp = (double)v[k];
+            sep = ((f[q] + (dq * dq)) - (f[v[k]] + (dp * dp))) / (2.0 * (dq - dp));
+            if (sep > z[k])
+                break;
+        }
+        ++k;
+        v[k] = q;
+        z[k] = sep;
+        z[k + 1] = HUGE_VAL;
+    }
+
+    k = 0;
+    for (size_t q = 0; q < n; ++q)
+    {
+        while (z[k + 1] < (double)q)
+            ++k;
+        double const dq = (double)q - (double)v[k];
+        d[q] = (dq * dq) + f[v[k]];
+    }
+}
+
+/// Squared distance from every pixel to the nearest pixel where inside(src) matches want.
+static void transform_2d(double *grid, uint8_t const *src, size_t width, size_t height, int want, sdf_scratch *s)
+{
+    for (size_t i = 0; i < width * height; ++i)
+        grid[i] = ((src[i] != 0) == want) ? 0.0 : FAR;
+
+    for (size_t x = 0; x < width; ++x)
+    {
+        for (size_t y = 0; y < height; ++y)
+            s->f[y] = grid[(y * width) + x];
+        transform_1d(s, height);
+        for (size_t y = 0; y < height; ++y)
+            grid[(y * width) + x] = s->d[y];
+    }
+    for (size_t y = 0; y < height; ++y)
+    {
+        for (size_t x = 0; x < width; ++x)
+            s->f[x] = grid[(y * width) + x];
+        transform_1d(s, width);
+        for (size_t x = 0; x < width; ++x)
+            grid[(y * width) + x] = s->d[x];
+    }
+}
+
+int sdf_generate(uint8_t *dst, uint8_t const *src, size_t width, size_t height, double spread)
+{
+    if (dst == NULL || src == NULL || width == 0 || height == 0 || !(spread > 0.0) || width > SIZE_MAX / sizeof(double) / height)
+        return -1;
+
+    int ret = -1;
+    size_t const n = (width > height) ? width : height;
+    size_t const size = width * height;
+    double *to_inside = malloc(size * sizeof(*to_inside));
+    double *to_outside = malloc(size * sizeof(*to_outside));
+    sdf_scratch s = {
+        .f = malloc(n * sizeof(*s.f)),
+        .d = malloc(n * sizeof(*s.d)),
+        .z = malloc((n + 1) * sizeof(*s.z)),
+        .v = malloc(n * sizeof(*s.v)),
+    };
+    if (to_inside == NULL || to_outside == NULL || s.f == NULL || s.d == NULL || s.z == NULL || s.v == NULL)
+        goto out_free;
+
+    transform_2d(to_inside, src, width, height, 1, &s);
+    transform_2d(to_outside, src, width, height, 0, &s);
+
+    double const scale = 127.0 / spread;
+    for (size_t i = 0; i < size; ++i)
+    {
+        // Signed distance to the edge, positive inside.
+        double const distance = (src[i] != 0) ? sqrt(to_outside[i]) - 0.5 : 0.5 - sqrt(to_inside[i]);
+        double const value = SDF_EDGE + (distance * scale);
+        dst[i] = (value <= 0.0) ? 0 : (value >= 255.0) ? 255 : (uint8_t)lround(value);
+    }
+
+    ret = 0;
+out_free:
+    free(s.v);
+    free(s.z);
+    free(s.d);
+    free(s.f);
+    free(to_outside);
+    free(to_inside);
+    return ret;
+}
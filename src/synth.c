@@ -0,0 +1,195 @@
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cpu_isa.h"
+#include "macro.h"
+#include "synth.h"
+
+#ifdef CPU_ISA_X86
+#    include <immintrin.h>
+#endif
+
+/// Scales a signed 32-bit phase to a fraction of a cycle in [-0.5, 0.5).
+static float const PHASE_SCALE = 0x1p-32f;
+
+/// Taylor coefficients of sin(2 pi a), accurate to about 6e-8 for |a| <= 0.25.
+static float const C1 = 6.28318531f;
+static float const C3 = -41.3417022f;
+static float const C5 = 81.6052493f;
+static float const C7 = -76.7058598f;
+static float const C9 = 42.0586939f;
+static float const C11 = -15.0946426f;
+
+STATIC_ASSERT(sizeof(float) == 4);
+
+// Scalar
+
+/// Evaluates sin(2 pi x) for x in [-0.5, 0.5).
+///
+/// sin(2 pi a) is symmetric about a = 0.25 and odd, so the polynomial only
+/// has to cover [0, 0.25].  Every vector kernel follows the same steps.
+static inline float sine_scalar(float x)
+{
+    float a = fabsf(x);
+    float const b = 0.5f - a;
+    a = (b < a) ? b : a;
+    float const a2 = a * a;
+    float p = C11;
+    p = (p * a2) + C9;
+    p = (p * a2) + C7;
+    p = (p * a2) + C5;
+    p = (p * a2) + C3;
+    p = (p * a2) + C1;
+    float const s = p * a;
+    return (x < 0.0f) ? -s : s;
+}
+
+static inline float phase_to_x(uint32_t phase)
+{
+    return (float)(int32_t)phase * PHASE_SCALE;
+}
+
+static void sine_stereo_scalar(float *dst, size_t n, synth_osc *osc)
+{
+    uint32_t phase = osc->phase;
+    for (size_t i = 0; i < n; ++i, phase += osc->increment)
+    {
+        float const y = sine_scalar(phase_to_x(phase)) * osc->gain;
+        dst[(2 * i) + 0] = y;
+        dst[(2 * i) + 1] = y;
+    }
+    osc->phase = phase;
+}
+
+static synth_kernels const KERNELS_SCALAR = {
+    .sine_stereo = sine_stereo_scalar,
+};
+
+#ifdef CPU_ISA_X86
+
+// SSE2
+
+__attribute__((target("sse2"))) static inline __m128 sine_sse2(__m128 x)
+{
+    __m128 const sign = _mm_set1_ps(-0.0f);
+    __m128 a = _mm_andnot_ps(sign, x);
+    a = _mm_min_ps(_mm_sub_ps(_mm_set1_ps(0.5f), a), a);
+    __m128 const a2 = _mm_mul_ps(a, a);
+    __m128 p = _mm_set1_ps(C11);
+    p = _mm_add_ps(_mm_mul_ps(p, a2), _mm_set1_ps(C9));
+    p = _mm_add_ps(_mm_mul_ps(p, a2), _mm_set1_ps(C7));
+    p = _mm_add_ps(_mm_mul_ps(p, a2), _mm_set1_ps(C5));
+    p = _mm_add_ps(_mm_mul_ps(p, a2), _mm_set1_ps(C3));
+    p = _mm_add_ps(_mm_mul_ps(p, a2), _mm_set1_ps(C1));
+    return _mm_xor_ps(_mm_mul_ps(p, a), _mm_and_ps(sign, x));
+}
+
+__attribute__((target("sse2"))) static void sine_stereo_sse2(float *dst, size_t n, synth_osc *osc)
+{
+    uint32_t const inc = osc->increment;
+    __m128i phase = _mm_add_epi32(_mm_set1_epi32((int)osc->phase), _mm_setr_epi32(0, (int)inc, (int)(2 * inc), (int)(3 * inc)));
+    __m128i const step = _mm_set1_epi32((int)(4 * inc));
+    __m128 const scale = _mm_set1_ps(PHASE_SCALE);
+    __m128 const gain = _mm_set1_ps(osc->gain);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128 const x = _mm_mul_ps(_mm_cvtepi32_ps(phase), scale);
+        __m128 const y = _mm_mul_ps(sine_sse2(x), gain);
+        _mm_storeu_ps(&dst[2 * i], _mm_unpacklo_ps(y, y));
+        _mm_storeu_ps(&dst[(2 * i) + 4], _mm_unpackhi_ps(y, y));
+        phase = _mm_add_epi32(phase, step);
+    }
+    osc->phase += (uint32_t)i * inc;
+    sine_stereo_scalar(&dst[2 * i], n - i, osc);
+}
+
+static synth_kernels const KERNELS_SSE2 = {
+    .sine_stereo = sine_stereo_sse2,
+};
+
+// AVX2
+
+__attribute__((target("avx2"))) static inline __m256 sine_avx2(__m256 x)
+{
+    __m256 const sign = _mm256_set1_ps(-0.0f);
+    __m256 a = _mm256_andnot_ps(sign, x);
+    a = _mm256_min_ps(_mm256_sub_ps(_mm256_set1_ps(0.5f), a), a);
+    __m256 const a2 = _mm256_mul_ps(a, a);
+    __m256 p = _mm256_set1_ps(C11);
+    p = _mm256_add_ps(_mm256_mul_ps(p, a2), _mm256_set1_ps(C9));
+    p = _mm256_add_ps(_mm256_mul_ps(p, a2), _mm256_set1_ps(C7));
+    p = _mm256_add_ps(_mm256_mul_ps(p, a2), _mm256_set1_ps(C5));
+    p = _mm256_add_ps(_mm256_mul_ps(p, a2), _mm256_set1_ps(C3));
+    p = _mm256_add_ps(_mm256_mul_ps(p, a2), _mm256_set1_ps(C1));
+    return _mm256_xor_ps(_mm256_mul_ps(p, a), _mm256_and_ps(sign, x));
+}
+
+__attribute__((target("avx2"))) static void sine_stereo_avx2(float *dst, size_t n, synth_osc *osc)
+{
+    uint32_t const inc = osc->increment;
+    __m256i phase = _mm256_add_epi32(_mm256_set1_epi32((int)osc->phase),
+                                     _mm256_mullo_epi32(_mm256_set1_epi32((int)inc), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+    __m256i const step = _mm256_set1_epi32((int)(8 * inc));
+    __m256 const scale = _mm256_set1_ps(PHASE_SCALE);
+    __m256 const gain = _mm256_set1_ps(osc->gain);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256 const x = _mm256_mul_ps(_mm256_cvtepi32_ps(phase), scale);
+        __m256 const y = _mm256_mul_ps(sine_avx2(x), gain);
+        // Unpacking works within 128-bit lanes: lo = y0 y0 y1 y1 | y4 y4 y5 y5, hi = y2 y2 y3 y3 | y6 y6 y7 y7
+        __m256 const lo = _mm256_unpacklo_ps(y, y);
+        __m256 const hi = _mm256_unpackhi_ps(y, y);
+        _mm256_storeu_ps(&dst[2 * i], _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(&dst[(2 * i) + 8], _mm256_permute2f128_ps(lo, hi, 0x31));
+        phase = _mm256_add_epi32(phase, step);
+    }
+    osc->phase += (uint32_t)i * inc;
+    sine_stereo_scalar(&dst[2 * i], n - i, osc);
+}
+
+static synth_kernels const KERNELS_AVX2 = {
+    .sine_stereo = sine_stereo_avx2,
+};
+
+#endif // CPU_ISA_X86
+
+synth_kernels const *synth_get_kernels(cpu_isa isa)
+{
+    if (!cpu_isa_supported(isa))
+    {
+        return NULL;
+    }
+    switch (isa)
+    {
+    case CPU_ISA_SCALAR:
+        return &KERNELS_SCALAR;
+#ifdef CPU_ISA_X86
+    case CPU_ISA_SSE2:
+        return &KERNELS_SSE2;
+    case CPU_ISA_AVX2:
+        return &KERNELS_AVX2;
+#endif
+    default:
+        return NULL;
+    }
+}
+
+synth_kernels const *synth_best_kernels(void)
+{
+    return synth_get_kernels(cpu_isa_best());
+}
+
+void synth_osc_set_frequency(synth_osc *osc, double frequency, int sample_rate)
+{
+    // 2^32 phase steps per cycle, rounded to the nearest step per frame.
+    double const increment = frequency / (double)sample_rate * 4294967296.0;
+    osc->increment = (increment <= 0.0) ? 0 : (increment >= 2147483648.0) ? 0x80000000u : (uint32_t)lround(increment);
+}
+
+float synth_sine(uint32_t phase)
+{
+    return sine_scalar(phase_to_x(phase));
+}
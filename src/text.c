@@ -0,0 +1,383 @@
+#include "text.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "atlas.h"
+#include "bmp.h"
+#include "text_cache.h"
+
+enum
+{
+    VERTICES_PER_QUAD = 4,
+    INDICES_PER_QUAD = 6,
+    FALLBACK = '?',
+    REPLACEMENT = 0xFFFD,
+};
+
+/// A string queued by text_draw().
+struct text_draw_record
+{
+    uint64_t version; // Version of the layout
+    float x;
+    float y;
+    SDL_Color color;
+};
+
+struct text_renderer
+{
+    SDL_Renderer *renderer;
+    SDL_Texture *atlas;
+    atlas_metrics metrics;
+    struct text_cache *cache;
+    SDL_Vertex *vertices;           // Quads queued since the last flush
+    int *indices;                   // Two triangles for each of the first capacity quads
+    size_t count;                   // Number of quads queued
+    size_t capacity;                // Number of quads vertices and indices hold
+    struct text_draw_record *draws; // Strings queued since the last flush, followed by the rest of the last frame's
+    size_t draw_count;              // Number of strings queued
+    size_t draw_capacity;           // Number of records draws holds
+    size_t last_draw_count;         // Number of strings queued in the last frame
+    int reusing;                    // Non-zero while every string queued matches the last frame
+};
+
+/// Decodes the UTF-8 sequence at str[*i] and advances *i past it.
+///
+/// Returns REPLACEMENT for an invalid sequence, after skipping one byte.
+static uint32_t decode_utf8(char const *str, size_t len, size_t *i)
+{
+    unsigned char const *s = (unsigned char const *)&str[*i];
+    size_t const left = len - *i;
+    uint32_t code = 0;
+    size_t n = 0;
+    uint32_t min = 0;
+    if (s[0] < 0x80)
+    {
+        *i += 1;
+        return s[0];
+    }
+    if ((s[0] & 0xE0) == 0xC0)
+    {
+        code = s[0] & 0x1Fu;
+        n = 2;
+        min = 0x80;
+    }
+    else if ((s[0] & 0xF0) == 0xE0)
+    {
+        code = s[0] & 0x0Fu;
+        n = 3;
+        min = 0x800;
+    }
+    else if ((s[0] & 0xF8) == 0xF0)
+    {
+        code = s[0] & 0x07u;
+        n = 4;
+        min = 0x10000;
+    }
+    else
+    {
+        *i += 1;
+        return REPLACEMENT;
+    }
+
+    if (n > left)
+    {
+        *i += 1;
+        return REPLACEMENT;
+    }
+    for (size_t k = 1; k < n; ++k)
+    {
+        if ((s[k] & 0xC0) != 0x80)
+        {
+            *i += 1;
+            return REPLACEMENT;
+        }
+        code = (code << 6) | (s[k] & 0x3Fu);
+    }
+    if (code < min || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF))
+    {
+        *i += 1;
+        return REPLACEMENT;
+    }
+    *i += n;
+    return code;
+}
+
+int text_layout_init(struct text_layout *layout, atlas_metrics const *metrics, char const *str, size_t len)
+{
+    if (layout == NULL || metrics == NULL || (str == NULL && len > 0) || len >= UINT32_MAX || metrics->width == 0
+        || metrics->height == 0)
+        return -1;
+
+    memset(layout, 0, sizeof(*layout));
+
+    // Every byte is at most one quad.
+    layout->vertices = calloc((len * VERTICES_PER_QUAD) + 1, sizeof(*layout->vertices));
+    layout->offsets = calloc(len + 1, sizeof(*layout->offsets));
+    if (layout->vertices == NULL || layout->offsets == NULL)
+    {
+        text_layout_free(layout);
+        return -1;
+    }
+
+    atlas_glyph const *const fallback = atlas_metrics_find(metrics, FALLBACK);
+    float const atlas_width = (float)metrics->width;
+    float const atlas_height = (float)metrics->height;
+    SDL_Color const white = { 0xFF, 0xFF, 0xFF, 0xFF };
+    float pen = 0.0f;
+    float top = 0.0f;
+    for (size_t i = 0; i < len;)
+    {
+        uint32_t const offset = (uint32_t)i;
+        uint32_t const code = decode_utf8(str, len, &i);
+        if (code == '\n')
+        {
+            pen = 0.0f;
+            top += (float)metrics->line_height;
+            continue;
+        }
+
+        atlas_glyph const *g = atlas_metrics_find(metrics, code);
+        if (g == NULL)
+            g = fallback;
+        if (g == NULL)
+            continue;
+
+        if (g->width != 0 && g->height != 0)
+        {
+            float const x0 = pen + (float)g->bearing_x;
+            float const y0 = top + (float)(metrics->ascent - g->bearing_y);
+            float const x1 = x0 + (float)g->width;
+            float const y1 = y0 + (float)g->height;
+            float const u0 = (float)g->x / atlas_width;
+            float const v0 = (float)g->y / atlas_height;
+            float const u1 = (float)(g->x + g->width) / atlas_width;
+            float const v1 = (float)(g->y + g->height) / atlas_height;
+
+            SDL_Vertex *const v = &layout->vertices[layout->count * VERTICES_PER_QUAD];
+            v[0] = (SDL_Vertex){ { x0, y0 }, white, { u0, v0 } };
+            v[1] = (SDL_Vertex){ { x1, y0 }, white, { u1, v0 } };
+            v[2] = (SDL_Vertex){ { x0, y1 }, white, { u0, v1 } };
+            v[3] = (SDL_Vertex){ { x1, y1 }, white, { u1, v1 } };
+            layout->offsets[layout->count++] = offset;
+        }
+        pen += (float)g->advance;
+        layout->width = SDL_max(layout->width, pen);
+    }
+    layout->height = top + (float)metrics->line_height;
+
+    // Give back the room reserved for bytes that did not become quads.
+    if (layout->count < len)
+    {
+        SDL_Vertex *vertices = realloc(layout->vertices, ((layout->count * VERTICES_PER_QUAD) + 1) * sizeof(*vertices));
+        if (vertices != NULL)
+            layout->vertices = vertices;
+        uint32_t *offsets = realloc(layout->offsets, (layout->count + 1) * sizeof(*offsets));
+        if (offsets != NULL)
+            layout->offsets = offsets;
+    }
+    return 0;
+}
+
+void text_layout_free(struct text_layout *layout)
+{
+    if (layout == NULL)
+        return;
+
+    free(layout->offsets);
+    free(layout->vertices);
+    memset(layout, 0, sizeof(*layout));
+}
+
+/// Uploads the atlas as white pixels with its alpha as coverage.
+static SDL_Texture *create_atlas(SDL_Renderer *renderer, atlas_metrics const *metrics, bmp_pixel32 const *pixels)
+{
+    if (metrics->width > INT_MAX / sizeof(*pixels) || metrics->height > INT_MAX)
+        return NULL;
+
+    size_t const size = (size_t)metrics->width * metrics->height;
+    bmp_pixel32 *white = malloc(size * sizeof(*white));
+    if (white == NULL)
+        return NULL;
+
+    for (size_t i = 0; i < size; ++i)
+        white[i] = (bmp_pixel32){ 0xFF, 0xFF, 0xFF, pixels[i].a };
+
+    int const width = (int)metrics->width;
+    int const height = (int)metrics->height;
+    SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_BGRA32, SDL_TEXTUREACCESS_STATIC, width, height);
+    if (texture != NULL && SDL_UpdateTexture(texture, NULL, white, width * (int)sizeof(*white)) != 0)
+    {
+        SDL_DestroyTexture(texture);
+        texture = NULL;
+    }
+    free(white);
+    if (texture != NULL)
+        (void)SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+    return texture;
+}
+
+struct text_renderer *text_renderer_create(SDL_Renderer *renderer, atlas_metrics *metrics, bmp_pixel32 const *pixels,
+                                           size_t cache_budget)
+{
+    if (renderer == NULL || metrics == NULL || pixels == NULL || metrics->sdf_spread != 0)
+        return NULL;
+
+    struct text_renderer *text = calloc(1, sizeof(*text));
+    if (text == NULL)
+        return NULL;
+
+    text->cache = text_cache_create(cache_budget);
+    if (text->cache == NULL)
+    {
+        free(text);
+        return NULL;
+    }
+    text->atlas = create_atlas(renderer, metrics, pixels);
+    if (text->atlas == NULL)
+    {
+        text_cache_destroy(text->cache);
+        free(text);
+        return NULL;
+    }
+    text->renderer = renderer;
+    text->reusing = 1;
+    text->metrics = *metrics;
+    memset(metrics, 0, sizeof(*metrics));
+    return text;
+}
+
+void text_renderer_destroy(struct text_renderer *text)
+{
+    if (text == NULL)
+        return;
+
+    text_cache_destroy(text->cache);
+    free(text->draws);
+    free(text->indices);
+    free(text->vertices);
+    SDL_DestroyTexture(text->atlas);
+    atlas_metrics_free(&text->metrics);
+    free(text);
+}
+
+/// Makes room for at least n quads in the vertex buffer.
+static int reserve(struct text_renderer *text, size_t n)
+{
+    if (n <= text->capacity)
+        return 0;
+
+    size_t capacity = SDL_max(text->capacity * 2, 64);
+    while (capacity < n)
+        capacity *= 2;
+
+    if (capacity > INT_MAX / INDICES_PER_QUAD)
+        return -1;
+
+    SDL_Vertex *vertices = realloc(text->vertices, capacity * VERTICES_PER_QUAD * sizeof(*vertices));
+    if (vertices == NULL)
+        return -1;
+
+    text->vertices = vertices;
+    int *indices = realloc(text->indices, capacity * INDICES_PER_QUAD * sizeof(*indices));
+    if (indices == NULL)
+        return -1;
+
+    text->indices = indices;
+    // The triangles of a quad only depend on where its vertices start.
+    for (size_t q = text->capacity; q < capacity; ++q)
+    {
+        int const v = (int)(q * VERTICES_PER_QUAD);
+        int *const i = &indices[q * INDICES_PER_QUAD];
+        i[0] = v;
+        i[1] = v + 1;
+        i[2] = v + 2;
+        i[3] = v + 2;
+        i[4] = v + 1;
+        i[5] = v + 3;
+    }
+    text->capacity = capacity;
+    return 0;
+}
+
+/// Makes room for one more draw record.
+static int reserve_draw(struct text_renderer *text)
+{
+    if (text->draw_count < text->draw_capacity)
+        return 0;
+
+    size_t const capacity = SDL_max(text->draw_capacity * 2, 16);
+    struct text_draw_record *draws = realloc(text->draws, capacity * sizeof(*draws));
+    if (draws == NULL)
+        return -1;
+
+    text->draws = draws;
+    text->draw_capacity = capacity;
+    return 0;
+}
+
+static int same_draw(struct text_draw_record const *a, struct text_draw_record const *b)
+{
+    return a->version == b->version && a->x == b->x && a->y == b->y && a->color.r == b->color.r
+        && a->color.g == b->color.g && a->color.b == b->color.b && a->color.a == b->color.a;
+}
+
+int text_draw(struct text_renderer *text, char const *str, float x, float y, SDL_Color color)
+{
+    if (text == NULL || str == NULL)
+        return -1;
+
+    struct text_layout const *layout = text_cache_get(text->cache, &text->metrics, str, strlen(str));
+    if (layout == NULL || reserve(text, text->count + layout->count) != 0 || reserve_draw(text) != 0)
+        return -1;
+
+    // While every string so far matches the last frame, the vertex buffer
+    // already holds this one too.
+    struct text_draw_record const draw = { layout->version, x, y, color };
+    struct text_draw_record *const last = &text->draws[text->draw_count];
+    text->reusing = text->reusing && text->draw_count < text->last_draw_count && same_draw(last, &draw);
+    if (!text->reusing)
+    {
+        SDL_Vertex *const out = &text->vertices[text->count * VERTICES_PER_QUAD];
+        size_t const n = layout->count * VERTICES_PER_QUAD;
+        for (size_t i = 0; i < n; ++i)
+        {
+            SDL_Vertex const *const v = &layout->vertices[i];
+            out[i] = (SDL_Vertex){ { v->position.x + x, v->position.y + y }, color, v->tex_coord };
+        }
+    }
+    *last = draw;
+    ++text->draw_count;
+    text->count += layout->count;
+    return 0;
+}
+
+int text_flush(struct text_renderer *text)
+{
+    if (text == NULL)
+        return -1;
+
+    int const quads = (int)text->count;
+    text->count = 0;
+    text->last_draw_count = text->draw_count;
+    text->draw_count = 0;
+    text->reusing = 1;
+    text_cache_next_frame(text->cache);
+    if (quads == 0)
+        return 0;
+
+    int const rc = SDL_RenderGeometry(text->renderer, text->atlas, text->vertices, quads * VERTICES_PER_QUAD,
+                                      text->indices, quads * INDICES_PER_QUAD);
+    return (rc == 0) ? 0 : -1;
+}
+
+void text_get_cache_stats(struct text_renderer const *text, struct text_cache_stats *stats)
+{
+    if (text != NULL)
+        text_cache_get_stats(text->cache, stats);
+}
@@ -0,0 +1,340 @@
+#include "text_cache.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atlas.h"
+#include "text.h"
+
+enum
+{
+    MIN_BUCKETS = 16, // Power of two
+    VERTICES_PER_QUAD = 4,
+};
+
+static uint64_t const FNV_OFFSET_BASIS = 0xCBF29CE484222325;
+static uint64_t const FNV_PRIME = 0x100000001B3;
+
+/// A cached layout, in a hash bucket and in the recency list.
+struct text_cache_entry
+{
+    struct text_cache_entry *chain; // Next entry in the same bucket
+    struct text_cache_entry *newer; // Next more recently used entry
+    struct text_cache_entry *older; // Next less recently used entry
+    atlas_metrics const *font;
+    uint64_t key;   // Hash of the font and the string with its digits replaced by '0'
+    uint64_t frame; // Last frame the layout was returned in
+    size_t size;    // Memory held by the entry (bytes)
+    size_t len;     // Length of str (bytes)
+    int patchable;  // Non-zero if the digits of the layout can be rewritten in place
+    struct text_layout layout;
+    char str[]; // The string the layout currently shows
+};
+
+struct text_cache
+{
+    struct text_cache_entry **buckets;
+    size_t bucket_count;                // Power of two
+    struct text_cache_entry *newest;    // Most recently used entry
+    struct text_cache_entry *oldest;    // Least recently used entry
+    struct text_cache_entry *oversized; // Last string larger than the budget, outside the table
+    size_t budget;                      // Maximum of stats.size
+    uint64_t frame;                     // Current frame
+    uint64_t version;                   // Last version given to a layout
+    struct text_cache_stats stats;
+};
+
+static int is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+/// Hashes the font and the string with 64-bit FNV-1a, treating every digit as '0'.
+static uint64_t make_key(atlas_metrics const *font, char const *str, size_t len)
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+    uintptr_t const id = (uintptr_t)font;
+    for (size_t i = 0; i < sizeof(id); ++i)
+        hash = (hash ^ ((id >> (i * 8)) & 0xFF)) * FNV_PRIME;
+
+    for (size_t i = 0; i < len; ++i)
+        hash = (hash ^ (unsigned char)(is_digit(str[i]) ? '0' : str[i])) * FNV_PRIME;
+
+    return hash;
+}
+
+/// Checks whether a string equals the string of an entry, apart from digits.
+static int same_shape(struct text_cache_entry const *e, char const *str, size_t len)
+{
+    if (e->len != len)
+        return 0;
+
+    for (size_t i = 0; i < len; ++i)
+    {
+        if (e->str[i] != str[i] && !(is_digit(e->str[i]) && is_digit(str[i])))
+            return 0;
+    }
+    return 1;
+}
+
+/// Checks whether a digit can be replaced by any other without moving the glyphs around it.
+static int digits_patchable(atlas_metrics const *font)
+{
+    atlas_glyph const *zero = atlas_metrics_find(font, '0');
+    for (char c = '0'; c <= '9'; ++c)
+    {
+        atlas_glyph const *g = atlas_metrics_find(font, (uint32_t)c);
+        if (g == NULL || g->width == 0 || g->height == 0 || g->advance != zero->advance)
+            return 0;
+    }
+    return 1;
+}
+
+/// Replaces the glyph of a quad with another glyph drawn from the same pen position.
+static void replace_quad(SDL_Vertex *v, atlas_metrics const *font, atlas_glyph const *from, atlas_glyph const *to)
+{
+    float const x0 = v[0].position.x + (float)(to->bearing_x - from->bearing_x);
+    float const y0 = v[0].position.y + (float)(from->bearing_y - to->bearing_y);
+    float const x1 = x0 + (float)to->width;
+    float const y1 = y0 + (float)to->height;
+    float const u0 = (float)to->x / (float)font->width;
+    float const v0 = (float)to->y / (float)font->height;
+    float const u1 = (float)(to->x + to->width) / (float)font->width;
+    float const v1 = (float)(to->y + to->height) / (float)font->height;
+    SDL_Color const color = v[0].color;
+    v[0] = (SDL_Vertex){ { x0, y0 }, color, { u0, v0 } };
+    v[1] = (SDL_Vertex){ { x1, y0 }, color, { u1, v0 } };
+    v[2] = (SDL_Vertex){ { x0, y1 }, color, { u0, v1 } };
+    v[3] = (SDL_Vertex){ { x1, y1 }, color, { u1, v1 } };
+}
+
+/// Rewrites the quads of the digits that differ between the entry and str.
+static void patch(struct text_cache_entry *e, char const *str)
+{
+    struct text_layout *const layout = &e->layout;
+    for (size_t q = 0; q < layout->count; ++q)
+    {
+        uint32_t const offset = layout->offsets[q];
+        if (e->str[offset] == str[offset])
+            continue;
+
+        atlas_glyph const *from = atlas_metrics_find(e->font, (uint32_t)e->str[offset]);
+        atlas_glyph const *to = atlas_metrics_find(e->font, (uint32_t)str[offset]);
+        replace_quad(&layout->vertices[q * VERTICES_PER_QUAD], e->font, from, to);
+        e->str[offset] = str[offset];
+    }
+}
+
+static void unlink_recent(struct text_cache *cache, struct text_cache_entry *e)
+{
+    if (e->newer != NULL)
+        e->newer->older = e->older;
+    else
+        cache->newest = e->older;
+
+    if (e->older != NULL)
+        e->older->newer = e->newer;
+    else
+        cache->oldest = e->newer;
+
+    e->newer = NULL;
+    e->older = NULL;
+}
+
+static void link_newest(struct text_cache *cache, struct text_cache_entry *e)
+{
+    e->older = cache->newest;
+    e->newer = NULL;
+    if (cache->newest != NULL)
+        cache->newest->newer = e;
+    else
+        cache->oldest = e;
+
+    cache->newest = e;
+}
+
+static void free_entry(struct text_cache_entry *e)
+{
+    if (e == NULL)
+        return;
+
+    text_layout_free(&e->layout);
+    free(e);
+}
+
+/// Removes the least recently used entry.
+static void evict(struct text_cache *cache)
+{
+    struct text_cache_entry *const e = cache->oldest;
+    struct text_cache_entry **p = &cache->buckets[e->key & (cache->bucket_count - 1)];
+    while (*p != e)
+        p = &(*p)->chain;
+
+    *p = e->chain;
+    unlink_recent(cache, e);
+    cache->stats.size -= e->size;
+    --cache->stats.entries;
+    ++cache->stats.evictions;
+    free_entry(e);
+}
+
+/// Doubles the number of buckets.  Failing to grow only lengthens the chains.
+static void grow(struct text_cache *cache)
+{
+    size_t const count = cache->bucket_count * 2;
+    struct text_cache_entry **buckets = calloc(count, sizeof(*buckets));
+    if (buckets == NULL)
+        return;
+
+    for (size_t i = 0; i < cache->bucket_count; ++i)
+    {
+        for (struct text_cache_entry *e = cache->buckets[i], *next = NULL; e != NULL; e = next)
+        {
+            next = e->chain;
+            struct text_cache_entry **bucket = &buckets[e->key & (count - 1)];
+            e->chain = *bucket;
+            *bucket = e;
+        }
+    }
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->bucket_count = count;
+}
+
+/// Lays out a string into a new entry.
+static struct text_cache_entry *create_entry(atlas_metrics const *font, uint64_t key, char const *str, size_t len)
+{
+    struct text_cache_entry *e = calloc(1, sizeof(*e) + len + 1);
+    if (e == NULL)
+        return NULL;
+
+    if (text_layout_init(&e->layout, font, str, len) != 0)
+    {
+        free(e);
+        return NULL;
+    }
+    memcpy(e->str, str, len);
+    e->font = font;
+    e->key = key;
+    e->len = len;
+    e->size = sizeof(*e) + len + 1
+            + (e->layout.count * (VERTICES_PER_QUAD * sizeof(*e->layout.vertices) + sizeof(*e->layout.offsets)));
+    for (size_t i = 0; i < len && !e->patchable; ++i)
+        e->patchable = is_digit(str[i]);
+
+    e->patchable = e->patchable && digits_patchable(font);
+    return e;
+}
+
+struct text_cache *text_cache_create(size_t budget)
+{
+    struct text_cache *cache = calloc(1, sizeof(*cache));
+    if (cache == NULL)
+        return NULL;
+
+    cache->buckets = calloc(MIN_BUCKETS, sizeof(*cache->buckets));
+    if (cache->buckets == NULL)
+    {
+        free(cache);
+        return NULL;
+    }
+    cache->bucket_count = MIN_BUCKETS;
+    cache->budget = budget;
+    cache->frame = 1;
+    return cache;
+}
+
+void text_cache_destroy(struct text_cache *cache)
+{
+    if (cache == NULL)
+        return;
+
+    for (struct text_cache_entry *e = cache->newest, *next = NULL; e != NULL; e = next)
+    {
+        next = e->older;
+        free_entry(e);
+    }
+    free_entry(cache->oversized);
+    free(cache->buckets);
+    free(cache);
+}
+
+struct text_layout const *text_cache_get(struct text_cache *cache, atlas_metrics const *font, char const *str, size_t len)
+{
+    if (cache == NULL || font == NULL || (str == NULL && len > 0))
+        return NULL;
+
+    uint64_t const key = make_key(font, str, len);
+    struct text_cache_entry **const bucket = &cache->buckets[key & (cache->bucket_count - 1)];
+    struct text_cache_entry *patch_target = NULL;
+    for (struct text_cache_entry *e = *bucket; e != NULL; e = e->chain)
+    {
+        if (e->key != key || e->font != font || !same_shape(e, str, len))
+            continue;
+
+        if (memcmp(e->str, str, len) == 0)
+        {
+            unlink_recent(cache, e);
+            link_newest(cache, e);
+            e->frame = cache->frame;
+            ++cache->stats.hits;
+            return &e->layout;
+        }
+        // A layout already drawn this frame keeps its string until the next one.
+        if (patch_target == NULL && e->patchable && e->frame != cache->frame)
+            patch_target = e;
+    }
+
+    if (patch_target != NULL)
+    {
+        patch(patch_target, str);
+        unlink_recent(cache, patch_target);
+        link_newest(cache, patch_target);
+        patch_target->frame = cache->frame;
+        patch_target->layout.version = ++cache->version;
+        ++cache->stats.patches;
+        return &patch_target->layout;
+    }
+
+    struct text_cache_entry *const e = create_entry(font, key, str, len);
+    if (e == NULL)
+        return NULL;
+
+    ++cache->stats.misses;
+    e->frame = cache->frame;
+    e->layout.version = ++cache->version;
+    if (e->size > cache->budget)
+    {
+        free_entry(cache->oversized);
+        cache->oversized = e;
+        return &e->layout;
+    }
+
+    while (cache->oldest != NULL && cache->stats.size + e->size > cache->budget)
+        evict(cache);
+
+    // The bucket may have moved if the table grows, so insert before growing.
+    e->chain = *bucket;
+    *bucket = e;
+    link_newest(cache, e);
+    cache->stats.size += e->size;
+    if (++cache->stats.entries > cache->bucket_count)
+        grow(cache);
+
+    return &e->layout;
+}
+
+void text_cache_next_frame(struct text_cache *cache)
+{
+    if (cache != NULL)
+        ++cache->frame;
+}
+
+void text_cache_get_stats(struct text_cache const *cache, struct text_cache_stats *stats)
+{
+    if (cache == NULL || stats == NULL)
+        return;
+
+    *stats = cache->stats;
+}
@@ -0,0 +1,242 @@
+/// Test for the asset_cache functions.
+///
+/// This test writes a source bitmap into a scratch directory, checks that the
+/// cache misses, stores the decoded pixels and checks that the entry maps back
+/// the same pixels.  It then rewrites the source with a different size, then
+/// with the same size within the same second, and truncates the entry, and
+/// checks that stale and corrupt entries miss.
+///
+/// @see asset_cache_open()
+/// @see asset_cache_store()
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef _WIN32
+#    include <io.h>
+#    include <windows.h>
+#else
+#    include <sys/stat.h>
+#endif
+
+#include "asset_cache.h"
+#include "bmp.h"
+
+enum
+{
+    WIDTH = 13,
+    HEIGHT = 7,
+};
+
+static char *join(char const *dir, char const *file)
+{
+    size_t const len = strlen(dir) + strlen(file) + 2;
+    char *path = malloc(len);
+    if (path != NULL)
+    {
+        (void)snprintf(path, len, "%s/%s", dir, file);
+    }
+    return path;
+}
+
+/// Writes a source bitmap and returns its decoded pixels.  seed varies the pixels.
+static bmp_pixel32 *write_source(char const *source, size_t width, size_t height, uint8_t seed)
+{
+    bmp_pixel32 *buffer = malloc(width * height * sizeof(*buffer));
+    if (buffer == NULL)
+    {
+        return NULL;
+    }
+    for (size_t i = 0; i < width * height; ++i)
+    {
+        buffer[i] = (bmp_pixel32){ (uint8_t)i, (uint8_t)(i / width), (uint8_t)(height + seed), 0xFF };
+    }
+    int const rc = bmp_v4_write(buffer, width, height, source);
+    free(buffer);
+    if (rc != 0)
+    {
+        return NULL;
+    }
+
+    bmp_pixel32 *pixels = NULL;
+    size_t w = 0;
+    size_t h = 0;
+    if (bmp_load(source, &pixels, &w, &h) != 0 || w != width || h != height)
+    {
+        free(pixels);
+        return NULL;
+    }
+    return pixels;
+}
+
+/// Sets the modification time of a file.
+static int set_mtime(char const *file, int64_t sec, long nsec)
+{
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(file, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, NULL);
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        return -1;
+    }
+    // A FILETIME counts 100 ns intervals from 1601-01-01.
+    uint64_t const ticks = ((uint64_t)sec + 11644473600u) * 10000000u + (uint64_t)nsec / 100u;
+    FILETIME const mtime = { .dwLowDateTime = (DWORD)ticks, .dwHighDateTime = (DWORD)(ticks >> 32) };
+    BOOL const ok = SetFileTime(handle, NULL, &mtime, &mtime);
+    CloseHandle(handle);
+    return ok ? 0 : -1;
+#else
+    struct timespec const mtime = { .tv_sec = (time_t)sec, .tv_nsec = nsec };
+    struct timespec const times[2] = { mtime, mtime };
+    return utimensat(AT_FDCWD, file, times, 0);
+#endif
+}
+
+/// Truncates a file to the given size.
+static int truncate_file(char const *file, long size)
+{
+#ifdef _WIN32
+    int const fd = _open(file, _O_RDWR | _O_BINARY);
+    if (fd == -1)
+    {
+        return -1;
+    }
+    int const rc = _chsize(fd, size);
+    _close(fd);
+    return rc;
+#else
+    return truncate(file, (off_t)size);
+#endif
+}
+
+/// Stores the pixels of a source and checks that they map back unchanged.
+static int check_round_trip(char const *dir, char const *source, bmp_pixel32 const *pixels, size_t width, size_t height)
+{
+    asset_cache_entry entry;
+    if (asset_cache_open(dir, source, &entry) != 1)
+    {
+        return -1;
+    }
+    if (asset_cache_store(dir, source, pixels, width, height) != 0)
+    {
+        return -1;
+    }
+    if (asset_cache_open(dir, source, &entry) != 0)
+    {
+        return -1;
+    }
+    int ret = 0;
+    if (entry.width != width || entry.height != height || memcmp(entry.pixels, pixels, width * height * sizeof(*pixels)) != 0)
+    {
+        ret = -1;
+    }
+    asset_cache_close(&entry);
+    return ret;
+}
+
+static int check(char const *dir, char const *source, char const *entry_path)
+{
+    bmp_pixel32 *pixels = write_source(source, WIDTH, HEIGHT, 0);
+    if (pixels == NULL)
+    {
+        return -1;
+    }
+    int rc = check_round_trip(dir, source, pixels, WIDTH, HEIGHT);
+    free(pixels);
+    if (rc != 0)
+    {
+        return -1;
+    }
+
+    // A rewritten source makes the entry stale.
+    pixels = write_source(source, WIDTH, HEIGHT * 2, 0);
+    if (pixels == NULL)
+    {
+        return -1;
+    }
+    rc = check_round_trip(dir, source, pixels, WIDTH, HEIGHT * 2);
+    free(pixels);
+    if (rc != 0)
+    {
+        return -1;
+    }
+
+    // So does a source rewritten at the same size within the same second.
+    for (uint8_t seed = 1; seed <= 2; ++seed)
+    {
+        pixels = write_source(source, WIDTH, HEIGHT * 2, seed);
+        if (pixels == NULL)
+        {
+            return -1;
+        }
+        rc = set_mtime(source, 1000000000, 250000000L * seed);
+        if (rc == 0)
+        {
+            rc = check_round_trip(dir, source, pixels, WIDTH, HEIGHT * 2);
+        }
+        free(pixels);
+        if (rc != 0)
+        {
+            return -1;
+        }
+    }
+
+    // A truncated entry is treated as missing.
+    if (truncate_file(entry_path, 100) != 0)
+    {
+        return -1;
+    }
+    asset_cache_entry entry;
+    if (asset_cache_open(dir, source, &entry) != 1)
+    {
+        asset_cache_close(&entry);
+        return -1;
+    }
+
+    // A missing source is an error rather than a miss.
+    if (asset_cache_open(dir, "missing.bmp", &entry) != -1)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2)
+    {
+        return EXIT_FAILURE;
+    }
+
+    char const *dir = argv[1];
+    if (asset_cache_init(dir) != 0 || asset_cache_init(dir) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    int ret = EXIT_FAILURE;
+    char *source = join(dir, "source.bmp");
+    char *entry_path = asset_cache_path(dir, source);
+    if (source != NULL && entry_path != NULL && check(dir, source, entry_path) == 0)
+    {
+        ret = EXIT_SUCCESS;
+    }
+
+    if (source != NULL)
+        remove(source);
+    if (entry_path != NULL)
+        remove(entry_path);
+    free(source);
+    free(entry_path);
+    if (rmdir(dir) != 0)
+    {
+        ret = EXIT_FAILURE;
+    }
+    return ret;
+}
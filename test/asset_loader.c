@@ -0,0 +1,144 @@
+/// Test for the asset_loader functions.
+///
+/// This test submits several copies of two BMP files and one missing file to a
+/// loader with more assets than workers, collects every result and checks
+/// their identifiers, statuses and dimensions.  It also checks that the loader
+/// refuses submissions beyond its capacity and that destroying it with
+/// uncollected assets frees them.
+///
+/// @see asset_loader_submit()
+/// @see asset_loader_get()
+/// @see asset_loader_try_get()
+/// @see asset_loader_destroy()
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <SDL.h>
+
+#include "asset_loader.h"
+#include "bmp.h"
+
+enum
+{
+    THREADS = 3,
+    CAPACITY = 16,
+    COPIES = 5, // Copies of each file
+};
+
+struct expected
+{
+    char const *file;
+    size_t width;
+    size_t height;
+};
+
+static int check_load(struct expected const files[static 3])
+{
+    struct asset_loader *loader = asset_loader_create(THREADS, CAPACITY, NULL);
+    if (loader == NULL)
+    {
+        return -1;
+    }
+
+    int ret = 0;
+    int seen[3 * COPIES] = { 0 };
+    for (intptr_t id = 0; id < 3 * COPIES; ++id)
+    {
+        if (asset_loader_submit(loader, files[id % 3].file, id) != 0)
+        {
+            ret = -1;
+            goto out_destroy;
+        }
+    }
+    if (asset_loader_pending(loader) != 3 * COPIES)
+    {
+        ret = -1;
+        goto out_destroy;
+    }
+
+    struct asset asset;
+    int rc = 0;
+    while ((rc = asset_loader_get(loader, &asset)) == 0)
+    {
+        if (asset.id < 0 || asset.id >= 3 * COPIES || seen[asset.id]++ != 0)
+        {
+            ret = -1;
+        }
+        else
+        {
+            struct expected const *want = &files[asset.id % 3];
+            int const ok = (want->width == 0) ? (asset.status != 0)
+                                              : (asset.status == 0 && asset.width == want->width && asset.height == want->height
+                                                 && asset.pixels != NULL);
+            if (!ok)
+            {
+                ret = -1;
+            }
+        }
+        asset_release(&asset);
+    }
+    if (rc != 1 || asset_loader_try_get(loader, &asset) != 1)
+    {
+        ret = -1;
+    }
+    for (int i = 0; i < 3 * COPIES; ++i)
+    {
+        if (seen[i] != 1)
+        {
+            ret = -1;
+        }
+    }
+
+out_destroy:
+    asset_loader_destroy(loader);
+    return ret;
+}
+
+static int check_capacity(char const *file)
+{
+    struct asset_loader *loader = asset_loader_create(1, 2, NULL);
+    if (loader == NULL)
+    {
+        return -1;
+    }
+    int ret = 0;
+    if (asset_loader_submit(loader, file, 0) != 0 || asset_loader_submit(loader, file, 1) != 0
+        || asset_loader_submit(loader, file, 2) != 1)
+    {
+        ret = -1;
+    }
+    // Destroying the loader frees whatever was not collected.
+    asset_loader_destroy(loader);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // The missing file is expected to fail, which a width of zero marks.
+    struct expected files[3] = {
+        { argv[1], 0, 0 },
+        { argv[2], 0, 0 },
+        { "missing.bmp", 0, 0 },
+    };
+    for (int i = 0; i < 2; ++i)
+    {
+        bmp_pixel32 *pixels = NULL;
+        if (bmp_load(files[i].file, &pixels, &files[i].width, &files[i].height) != 0)
+        {
+            return EXIT_FAILURE;
+        }
+        free(pixels);
+    }
+
+    if (check_load(files) != 0 || check_capacity(argv[1]) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,198 @@
+/// Test for the atlas functions.
+///
+/// This test packs thousands of random rectangles and a font's worth of equal
+/// glyph cells, and checks that every rectangle lies inside a near-square
+/// power-of-two atlas without overlapping its neighbors or their padding.  It
+/// then writes a metrics table to a scratch file, reads it back and looks up
+/// glyphs by codepoint.
+///
+/// @see atlas_pack()
+/// @see atlas_metrics_write()
+/// @see atlas_metrics_read()
+/// @see atlas_metrics_find()
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atlas.h"
+
+enum
+{
+    RANDOM_COUNT = 4000,
+    GLYPH_COUNT = 94, // Printable ASCII
+    PADDING = 1,
+    MAX_SIZE = 4096,
+};
+
+static int is_pow2(uint32_t n)
+{
+    return n != 0 && (n & (n - 1)) == 0;
+}
+
+/// Checks that the packed rectangles are in bounds and do not overlap, and
+/// returns the fraction of the atlas they cover.
+static int check_packing(atlas_rect const *rects, size_t n, uint32_t padding, uint32_t width, uint32_t height, double *coverage)
+{
+    if (!is_pow2(width) || !is_pow2(height) || width > 2 * height || height > 2 * width)
+    {
+        return -1;
+    }
+    unsigned char *used = calloc((size_t)width * height, 1);
+    if (used == NULL)
+    {
+        return -1;
+    }
+    int ret = 0;
+    uint64_t area = 0;
+    for (size_t i = 0; ret == 0 && i < n; ++i)
+    {
+        atlas_rect const *r = &rects[i];
+        if (r->width == 0 || r->height == 0)
+        {
+            continue;
+        }
+        if (r->x + r->width > width || r->y + r->height > height)
+        {
+            ret = -1;
+            break;
+        }
+        // Mark the rectangle with its padding, clipped to the atlas.
+        uint32_t const right = (r->x + r->width + padding < width) ? r->x + r->width + padding : width;
+        uint32_t const bottom = (r->y + r->height + padding < height) ? r->y + r->height + padding : height;
+        for (uint32_t y = r->y; ret == 0 && y < bottom; ++y)
+        {
+            for (uint32_t x = r->x; x < right; ++x)
+            {
+                if (used[((size_t)y * width) + x]++ != 0)
+                {
+                    ret = -1;
+                    break;
+                }
+            }
+        }
+        area += (uint64_t)r->width * r->height;
+    }
+    free(used);
+    *coverage = (double)area / ((double)width * height);
+    return ret;
+}
+
+static int check_random(void)
+{
+    static atlas_rect rects[RANDOM_COUNT];
+    uint32_t state = 1;
+    for (size_t i = 0; i < RANDOM_COUNT; ++i)
+    {
+        state = (state * 1103515245) + 12345;
+        rects[i].width = (state >> 16) % 24;
+        state = (state * 1103515245) + 12345;
+        rects[i].height = 1 + ((state >> 16) % 32);
+    }
+    uint32_t width = 0;
+    uint32_t height = 0;
+    if (atlas_pack(rects, RANDOM_COUNT, PADDING, MAX_SIZE, &width, &height) != 0)
+    {
+        return -1;
+    }
+    double coverage = 0.0;
+    if (check_packing(rects, RANDOM_COUNT, PADDING, width, height, &coverage) != 0 || coverage < 0.7)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+static int check_cells(void)
+{
+    atlas_rect rects[GLYPH_COUNT];
+    for (size_t i = 0; i < GLYPH_COUNT; ++i)
+    {
+        rects[i] = (atlas_rect){ .width = 10, .height = 20 };
+    }
+    uint32_t width = 0;
+    uint32_t height = 0;
+    if (atlas_pack(rects, GLYPH_COUNT, 0, MAX_SIZE, &width, &height) != 0)
+    {
+        return -1;
+    }
+    double coverage = 0.0;
+    if (check_packing(rects, GLYPH_COUNT, 0, width, height, &coverage) != 0 || width != 256 || height != 128)
+    {
+        return -1;
+    }
+
+    // Too large for the maximum size
+    if (atlas_pack(rects, GLYPH_COUNT, 0, 64, &width, &height) == 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+static int check_metrics(char const *file)
+{
+    atlas_glyph glyphs[GLYPH_COUNT];
+    for (size_t i = 0; i < GLYPH_COUNT; ++i)
+    {
+        size_t const j = GLYPH_COUNT - 1 - i; // Written in reverse to exercise sorting
+        glyphs[j] = (atlas_glyph){
+            .code = (uint32_t)('!' + i),
+            .x = (uint16_t)(i * 10),
+            .width = 10,
+            .height = 20,
+            .bearing_y = 16,
+            .advance = 10,
+        };
+    }
+    atlas_metrics metrics = {
+        .width = 1024,
+        .height = 32,
+        .line_height = 20,
+        .ascent = 16,
+        .sdf_spread = 4,
+        .count = GLYPH_COUNT,
+        .glyphs = glyphs,
+    };
+    atlas_metrics_sort(&metrics);
+    if (atlas_metrics_write(&metrics, file) != 0)
+    {
+        return -1;
+    }
+
+    atlas_metrics read;
+    if (atlas_metrics_read(file, &read) != 0)
+    {
+        return -1;
+    }
+    int ret = 0;
+    atlas_glyph const *a = atlas_metrics_find(&read, 'A');
+    if (read.width != 1024 || read.height != 32 || read.line_height != 20 || read.ascent != 16 || read.sdf_spread != 4 || read.count != GLYPH_COUNT
+        || memcmp(read.glyphs, glyphs, sizeof(glyphs)) != 0 || a == NULL || a->x != ('A' - '!') * 10
+        || atlas_metrics_find(&read, ' ') != NULL)
+    {
+        ret = -1;
+    }
+    atlas_metrics_free(&read);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2)
+    {
+        return EXIT_FAILURE;
+    }
+
+    char const *scratch_file = argv[1];
+
+    int ret = EXIT_SUCCESS;
+    if (check_random() != 0 || check_cells() != 0 || check_metrics(scratch_file) != 0)
+    {
+        ret = EXIT_FAILURE;
+    }
+
+    remove(scratch_file);
+    return ret;
+}
@@ -0,0 +1,198 @@
+/// Test for the audio_latency functions.
+///
+/// This test feeds the controller the timing of simulated devices and checks
+/// that it settles on a clean buffer size, doubles the buffer on overruns,
+/// gaps and busy callbacks, stops at the largest size, and retries a smaller
+/// buffer after a long clean run.
+///
+/// @see audio_latency_update()
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "audio_latency.h"
+
+#define eprintf(...) (void)fprintf(stderr, __VA_ARGS__)
+
+enum
+{
+    SAMPLE_RATE = 48000,
+    MIN_FRAMES = 128,
+    MAX_FRAMES = 512,
+};
+
+/// A simulated device, whose timing starts from zero when it is opened.
+struct device
+{
+    uint32_t frames;
+    struct audio_timing_stats stats;
+};
+
+static void device_open(struct device *device, uint32_t frames)
+{
+    device->frames = frames;
+    memset(&device->stats, 0, sizeof(device->stats));
+    device->stats.deadline_us = 1e6 * (double)frames / SAMPLE_RATE;
+}
+
+/// Plays one second of callbacks and passes the timing to the controller.
+static enum audio_latency_event play_second(struct audio_latency *latency, struct device *device, uint32_t overruns,
+                                            uint32_t gaps, uint32_t busy)
+{
+    uint32_t const callbacks = SAMPLE_RATE / device->frames + 1;
+    device->stats.callbacks += callbacks;
+    device->stats.overruns += overruns;
+    device->stats.gaps += gaps;
+    device->stats.load[1] += callbacks - busy;
+    device->stats.load[9] += busy;
+    enum audio_latency_event const event = audio_latency_update(latency, &device->stats);
+    if (event == AUDIO_LATENCY_RESIZE)
+    {
+        device_open(device, audio_latency_frames(latency));
+    }
+    return event;
+}
+
+static int expect(char const *name, enum audio_latency_event event, enum audio_latency_event expected,
+                  struct device const *device, uint32_t frames)
+{
+    if (event != expected || device->frames != frames)
+    {
+        eprintf("%s: event %d with %u frames, expected %d with %u frames\n", name, (int)event, device->frames,
+                (int)expected, frames);
+        return -1;
+    }
+    return 0;
+}
+
+static int check_settle(void)
+{
+    struct audio_latency latency;
+    audio_latency_init(&latency, MIN_FRAMES, MAX_FRAMES);
+    struct device device;
+    device_open(&device, audio_latency_frames(&latency));
+
+    // Half a second is not a window yet.
+    device.stats.callbacks += SAMPLE_RATE / MIN_FRAMES / 2;
+    if (expect("half window", audio_latency_update(&latency, &device.stats), AUDIO_LATENCY_STEADY, &device, MIN_FRAMES)
+        != 0)
+    {
+        return -1;
+    }
+
+    // The first window only warms up, even with a gap.
+    if (expect("warm up", play_second(&latency, &device, 0, 1, 0), AUDIO_LATENCY_STEADY, &device, MIN_FRAMES) != 0)
+    {
+        return -1;
+    }
+    for (int i = 1; i < 3; ++i)
+    {
+        if (expect("clean", play_second(&latency, &device, 0, 0, 0), AUDIO_LATENCY_STEADY, &device, MIN_FRAMES) != 0)
+        {
+            return -1;
+        }
+    }
+    if (expect("settle", play_second(&latency, &device, 0, 0, 0), AUDIO_LATENCY_SETTLED, &device, MIN_FRAMES) != 0)
+    {
+        return -1;
+    }
+
+    // Already at the smallest size, so it never shrinks.
+    for (int i = 0; i < 200; ++i)
+    {
+        if (expect("steady", play_second(&latency, &device, 0, 0, 0), AUDIO_LATENCY_STEADY, &device, MIN_FRAMES) != 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int check_grow(void)
+{
+    struct audio_latency latency;
+    audio_latency_init(&latency, MIN_FRAMES, MAX_FRAMES);
+    struct device device;
+    device_open(&device, audio_latency_frames(&latency));
+
+    if (play_second(&latency, &device, 0, 0, 0) != AUDIO_LATENCY_STEADY
+        || expect("overrun", play_second(&latency, &device, 1, 0, 0), AUDIO_LATENCY_RESIZE, &device, 2 * MIN_FRAMES)
+               != 0)
+    {
+        return -1;
+    }
+
+    // One busy callback in a hundred is allowed, more is not.
+    uint32_t const callbacks = SAMPLE_RATE / device.frames + 1;
+    if (play_second(&latency, &device, 0, 0, 0) != AUDIO_LATENCY_STEADY
+        || expect("busy", play_second(&latency, &device, 0, 0, callbacks / 100), AUDIO_LATENCY_STEADY, &device,
+                  2 * MIN_FRAMES)
+               != 0
+        || expect("too busy", play_second(&latency, &device, 0, 0, callbacks / 10), AUDIO_LATENCY_RESIZE, &device,
+                  MAX_FRAMES)
+               != 0)
+    {
+        return -1;
+    }
+
+    // At the largest size there is nothing left to do.
+    if (play_second(&latency, &device, 0, 0, 0) != AUDIO_LATENCY_STEADY
+        || expect("max", play_second(&latency, &device, 0, 1, 0), AUDIO_LATENCY_STEADY, &device, MAX_FRAMES) != 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/// Returns the number of seconds until the buffer shrinks, or 0 if it does not within limit.
+static uint32_t seconds_to_shrink(struct audio_latency *latency, struct device *device, uint32_t limit)
+{
+    for (uint32_t i = 1; i <= limit; ++i)
+    {
+        if (play_second(latency, device, 0, 0, 0) == AUDIO_LATENCY_RESIZE)
+        {
+            return i;
+        }
+    }
+    return 0;
+}
+
+static int check_retry(void)
+{
+    struct audio_latency latency;
+    audio_latency_init(&latency, MIN_FRAMES, MAX_FRAMES);
+    struct device device;
+    device_open(&device, audio_latency_frames(&latency));
+
+    // Grow once, then shrink back after a clean run.
+    (void)play_second(&latency, &device, 0, 0, 0);
+    (void)play_second(&latency, &device, 1, 0, 0);
+    uint32_t const first = seconds_to_shrink(&latency, &device, 1000);
+    if (first == 0 || device.frames != MIN_FRAMES)
+    {
+        eprintf("retry: did not shrink back to %u frames\n", MIN_FRAMES);
+        return -1;
+    }
+
+    // Fail again, and the next retry waits twice as long.  Both include a second to warm up.
+    (void)play_second(&latency, &device, 0, 0, 0);
+    (void)play_second(&latency, &device, 1, 0, 0);
+    uint32_t const second = seconds_to_shrink(&latency, &device, 1000);
+    if (second != 2 * first - 1 || device.frames != MIN_FRAMES)
+    {
+        eprintf("retry: shrank after %u then %u seconds\n", first, second);
+        return -1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    if (check_settle() != 0 || check_grow() != 0 || check_retry() != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+/// Test for the audio_timing functions.
+///
+/// This test records callbacks with known counter values and checks the
+/// histogram buckets, maxima, overruns and gaps they land in.
+///
+/// @see audio_timing_record()
+/// @see audio_timing_read()
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "audio_timing.h"
+
+#define eprintf(...) (void)fprintf(stderr, __VA_ARGS__)
+
+enum
+{
+    SAMPLE_RATE = 48000,
+    FRAMES = 480,                // A deadline of 10 ms
+    COUNTER_FREQUENCY = 1000000, // One tick per microsecond
+};
+
+/// A recorded callback, in microseconds.
+struct callback
+{
+    uint64_t begin;
+    uint64_t duration;
+};
+
+static struct callback const CALLBACKS[] = {
+    { 0, 1 },         // Duration bucket 0, load bucket 0
+    { 10000, 3 },     // Duration bucket 1, load bucket 0, interval bucket 13
+    { 20000, 1000 },  // Duration bucket 9, load bucket 1, interval bucket 13
+    { 40000, 12000 }, // Duration bucket 13, load bucket 12, interval bucket 14, overrun and gap
+    { 60000, 90000 }, // Duration bucket 16, load bucket 19, interval bucket 14, overrun and gap
+};
+
+static int check_counts(char const *name, uint32_t const counts[static AUDIO_TIMING_BUCKETS], size_t const *buckets,
+                        size_t n)
+{
+    uint32_t expected[AUDIO_TIMING_BUCKETS] = { 0 };
+    for (size_t i = 0; i < n; ++i)
+    {
+        ++expected[buckets[i]];
+    }
+    for (size_t i = 0; i < AUDIO_TIMING_BUCKETS; ++i)
+    {
+        if (counts[i] != expected[i])
+        {
+            eprintf("%s: bucket %zu is %u, expected %u\n", name, i, counts[i], expected[i]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int check_record(void)
+{
+    struct audio_timing *timing = audio_timing_create(SAMPLE_RATE, FRAMES, COUNTER_FREQUENCY);
+    if (timing == NULL)
+    {
+        return -1;
+    }
+
+    size_t const num_callbacks = sizeof(CALLBACKS) / sizeof(CALLBACKS[0]);
+    for (size_t i = 0; i < num_callbacks; ++i)
+    {
+        audio_timing_record(timing, CALLBACKS[i].begin, CALLBACKS[i].begin + CALLBACKS[i].duration);
+    }
+
+    struct audio_timing_stats stats;
+    audio_timing_read(timing, &stats);
+    int ret = -1;
+    if (stats.deadline_us != 10000.0 || stats.callbacks != num_callbacks || stats.overruns != 2 || stats.gaps != 2
+        || stats.max_duration_us != 90000 || stats.max_interval_us != 20000)
+    {
+        eprintf("audio_timing_read: %u callbacks, %u overruns, %u gaps, max %u us, max interval %u us\n",
+                stats.callbacks, stats.overruns, stats.gaps, stats.max_duration_us, stats.max_interval_us);
+        goto out_destroy_timing;
+    }
+
+    static size_t const DURATION[] = { 0, 1, 9, 13, 16 };
+    static size_t const INTERVAL[] = { 13, 13, 14, 14 };
+    static size_t const LOAD[] = { 0, 0, 1, 12, AUDIO_TIMING_BUCKETS - 1 };
+    if (check_counts("duration", stats.duration.counts, DURATION, sizeof(DURATION) / sizeof(DURATION[0])) != 0
+        || check_counts("interval", stats.interval.counts, INTERVAL, sizeof(INTERVAL) / sizeof(INTERVAL[0])) != 0
+        || check_counts("load", stats.load, LOAD, sizeof(LOAD) / sizeof(LOAD[0])) != 0)
+    {
+        goto out_destroy_timing;
+    }
+    ret = 0;
+out_destroy_timing:
+    audio_timing_destroy(timing);
+    return ret;
+}
+
+static int check_invalid(void)
+{
+    if (audio_timing_create(0, FRAMES, COUNTER_FREQUENCY) != NULL
+        || audio_timing_create(SAMPLE_RATE, 0, COUNTER_FREQUENCY) != NULL
+        || audio_timing_create(SAMPLE_RATE, FRAMES, 0) != NULL)
+    {
+        eprintf("audio_timing_create accepted an invalid argument\n");
+        return -1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    if (check_record() != 0 || check_invalid() != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
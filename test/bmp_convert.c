@@ -0,0 +1,218 @@
+/// Test for the bmp_convert kernels.
+///
+/// This test runs every kernel supported by the CPU over pseudo-random pixels
+/// of varying lengths and alignments, and checks that the output is identical
+/// to the scalar kernel.  It also checks 1-bit expansion against a bit-by-bit
+/// reference.
+///
+/// @see bmp_convert_get_kernels()
+/// @see bmp_convert_expand_mono()
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bmp.h"
+#include "bmp_convert.h"
+
+enum
+{
+    MAX_PIXELS = 67,
+    MAX_OFFSET = 4,
+    BUFFER_SIZE = (MAX_PIXELS + MAX_OFFSET) * sizeof(bmp_pixel32),
+};
+
+static uint32_t const MASKS[][4] = {
+    { 0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000 },
+    { 0x00FF0000, 0x0000FF00, 0x000000FF, 0x00000000 },
+    { 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000 },
+    { 0x0000F800, 0x000007E0, 0x0000001F, 0x00000000 },
+    { 0x00007C00, 0x000003E0, 0x0000001F, 0x00008000 },
+    { 0x3FF00000, 0x000FFC00, 0x000003FF, 0xC0000000 },
+    { 0x00000001, 0x00000002, 0x00000004, 0x00000008 },
+    { 0xFFFF0000, 0x0000F000, 0x00000E00, 0x00000000 },
+    { 0x00000000, 0x00000000, 0x00000000, 0x00000000 },
+};
+
+static uint32_t state = 0x12345678;
+
+static uint32_t next(void)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static void fill(unsigned char *buf, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        buf[i] = (unsigned char)next();
+    }
+}
+
+static int compare(char const *name, cpu_isa isa, size_t n, size_t offset, void const *expected, void const *actual, size_t size)
+{
+    if (memcmp(expected, actual, size) != 0)
+    {
+        (void)fprintf(stderr, "%s: isa %d differs from scalar (n = %zu, offset = %zu)\n", name, isa, n, offset);
+        return -1;
+    }
+    return 0;
+}
+
+static int check(cpu_isa isa, bmp_convert_kernels const *scalar, bmp_convert_kernels const *kernels)
+{
+    static unsigned char src[BUFFER_SIZE];
+    static unsigned char expected[BUFFER_SIZE];
+    static unsigned char actual[BUFFER_SIZE];
+
+    for (size_t n = 0; n <= MAX_PIXELS; ++n)
+    {
+        for (size_t offset = 0; offset < MAX_OFFSET; ++offset)
+        {
+            size_t const size = n * sizeof(bmp_pixel32);
+            void *const s = &src[offset];
+            bmp_pixel32 *const e = (bmp_pixel32 *)&expected[offset];
+            bmp_pixel32 *const a = (bmp_pixel32 *)&actual[offset];
+
+            fill(src, sizeof(src));
+            scalar->bgr24_to_bgra32(e, s, n);
+            kernels->bgr24_to_bgra32(a, s, n);
+            if (compare("bgr24_to_bgra32", isa, n, offset, e, a, size) != 0)
+            {
+                return -1;
+            }
+
+            scalar->swap_red_blue(e, s, n);
+            kernels->swap_red_blue(a, s, n);
+            if (compare("swap_red_blue", isa, n, offset, e, a, size) != 0)
+            {
+                return -1;
+            }
+
+            for (size_t m = 0; m < sizeof(MASKS) / sizeof(MASKS[0]); ++m)
+            {
+                scalar->extract_masked(e, s, n, MASKS[m]);
+                kernels->extract_masked(a, s, n, MASKS[m]);
+                if (compare("extract_masked", isa, n, offset, e, a, size) != 0)
+                {
+                    return -1;
+                }
+            }
+
+            scalar->premultiply_alpha(e, s, n);
+            kernels->premultiply_alpha(a, s, n);
+            if (compare("premultiply_alpha", isa, n, offset, e, a, size) != 0)
+            {
+                return -1;
+            }
+
+            memcpy(e, s, size);
+            memcpy(a, s, size);
+            scalar->premultiply_alpha(e, e, n);
+            kernels->premultiply_alpha(a, a, n);
+            if (compare("premultiply_alpha in place", isa, n, offset, e, a, size) != 0)
+            {
+                return -1;
+            }
+
+            // Swap the first n pixels with the last n pixels of the buffer.
+            if (offset + size <= sizeof(src) - size)
+            {
+                memcpy(expected, src, sizeof(src));
+                memcpy(actual, src, sizeof(src));
+                scalar->swap_rows(e, &expected[sizeof(src) - size], size);
+                kernels->swap_rows(a, &actual[sizeof(src) - size], size);
+                if (compare("swap_rows", isa, n, offset, expected, actual, sizeof(src)) != 0)
+                {
+                    return -1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/// Checks the scalar kernels against known values.
+static int check_scalar(bmp_convert_kernels const *scalar)
+{
+    bmp_pixel32 const pixel = { .b = 0x10, .g = 0x80, .r = 0xFF, .a = 0x80 };
+    bmp_pixel32 out = { 0 };
+
+    scalar->premultiply_alpha(&out, &pixel, 1);
+    if (out.b != 0x08 || out.g != 0x40 || out.r != 0x80 || out.a != 0x80)
+    {
+        return -1;
+    }
+
+    uint32_t const rgb565 = 0xF81F;
+    scalar->extract_masked(&out, &rgb565, 1, MASKS[3]);
+    if (out.b != 0xFF || out.g != 0x00 || out.r != 0xFF || out.a != 0xFF)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/// Checks 1-bit expansion of every length up to MAX_PIXELS against a bit-by-bit reference.
+static int check_mono(void)
+{
+    static bmp_convert_mono_table table;
+    bmp_pixel32 const zero = { 0xFF, 0xFF, 0xFF, 0x00 };
+    bmp_pixel32 const one = { 0x00, 0x00, 0x00, 0xFF };
+    bmp_convert_mono_table_init(&table, zero, one);
+
+    uint8_t src[(MAX_PIXELS + 7) / 8];
+    bmp_pixel32 expected[MAX_PIXELS + 1];
+    bmp_pixel32 actual[MAX_PIXELS + 1];
+    for (size_t n = 0; n <= MAX_PIXELS; ++n)
+    {
+        fill(src, sizeof(src));
+        for (size_t x = 0; x < n; ++x)
+        {
+            expected[x] = ((src[x / 8] >> (7 - (x % 8))) & 1) ? one : zero;
+        }
+        // The pixel after the last one must be left alone.
+        memset(actual, 0x5A, sizeof(actual));
+        expected[n] = actual[n];
+        bmp_convert_expand_mono(actual, src, n, &table);
+        if (memcmp(expected, actual, (n + 1) * sizeof(*actual)) != 0)
+        {
+            (void)fprintf(stderr, "expand_mono: differs from reference (n = %zu)\n", n);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    bmp_convert_kernels const *scalar = bmp_convert_get_kernels(CPU_ISA_SCALAR);
+    if (scalar == NULL || check_scalar(scalar) != 0 || check_mono() != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    for (int isa = CPU_ISA_SCALAR + 1; isa < CPU_ISA_MAX; ++isa)
+    {
+        bmp_convert_kernels const *kernels = bmp_convert_get_kernels((cpu_isa)isa);
+        if (kernels == NULL)
+        {
+            (void)printf("bmp_convert: isa %d not supported, skipping\n", isa);
+            continue;
+        }
+        if (check((cpu_isa)isa, scalar, kernels) != 0)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (bmp_convert_best_kernels() == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
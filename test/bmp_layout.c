@@ -0,0 +1,167 @@
+/// Test for bmp_get_layout() and bmp_row_size() functions.
+///
+/// This test checks row sizes for every supported depth, then builds headers
+/// in memory and checks that valid ones produce the expected layout and that
+/// corrupt or hostile ones are rejected.
+///
+/// @see bmp_get_layout()
+/// @see bmp_row_size()
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bmp.h"
+
+enum
+{
+    DATA_OFFSET = sizeof(bmp_file_header) + sizeof(bmp_info_header),
+    FILE_SIZE = DATA_OFFSET + 64,
+};
+
+static unsigned char file[FILE_SIZE];
+
+static void init(int32_t width, int32_t height, uint16_t bpp, uint32_t offset)
+{
+    bmp_file_header const file_header = {
+        .file_type = 0x4D42,
+        .file_size = FILE_SIZE,
+        .offset = offset,
+    };
+    bmp_info_header const info_header = {
+        .size = BITMAPINFOHEADER,
+        .width = width,
+        .height = height,
+        .planes = 1,
+        .bits_per_pixel = bpp,
+        .compression = BI_RGB,
+        .colors = (bpp <= 8) ? 1 : 0,
+    };
+    memset(file, 0, sizeof(file));
+    memcpy(file, &file_header, sizeof(file_header));
+    memcpy(&file[sizeof(file_header)], &info_header, sizeof(info_header));
+}
+
+static int check_row_size(void)
+{
+    static struct
+    {
+        uint16_t bpp;
+        size_t width;
+        size_t expected;
+    } const cases[] = {
+        { 1, 1, 4 },
+        { 1, 32, 4 },
+        { 1, 33, 8 },
+        { 4, 9, 8 },
+        { 8, 5, 8 },
+        { 16, 3, 8 },
+        { 24, 3, 12 },
+        { 24, 5, 16 },
+        { 32, 7, 28 },
+        { 2, 17, 8 },
+        { 0, 1, 0 },
+        { 32, SIZE_MAX, 0 },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+    {
+        if (bmp_row_size(cases[i].bpp, cases[i].width) != cases[i].expected)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int check_valid(void)
+{
+    bmp_layout layout;
+
+    // 8-bit, 5x3 bottom-up: one color table entry, rows of 8 bytes
+    init(5, 3, 8, DATA_OFFSET + 4);
+    if (bmp_get_layout(file, sizeof(file), &layout) != 0)
+    {
+        return -1;
+    }
+    if (layout.row_size != 8 || layout.offset != DATA_OFFSET + 4 || layout.top_down
+        || layout.pixels_size != 24 || layout.decoded_size != 5 * 3 * sizeof(bmp_pixel32)
+        || layout.palette_size != 1)
+    {
+        return -1;
+    }
+
+    // 24-bit, 3x-4 top-down
+    init(3, -4, 24, DATA_OFFSET);
+    if (bmp_get_layout(file, sizeof(file), &layout) != 0)
+    {
+        return -1;
+    }
+    if (layout.row_size != 12 || !layout.top_down || layout.height != 4 || layout.pixels_size != 48)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+static int check_invalid(void)
+{
+    bmp_layout layout;
+
+    // Pixel data larger than the file
+    init(INT32_MAX, INT32_MAX, 32, DATA_OFFSET);
+    if (bmp_get_layout(file, sizeof(file), &layout) == 0)
+    {
+        return -1;
+    }
+    init(4, -INT32_MAX, 32, DATA_OFFSET);
+    if (bmp_get_layout(file, sizeof(file), &layout) == 0)
+    {
+        return -1;
+    }
+    init(4, INT32_MIN, 32, DATA_OFFSET);
+    if (bmp_get_layout(file, sizeof(file), &layout) == 0)
+    {
+        return -1;
+    }
+
+    // Offset inside the headers, and past the end of the file
+    init(1, 1, 32, DATA_OFFSET - 1);
+    if (bmp_get_layout(file, sizeof(file), &layout) == 0)
+    {
+        return -1;
+    }
+    init(1, 1, 32, UINT32_MAX);
+    if (bmp_get_layout(file, sizeof(file), &layout) == 0)
+    {
+        return -1;
+    }
+
+    // Zero width and unsupported depth
+    init(0, 1, 32, DATA_OFFSET);
+    if (bmp_get_layout(file, sizeof(file), &layout) == 0)
+    {
+        return -1;
+    }
+    init(1, 1, 2, DATA_OFFSET);
+    if (bmp_get_layout(file, sizeof(file), &layout) == 0)
+    {
+        return -1;
+    }
+
+    // Truncated header
+    init(1, 1, 32, DATA_OFFSET);
+    if (bmp_get_layout(file, DATA_OFFSET - 1, &layout) == 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    if (check_row_size() != 0 || check_valid() != 0 || check_invalid() != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,253 @@
+/// Test for bmp_load() function.
+///
+/// This test loads a 32-bit V4 bitmap file and checks that it is flipped to
+/// top-down order with its alpha intact.  It then writes 1-bit core, 4-bit,
+/// 8-bit and 16-bit BITFIELDS bitmaps to a scratch file and checks that each
+/// decodes to the same pixels.
+///
+/// @see bmp_load()
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bmp.h"
+
+enum
+{
+    WIDTH = 3,
+    HEIGHT = 2,
+    BUFFER_SIZE = 256,
+};
+
+/// The expected pixels of the synthesized bitmaps, top row first.
+static bmp_pixel32 const expected[HEIGHT][WIDTH] = {
+    { { 0, 0, 255, 255 }, { 0, 255, 0, 255 }, { 255, 0, 0, 255 } },
+    { { 255, 255, 255, 255 }, { 0, 0, 0, 255 }, { 255, 255, 255, 255 } },
+};
+
+typedef struct buffer
+{
+    unsigned char data[BUFFER_SIZE];
+    size_t size;
+} buffer;
+
+static void put(buffer *buf, uint32_t value, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        buf->data[buf->size++] = (unsigned char)(value >> (i * 8));
+    }
+}
+
+/// Writes the file header and the leading DIB header fields.
+static void put_headers(buffer *buf, uint32_t header_size, uint16_t bpp, uint32_t compression, uint32_t colors)
+{
+    put(buf, 0x4D42, 2);
+    put(buf, 0, 4); // Patched by write_file()
+    put(buf, 0, 4);
+    put(buf, 0, 4); // Patched by the caller
+    put(buf, header_size, 4);
+    if (header_size == BITMAPCOREHEADER)
+    {
+        put(buf, WIDTH, 2);
+        put(buf, HEIGHT, 2);
+        put(buf, 1, 2);
+        put(buf, bpp, 2);
+        return;
+    }
+    put(buf, WIDTH, 4);
+    put(buf, HEIGHT, 4);
+    put(buf, 1, 2);
+    put(buf, bpp, 2);
+    put(buf, compression, 4);
+    put(buf, 0, 4);
+    put(buf, 2835, 4);
+    put(buf, 2835, 4);
+    put(buf, colors, 4);
+    put(buf, 0, 4);
+}
+
+static void put_offset(buffer *buf)
+{
+    uint32_t const offset = (uint32_t)buf->size;
+    memcpy(&buf->data[10], &offset, sizeof(offset));
+}
+
+static int write_file(char const *file, buffer *buf)
+{
+    uint32_t const size = (uint32_t)buf->size;
+    memcpy(&buf->data[2], &size, sizeof(size));
+    FILE *file_handle = fopen(file, "wb");
+    if (file_handle == NULL)
+    {
+        return -1;
+    }
+    size_t const writes = fwrite(buf->data, buf->size, 1, file_handle);
+    int const ret = fclose(file_handle);
+    return (writes == 1 && ret == 0) ? 0 : -1;
+}
+
+static int check(char const *file, buffer *buf, bmp_pixel32 const pixels_expected[HEIGHT][WIDTH])
+{
+    if (write_file(file, buf) != 0)
+    {
+        return -1;
+    }
+    bmp_pixel32 *pixels = NULL;
+    size_t width = 0;
+    size_t height = 0;
+    if (bmp_load(file, &pixels, &width, &height) != 0)
+    {
+        return -1;
+    }
+    int ret = 0;
+    if (width != WIDTH || height != HEIGHT || memcmp(pixels, pixels_expected, sizeof(expected)) != 0)
+    {
+        ret = -1;
+    }
+    free(pixels);
+    return ret;
+}
+
+/// Writes an indexed bitmap with the given color table and bottom-up indices.
+static void put_indexed(buffer *buf, int core, uint16_t bpp, bmp_pixel32 const *palette, uint32_t colors, unsigned const indices[HEIGHT][WIDTH])
+{
+    put_headers(buf, core ? BITMAPCOREHEADER : BITMAPINFOHEADER, bpp, BI_RGB, core ? 0 : colors);
+    for (uint32_t i = 0; i < colors; ++i)
+    {
+        put(buf, palette[i].b | (uint32_t)(palette[i].g << 8) | (uint32_t)(palette[i].r << 16), core ? 3 : 4);
+    }
+    put_offset(buf);
+    for (size_t y = 0; y < HEIGHT; ++y)
+    {
+        uint32_t row = 0;
+        for (size_t x = 0; x < WIDTH; ++x)
+        {
+            row |= (uint32_t)indices[y][x] << (32 - ((x + 1) * bpp));
+        }
+        put(buf, __builtin_bswap32(row), 4);
+    }
+}
+
+static int check_indexed(char const *file)
+{
+    static bmp_pixel32 const palette[] = {
+        { 0, 0, 255, 0 }, { 0, 255, 0, 0 }, { 255, 0, 0, 0 }, { 255, 255, 255, 0 }, { 0, 0, 0, 0 },
+    };
+    static unsigned const indices[HEIGHT][WIDTH] = { { 3, 4, 3 }, { 0, 1, 2 } };
+    static unsigned const mono_indices[HEIGHT][WIDTH] = { { 0, 1, 0 }, { 1, 0, 1 } };
+    static bmp_pixel32 const mono_expected[HEIGHT][WIDTH] = {
+        { { 0, 0, 0, 255 }, { 255, 255, 255, 255 }, { 0, 0, 0, 255 } },
+        { { 255, 255, 255, 255 }, { 0, 0, 0, 255 }, { 255, 255, 255, 255 } },
+    };
+
+    buffer buf = { 0 };
+    put_indexed(&buf, 1, 1, &palette[3], 2, mono_indices);
+    if (check(file, &buf, mono_expected) != 0)
+    {
+        return -1;
+    }
+    buf.size = 0;
+    put_indexed(&buf, 0, 4, palette, 5, indices);
+    if (check(file, &buf, expected) != 0)
+    {
+        return -1;
+    }
+    buf.size = 0;
+    put_indexed(&buf, 0, 8, palette, 5, indices);
+    return check(file, &buf, expected);
+}
+
+static int check_bitfields(char const *file)
+{
+    static uint16_t const rows[HEIGHT][WIDTH] = { { 0xFFFF, 0x0000, 0xFFFF }, { 0xF800, 0x07E0, 0x001F } };
+    buffer buf = { 0 };
+    put_headers(&buf, BITMAPINFOHEADER, 16, BI_BITFIELDS, 0);
+    put(&buf, 0xF800, 4);
+    put(&buf, 0x07E0, 4);
+    put(&buf, 0x001F, 4);
+    put_offset(&buf);
+    for (size_t y = 0; y < HEIGHT; ++y)
+    {
+        for (size_t x = 0; x < WIDTH; ++x)
+        {
+            put(&buf, rows[y][x], 2);
+        }
+        put(&buf, 0, 2);
+    }
+    return check(file, &buf, expected);
+}
+
+/// A mask with a gap in it would index past the scaling table, so it must be rejected.
+static int check_gapped_mask(char const *file)
+{
+    buffer buf = { 0 };
+    put_headers(&buf, BITMAPINFOHEADER, 16, BI_BITFIELDS, 0);
+    put(&buf, 0xF00F, 4);
+    put(&buf, 0x07E0, 4);
+    put(&buf, 0x0010, 4);
+    put_offset(&buf);
+    for (size_t i = 0; i < HEIGHT * (WIDTH + 1); ++i)
+    {
+        put(&buf, 0xFFFF, 2);
+    }
+    if (write_file(file, &buf) != 0)
+    {
+        return -1;
+    }
+    bmp_pixel32 *pixels = NULL;
+    size_t width = 0;
+    size_t height = 0;
+    if (bmp_load(file, &pixels, &width, &height) == 0)
+    {
+        free(pixels);
+        return -1;
+    }
+    return 0;
+}
+
+static int check_v4(char const *file)
+{
+    bmp_pixel32 *pixels = NULL;
+    size_t width = 0;
+    size_t height = 0;
+    if (bmp_load(file, &pixels, &width, &height) != 0)
+    {
+        return -1;
+    }
+    bmp_pixel32 const bottom_left = { .b = 255, .g = 0, .r = 0, .a = 127 };
+    int ret = 0;
+    if (width != 4 || height != 2 || memcmp(&pixels[width], &bottom_left, sizeof(bottom_left)) != 0)
+    {
+        ret = -1;
+    }
+    free(pixels);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3)
+    {
+        return EXIT_FAILURE;
+    }
+
+    char const *bmp_file = argv[1];
+    char const *scratch_file = argv[2];
+
+    if (check_v4(bmp_file) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    int ret = EXIT_SUCCESS;
+    if (check_indexed(scratch_file) != 0 || check_bitfields(scratch_file) != 0 || check_gapped_mask(scratch_file) != 0)
+    {
+        ret = EXIT_FAILURE;
+    }
+
+    remove(scratch_file);
+    return ret;
+}
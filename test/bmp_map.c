@@ -0,0 +1,49 @@
+/// Test for bmp_map() function.
+///
+/// This test maps a 32-bit bitmap file and checks that the first pixel is
+/// semi-transparent red, without copying the pixel data.
+///
+/// @see bmp_map()
+/// @see bmp_unmap()
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bmp.h"
+
+int main(int argc, char *argv[])
+{
+    bmp_mapping mapping = { 0 };
+
+    if (argc != 2)
+    {
+        return EXIT_FAILURE;
+    }
+
+    char const *bmp_file = argv[1];
+
+    if (bmp_map(bmp_file, &mapping) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    bmp_pixel32 expected = {
+        .b = 255,
+        .g = 0,
+        .r = 0,
+        .a = 127,
+    };
+
+    int ret = EXIT_SUCCESS;
+    if (mapping.v4_header == NULL || mapping.pixels_size != 4 * 2 * sizeof(bmp_pixel32))
+    {
+        ret = EXIT_FAILURE;
+    }
+    else if (memcmp(&expected, mapping.pixels, sizeof(bmp_pixel32)) != 0)
+    {
+        ret = EXIT_FAILURE;
+    }
+
+    bmp_unmap(&mapping);
+    return ret;
+}
@@ -0,0 +1,214 @@
+/// Test for RLE compression in bmp_load() and bmp_rle8_write() functions.
+///
+/// This test decodes hand-written RLE4 and RLE8 files that use runs, absolute
+/// runs, deltas and end-of-line codes.  It then writes an image with flat
+/// areas, short runs and noise with bmp_rle8_write() and checks that
+/// bmp_load() reads back the same pixels.
+///
+/// @see bmp_load()
+/// @see bmp_rle8_write()
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bmp.h"
+
+enum
+{
+    BUFFER_SIZE = 256,
+    WIDTH = 300,
+    HEIGHT = 20,
+};
+
+static bmp_pixel32 const PALETTE[] = {
+    { 0x00, 0x00, 0x00, 0xFF },
+    { 0x00, 0x00, 0xFF, 0xFF },
+    { 0x00, 0xFF, 0x00, 0xFF },
+    { 0xFF, 0x00, 0x00, 0xFF },
+    { 0x80, 0x80, 0x80, 0xFF },
+    { 0xFF, 0xFF, 0xFF, 0xFF },
+};
+
+enum
+{
+    COLORS = sizeof(PALETTE) / sizeof(PALETTE[0]),
+};
+
+/// Writes a BITMAPINFOHEADER file with the test palette and the given pixel data.
+static int write_file(char const *file, int32_t width, int32_t height, uint16_t bpp, uint32_t compression, uint8_t const *data, uint32_t size)
+{
+    uint32_t const offset = sizeof(bmp_file_header) + sizeof(bmp_info_header) + sizeof(PALETTE);
+    bmp_file_header const file_header = {
+        .file_type = 0x4D42,
+        .file_size = offset + size,
+        .offset = offset,
+    };
+    bmp_info_header const info_header = {
+        .size = BITMAPINFOHEADER,
+        .width = width,
+        .height = height,
+        .planes = 1,
+        .bits_per_pixel = bpp,
+        .compression = compression,
+        .image_size = size,
+        .colors = COLORS,
+    };
+    FILE *file_handle = fopen(file, "wb");
+    if (file_handle == NULL)
+    {
+        return -1;
+    }
+    int ret = -1;
+    if (fwrite(&file_header, sizeof(file_header), 1, file_handle) == 1
+        && fwrite(&info_header, sizeof(info_header), 1, file_handle) == 1
+        && fwrite(PALETTE, sizeof(PALETTE), 1, file_handle) == 1
+        && fwrite(data, size, 1, file_handle) == 1)
+    {
+        ret = 0;
+    }
+    if (fclose(file_handle) != 0)
+    {
+        ret = -1;
+    }
+    return ret;
+}
+
+/// Loads a file and compares it with the palette indices of the expected image, top row first.
+static int check_indices(char const *file, size_t width, size_t height, uint8_t const *expected)
+{
+    bmp_pixel32 *pixels = NULL;
+    size_t w = 0;
+    size_t h = 0;
+    if (bmp_load(file, &pixels, &w, &h) != 0)
+    {
+        return -1;
+    }
+    int ret = (w == width && h == height) ? 0 : -1;
+    for (size_t i = 0; ret == 0 && i < width * height; ++i)
+    {
+        if (memcmp(&pixels[i], &PALETTE[expected[i]], sizeof(bmp_pixel32)) != 0)
+        {
+            ret = -1;
+        }
+    }
+    free(pixels);
+    return ret;
+}
+
+static int check_rle4(char const *file)
+{
+    static uint8_t const data[] = {
+        0x05, 0x12, 0x00, 0x03, 0x31, 0x20, 0x00, 0x00, // Run, clipped absolute run, end of line
+        0x00, 0x02, 0x03, 0x00, 0x04, 0x33, 0x00, 0x00, // Delta, run, end of line
+        0x07, 0x11, 0x00, 0x01,                         // Run, end of bitmap
+    };
+    static uint8_t const expected[] = {
+        1, 1, 1, 1, 1, 1, 1,
+        0, 0, 0, 3, 3, 3, 3,
+        1, 2, 1, 2, 1, 3, 1,
+    };
+    if (write_file(file, 7, 3, 4, BI_RLE4, data, sizeof(data)) != 0)
+    {
+        return -1;
+    }
+    return check_indices(file, 7, 3, expected);
+}
+
+static int check_rle8(char const *file)
+{
+    static uint8_t const data[] = {
+        0x00, 0x02, 0x02, 0x01,                         // Delta into the second row
+        0x02, 0x05, 0x00, 0x00,                         // Run, end of line
+        0x00, 0x03, 0x04, 0x03, 0x02, 0x00, 0x00, 0x01, // Padded absolute run, end of bitmap
+    };
+    static uint8_t const expected[] = {
+        4, 3, 2, 0,
+        0, 0, 5, 5,
+        0, 0, 0, 0,
+    };
+    if (write_file(file, 4, 3, 8, BI_RLE8, data, sizeof(data)) != 0)
+    {
+        return -1;
+    }
+    return check_indices(file, 4, 3, expected);
+}
+
+static int check_write(char const *file)
+{
+    static uint8_t image[HEIGHT][WIDTH];
+    static bmp_pixel32 buffer[HEIGHT][WIDTH];
+    static uint8_t expected[HEIGHT][WIDTH];
+
+    uint32_t state = 1;
+    for (size_t y = 0; y < HEIGHT; ++y)
+    {
+        for (size_t x = 0; x < WIDTH; ++x)
+        {
+            state = (state * 1103515245) + 12345;
+            if (y < 4)
+                image[y][x] = 5; // Flat, longer than one run
+            else if (y < 8)
+                image[y][x] = (uint8_t)((x / 2) % COLORS); // Runs of two
+            else if (y < 12)
+                image[y][x] = (uint8_t)((x / 3) % COLORS); // Runs of three
+            else
+                image[y][x] = (uint8_t)((state >> 16) % COLORS); // Noise
+            buffer[y][x] = PALETTE[image[y][x]];
+            buffer[y][x].a = (uint8_t)x; // Dropped by the encoder
+        }
+    }
+    // bmp_rle8_write() takes bottom-up rows, the loader returns top-down ones.
+    for (size_t y = 0; y < HEIGHT; ++y)
+    {
+        memcpy(expected[y], image[HEIGHT - 1 - y], WIDTH);
+    }
+
+    if (bmp_rle8_write(&buffer[0][0], WIDTH, HEIGHT, file) != 0)
+    {
+        return -1;
+    }
+    bmp_pixel32 *pixels = NULL;
+    size_t width = 0;
+    size_t height = 0;
+    if (bmp_load(file, &pixels, &width, &height) != 0)
+    {
+        return -1;
+    }
+    int ret = (width == WIDTH && height == HEIGHT) ? 0 : -1;
+    for (size_t y = 0; ret == 0 && y < HEIGHT; ++y)
+    {
+        for (size_t x = 0; x < WIDTH; ++x)
+        {
+            bmp_pixel32 const want = PALETTE[expected[y][x]];
+            bmp_pixel32 const got = pixels[(y * WIDTH) + x];
+            if (got.b != want.b || got.g != want.g || got.r != want.r || got.a != 0xFF)
+            {
+                ret = -1;
+                break;
+            }
+        }
+    }
+    free(pixels);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2)
+    {
+        return EXIT_FAILURE;
+    }
+
+    char const *scratch_file = argv[1];
+
+    int ret = EXIT_SUCCESS;
+    if (check_rle4(scratch_file) != 0 || check_rle8(scratch_file) != 0 || check_write(scratch_file) != 0)
+    {
+        ret = EXIT_FAILURE;
+    }
+
+    remove(scratch_file);
+    return ret;
+}
@@ -0,0 +1,117 @@
+/// Test for the bmp_writer functions.
+///
+/// This test streams 24-bit and 32-bit images with an odd width to a scratch
+/// file in chunks of varying size, and checks that bmp_load() reads back the
+/// same pixels.  It also checks that writing too many or too few rows fails.
+///
+/// @see bmp_writer_open()
+/// @see bmp_writer_write_rows()
+/// @see bmp_writer_close()
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bmp.h"
+
+enum
+{
+    WIDTH = 37,
+    HEIGHT = 29,
+};
+
+static bmp_pixel32 image[HEIGHT][WIDTH];
+
+static void fill(uint16_t bits_per_pixel)
+{
+    for (size_t y = 0; y < HEIGHT; ++y)
+    {
+        for (size_t x = 0; x < WIDTH; ++x)
+        {
+            uint8_t const a = (bits_per_pixel == 32) ? (uint8_t)(x * y) : 0xFF;
+            image[y][x] = (bmp_pixel32){ (uint8_t)x, (uint8_t)y, (uint8_t)(x + y), a };
+        }
+    }
+}
+
+static int check(char const *file, uint16_t bits_per_pixel)
+{
+    fill(bits_per_pixel);
+
+    bmp_writer *writer = bmp_writer_open(file, WIDTH, HEIGHT, bits_per_pixel);
+    if (writer == NULL)
+    {
+        return -1;
+    }
+    for (size_t y = 0, n = 1; y < HEIGHT; y += n, ++n)
+    {
+        if (n > HEIGHT - y)
+        {
+            n = HEIGHT - y;
+        }
+        if (bmp_writer_write_rows(writer, image[y], n) != 0)
+        {
+            (void)bmp_writer_close(writer);
+            return -1;
+        }
+    }
+    if (bmp_writer_write_rows(writer, image[0], 1) == 0)
+    {
+        (void)bmp_writer_close(writer);
+        return -1;
+    }
+    if (bmp_writer_close(writer) != 0)
+    {
+        return -1;
+    }
+
+    bmp_pixel32 *pixels = NULL;
+    size_t width = 0;
+    size_t height = 0;
+    if (bmp_load(file, &pixels, &width, &height) != 0)
+    {
+        return -1;
+    }
+    int ret = 0;
+    if (width != WIDTH || height != HEIGHT || memcmp(pixels, image, sizeof(image)) != 0)
+    {
+        ret = -1;
+    }
+    free(pixels);
+    return ret;
+}
+
+static int check_short(char const *file)
+{
+    bmp_writer *writer = bmp_writer_open(file, WIDTH, HEIGHT, 32);
+    if (writer == NULL)
+    {
+        return -1;
+    }
+    if (bmp_writer_write_rows(writer, image[0], HEIGHT - 1) != 0)
+    {
+        (void)bmp_writer_close(writer);
+        return -1;
+    }
+    return (bmp_writer_close(writer) != 0) ? 0 : -1;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2)
+    {
+        return EXIT_FAILURE;
+    }
+
+    char const *scratch_file = argv[1];
+
+    int ret = EXIT_SUCCESS;
+    if (check(scratch_file, 24) != 0 || check(scratch_file, 32) != 0 || check_short(scratch_file) != 0)
+    {
+        ret = EXIT_FAILURE;
+    }
+
+    remove(scratch_file);
+    return ret;
+}
@@ -0,0 +1,247 @@
+/// Test for message_queue_put() and message_queue_get() functions.
+///
+/// This test runs several producer and consumer threads against one queue,
+/// closes it once the producers are done, and checks that the consumers drain
+/// every message exactly once.  It also checks the non-blocking and timed gets,
+/// and that every put that succeeds while the queue is being closed is drained.
+///
+/// @see message_queue_put()
+/// @see message_queue_get()
+/// @see message_queue_try_get()
+/// @see message_queue_get_timeout()
+/// @see message_queue_close()
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <SDL.h>
+
+#include "message_queue.h"
+
+enum
+{
+    CAPACITY = 16,
+    PRODUCERS = 4,
+    CONSUMERS = 4,
+    COUNT = 10000, // Messages per producer
+    TIMEOUT = 20,  // Milliseconds
+    ROUNDS = 32,   // Closes racing with puts
+};
+
+struct producer
+{
+    struct message_queue *queue;
+    intptr_t id;
+};
+
+struct consumer
+{
+    struct message_queue *queue;
+    int64_t sum;
+    int count;
+};
+
+static int produce(void *data)
+{
+    struct producer *p = data;
+    for (intptr_t i = 0; i < COUNT;)
+    {
+        struct message msg = { .tag = MSG_TAG_SOME, .value = (p->id * COUNT) + i };
+        int const rc = message_queue_put(p->queue, &msg);
+        if (rc < 0)
+        {
+            return -1;
+        }
+        if (rc == 0)
+        {
+            ++i;
+        }
+    }
+    return 0;
+}
+
+static int consume(void *data)
+{
+    struct consumer *c = data;
+    struct message msg = { 0 };
+    for (;;)
+    {
+        int const rc = message_queue_get(c->queue, &msg);
+        if (rc == -MSGQ_FAILURE_CLOSED)
+        {
+            return 0;
+        }
+        if (rc != 0)
+        {
+            return -1;
+        }
+        c->sum += msg.value;
+        c->count += 1;
+    }
+}
+
+/// Puts until the queue is closed, counting the successful puts.
+static int race_close(void *data)
+{
+    struct consumer *c = data;
+    struct message msg = { .tag = MSG_TAG_SOME, .value = 1 };
+    for (;;)
+    {
+        int const rc = message_queue_put(c->queue, &msg);
+        if (rc == -MSGQ_FAILURE_CLOSED)
+        {
+            return 0;
+        }
+        if (rc < 0)
+        {
+            return -1;
+        }
+        c->count += (rc == 0);
+    }
+}
+
+static int check_close_race(void)
+{
+    for (int round = 0; round < ROUNDS; ++round)
+    {
+        struct message_queue *queue = message_queue_create(CAPACITY);
+        if (queue == NULL)
+        {
+            return -1;
+        }
+        struct consumer racers[PRODUCERS] = { 0 };
+        SDL_Thread *threads[PRODUCERS] = { 0 };
+        for (int i = 0; i < PRODUCERS; ++i)
+        {
+            racers[i].queue = queue;
+            threads[i] = SDL_CreateThread(race_close, "racer", &racers[i]);
+            if (threads[i] == NULL)
+            {
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        // Close after a varying number of messages, while the producers are still putting
+        int received = 0;
+        struct message msg = { 0 };
+        while (received < round)
+        {
+            int const rc = message_queue_try_get(queue, &msg);
+            if (rc < 0)
+            {
+                exit(EXIT_FAILURE);
+            }
+            received += (rc == 0);
+        }
+        message_queue_close(queue);
+        int rc = 0;
+        while ((rc = message_queue_get(queue, &msg)) == 0)
+        {
+            ++received;
+        }
+
+        int ok = (rc == -MSGQ_FAILURE_CLOSED);
+        int put = 0;
+        for (int i = 0; i < PRODUCERS; ++i)
+        {
+            int status = 0;
+            SDL_WaitThread(threads[i], &status);
+            ok = ok && (status == 0);
+            put += racers[i].count;
+        }
+        ok = ok && (message_queue_try_get(queue, &msg) == -MSGQ_FAILURE_CLOSED);
+        message_queue_destroy(queue);
+        if (!ok || received != put)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int check_empty(struct message_queue *queue)
+{
+    struct message msg = { 0 };
+    if (message_queue_try_get(queue, &msg) != 1)
+    {
+        return -1;
+    }
+    uint32_t const start = SDL_GetTicks();
+    if (message_queue_get_timeout(queue, &msg, TIMEOUT) != 1)
+    {
+        return -1;
+    }
+    return (SDL_GetTicks() - start >= TIMEOUT) ? 0 : -1;
+}
+
+int main(void)
+{
+    int ret = EXIT_FAILURE;
+
+    struct message_queue *queue = message_queue_create(CAPACITY);
+    if (queue == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (check_empty(queue) != 0 || check_close_race() != 0)
+    {
+        goto out_destroy_queue;
+    }
+
+    struct producer producers[PRODUCERS] = { 0 };
+    struct consumer consumers[CONSUMERS] = { 0 };
+    SDL_Thread *producer_threads[PRODUCERS] = { 0 };
+    SDL_Thread *consumer_threads[CONSUMERS] = { 0 };
+
+    for (int i = 0; i < CONSUMERS; ++i)
+    {
+        consumers[i].queue = queue;
+        consumer_threads[i] = SDL_CreateThread(consume, "consumer", &consumers[i]);
+        if (consumer_threads[i] == NULL)
+        {
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int i = 0; i < PRODUCERS; ++i)
+    {
+        producers[i].queue = queue;
+        producers[i].id = i;
+        producer_threads[i] = SDL_CreateThread(produce, "producer", &producers[i]);
+        if (producer_threads[i] == NULL)
+        {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    int ok = 1;
+    int status = 0;
+    for (int i = 0; i < PRODUCERS; ++i)
+    {
+        SDL_WaitThread(producer_threads[i], &status);
+        ok = ok && (status == 0);
+    }
+    message_queue_close(queue);
+
+    int64_t sum = 0;
+    int count = 0;
+    for (int i = 0; i < CONSUMERS; ++i)
+    {
+        SDL_WaitThread(consumer_threads[i], &status);
+        ok = ok && (status == 0);
+        sum += consumers[i].sum;
+        count += consumers[i].count;
+    }
+
+    struct message msg = { .tag = MSG_TAG_SOME, .value = 0 };
+    int64_t const total = (int64_t)PRODUCERS * COUNT;
+    if (ok && count == total && sum == (total * (total - 1)) / 2 && message_queue_size(queue) == 0
+        && message_queue_put(queue, &msg) == -MSGQ_FAILURE_CLOSED
+        && message_queue_try_get(queue, &msg) == -MSGQ_FAILURE_CLOSED)
+    {
+        ret = EXIT_SUCCESS;
+    }
+out_destroy_queue:
+    message_queue_destroy(queue);
+    return ret;
+}
@@ -0,0 +1,111 @@
+/// Test for message_queue_put_many() and message_queue_get_many() functions.
+///
+/// This test moves batches of messages through a queue so that the copies
+/// wrap around the end of the ring, and checks that they come out in order.
+/// It also checks that a queue created with a capacity of 0 holds one message.
+///
+/// @see message_queue_put_many()
+/// @see message_queue_get_many()
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "message_queue.h"
+
+enum
+{
+    CAPACITY = 4,
+    BATCH = 8,
+};
+
+static int check_values(struct message const *msgs, int n, intptr_t first)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        if (msgs[i].tag != MSG_TAG_SOME || msgs[i].value != first + i)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int check_zero_capacity(void)
+{
+    struct message_queue *queue = message_queue_create(0);
+    if (queue == NULL)
+    {
+        return -1;
+    }
+    struct message const in[2] = { { .tag = MSG_TAG_SOME, .value = 0 }, { .tag = MSG_TAG_SOME, .value = 1 } };
+    int const puts = message_queue_put_many(queue, in, 2);
+    message_queue_destroy(queue);
+    return (puts == 1) ? 0 : -1;
+}
+
+int main(void)
+{
+    int ret = EXIT_FAILURE;
+
+    if (check_zero_capacity() != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct message_queue *queue = message_queue_create(CAPACITY);
+    if (queue == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct message in[BATCH] = { 0 };
+    struct message out[BATCH] = { 0 };
+    for (intptr_t i = 0; i < BATCH; ++i)
+    {
+        in[i].tag = MSG_TAG_SOME;
+        in[i].value = i;
+    }
+
+    // Move the front and rear to the middle of the ring
+    if (message_queue_put_many(queue, in, 3) != 3)
+    {
+        goto out_destroy_queue;
+    }
+    if (message_queue_get_many(queue, out, 3) != 3 || check_values(out, 3, 0) != 0)
+    {
+        goto out_destroy_queue;
+    }
+
+    // Only CAPACITY messages fit, and the copy wraps around the end of the ring
+    if (message_queue_put_many(queue, in, BATCH) != CAPACITY)
+    {
+        goto out_destroy_queue;
+    }
+    if (message_queue_size(queue) != CAPACITY)
+    {
+        goto out_destroy_queue;
+    }
+    struct message msg = { .tag = MSG_TAG_SOME, .value = 0 };
+    if (message_queue_put(queue, &msg) != 1)
+    {
+        goto out_destroy_queue;
+    }
+
+    if (message_queue_get(queue, &msg) != 0 || check_values(&msg, 1, 0) != 0)
+    {
+        goto out_destroy_queue;
+    }
+    if (message_queue_get_many(queue, out, BATCH) != CAPACITY - 1 || check_values(out, CAPACITY - 1, 1) != 0)
+    {
+        goto out_destroy_queue;
+    }
+    if (message_queue_get_many(queue, out, BATCH) != 0 || message_queue_size(queue) != 0)
+    {
+        goto out_destroy_queue;
+    }
+
+    ret = EXIT_SUCCESS;
+out_destroy_queue:
+    message_queue_destroy(queue);
+    return ret;
+}
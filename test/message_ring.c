@@ -0,0 +1,130 @@
+/// Test for the message_ring functions.
+///
+/// This test streams variable-length payloads through a ring from a producer
+/// thread, so that records wrap around the end of the ring, and checks that
+/// the consumer reads each one intact and in order.
+///
+/// @see message_ring_reserve()
+/// @see message_ring_commit()
+/// @see message_ring_try_read()
+/// @see message_ring_release()
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <SDL.h>
+
+#include "message_queue.h"
+
+enum
+{
+    CAPACITY = 4096,
+    MAX_SIZE = 64,
+    COUNT = 20000,
+};
+
+/// Returns the payload size of the i-th message.
+static uint32_t size_of(uint32_t i)
+{
+    return (i * 7) % (MAX_SIZE + 1);
+}
+
+static int produce(void *data)
+{
+    struct message_ring *ring = data;
+    for (uint32_t i = 0; i < COUNT;)
+    {
+        // Reserve the maximum, then commit only what was written
+        void *payload = NULL;
+        int rc = message_ring_reserve(ring, MAX_SIZE, &payload);
+        if (rc < 0)
+            return -1;
+
+        if (rc == 1)
+        {
+            SDL_Delay(1);
+            continue;
+        }
+
+        uint32_t const size = size_of(i);
+        unsigned char *bytes = payload;
+        for (uint32_t j = 0; j < size; ++j)
+            bytes[j] = (unsigned char)(i + j);
+
+        rc = message_ring_commit(ring, MSG_TAG_SOME, size);
+        if (rc < 0)
+            return -1;
+
+        ++i;
+    }
+    return 0;
+}
+
+static int check_errors(struct message_ring *ring)
+{
+    void *payload = NULL;
+    struct message_payload out = { 0 };
+    if (message_ring_reserve(ring, (CAPACITY / 4) + 1, &payload) != -MSGQ_FAILURE_TOO_LARGE)
+        return -1;
+
+    if (message_ring_commit(ring, MSG_TAG_SOME, 0) != -MSGQ_FAILURE_NOT_PENDING)
+        return -1;
+
+    if (message_ring_try_read(ring, &out) != 1)
+        return -1;
+
+    if (message_ring_release(ring) != -MSGQ_FAILURE_NOT_PENDING)
+        return -1;
+
+    return 0;
+}
+
+int main(void)
+{
+    int ret = EXIT_FAILURE;
+
+    struct message_ring *ring = message_ring_create(CAPACITY);
+    if (ring == NULL)
+        return EXIT_FAILURE;
+
+    if (check_errors(ring) != 0)
+        goto out_destroy_ring;
+
+    SDL_Thread *producer = SDL_CreateThread(produce, "producer", ring);
+    if (producer == NULL)
+        goto out_destroy_ring;
+
+    int ok = 1;
+    struct message_payload out = { 0 };
+    for (uint32_t i = 0; i < COUNT;)
+    {
+        int const rc = message_ring_try_read(ring, &out);
+        if (rc < 0)
+            break;
+
+        if (rc == 1)
+        {
+            SDL_Delay(1);
+            continue;
+        }
+
+        unsigned char const *bytes = out.data;
+        ok = ok && out.tag == MSG_TAG_SOME && out.size == size_of(i) && ((uintptr_t)bytes % 8) == 0;
+        for (uint32_t j = 0; ok && j < out.size; ++j)
+            ok = bytes[j] == (unsigned char)(i + j);
+
+        if (message_ring_release(ring) != 0)
+            break;
+
+        ++i;
+    }
+
+    int status = -1;
+    SDL_WaitThread(producer, &status);
+    if (ok && status == 0)
+        ret = EXIT_SUCCESS;
+
+out_destroy_ring:
+    message_ring_destroy(ring);
+    return ret;
+}
@@ -0,0 +1,118 @@
+/// Test for the message_spsc_queue functions.
+///
+/// This test checks the full/empty behaviour of a single-producer/single-consumer
+/// queue, then streams messages through it from a producer thread and checks
+/// that the consumer receives them in order.
+///
+/// @see message_spsc_queue_put()
+/// @see message_spsc_queue_get()
+/// @see message_spsc_queue_try_get()
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <SDL.h>
+
+#include "message_queue.h"
+
+enum
+{
+    CAPACITY = 3,
+    COUNT = 100000,
+};
+
+static int produce(void *data)
+{
+    struct message_spsc_queue *queue = data;
+    for (intptr_t i = 0; i < COUNT;)
+    {
+        struct message msg = { .tag = MSG_TAG_SOME, .value = i };
+        int const rc = message_spsc_queue_put(queue, &msg);
+        if (rc < 0)
+        {
+            return -1;
+        }
+        if (rc == 0)
+        {
+            ++i;
+        }
+    }
+    return 0;
+}
+
+static int check_bounds(struct message_spsc_queue *queue)
+{
+    struct message msg = { .tag = MSG_TAG_SOME, .value = 0 };
+    if (message_spsc_queue_try_get(queue, &msg) != 1)
+    {
+        return -1;
+    }
+    // Capacity is rounded up to 4
+    for (intptr_t i = 0; i < 4; ++i)
+    {
+        msg.value = i;
+        if (message_spsc_queue_put(queue, &msg) != 0)
+        {
+            return -1;
+        }
+    }
+    if (message_spsc_queue_put(queue, &msg) != 1)
+    {
+        return -1;
+    }
+    if (message_spsc_queue_size(queue) != 4)
+    {
+        return -1;
+    }
+    for (intptr_t i = 0; i < 4; ++i)
+    {
+        if (message_spsc_queue_try_get(queue, &msg) != 0 || msg.value != i)
+        {
+            return -1;
+        }
+    }
+    return (message_spsc_queue_size(queue) == 0) ? 0 : -1;
+}
+
+int main(void)
+{
+    int ret = EXIT_FAILURE;
+
+    struct message_spsc_queue *queue = message_spsc_queue_create(CAPACITY);
+    if (queue == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (check_bounds(queue) != 0)
+    {
+        goto out_destroy_queue;
+    }
+
+    SDL_Thread *producer = SDL_CreateThread(produce, "producer", queue);
+    if (producer == NULL)
+    {
+        goto out_destroy_queue;
+    }
+
+    int ok = 1;
+    struct message msg = { 0 };
+    for (intptr_t i = 0; i < COUNT; ++i)
+    {
+        // Keep draining on mismatch so that the producer can finish
+        if (message_spsc_queue_get(queue, &msg) != 0 || msg.tag != MSG_TAG_SOME || msg.value != i)
+        {
+            ok = 0;
+        }
+    }
+
+    int status = -1;
+    SDL_WaitThread(producer, &status);
+    if (ok && status == 0)
+    {
+        ret = EXIT_SUCCESS;
+    }
+out_destroy_queue:
+    message_spsc_queue_destroy(queue);
+    return ret;
+}
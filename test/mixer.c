@@ -0,0 +1,271 @@
+/// Test for the mixer functions.
+///
+/// This test sends commands to mixers and mixes buffers on the same thread,
+/// and checks that tones fade in and out and keep their phase across buffers,
+/// that samples play once or loop, that voices over the limit are dropped,
+/// that a full command ring is reported and drained, and that many voices add
+/// up.
+///
+/// @see mixer_mix()
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mixer.h"
+#include "synth.h"
+
+enum
+{
+    SAMPLE_RATE = 48000,
+    FRAMES = 512,
+    CHANNELS = 2,
+    SAMPLE_FRAMES = 100,
+    MANY_VOICES = 100,
+};
+
+static double const TOLERANCE = 1e-5;
+
+static float out[FRAMES * CHANNELS];
+static float samples[SAMPLE_FRAMES * CHANNELS];
+
+static int near(double actual, double expected)
+{
+    return fabs(actual - expected) <= TOLERANCE;
+}
+
+static int check_silent(size_t begin, size_t end)
+{
+    for (size_t i = CHANNELS * begin; i < CHANNELS * end; ++i)
+    {
+        if (out[i] != 0.0f)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int check_tone(void)
+{
+    struct mixer *mixer = mixer_create(SAMPLE_RATE, 4, 16);
+    if (mixer == NULL)
+    {
+        return -1;
+    }
+
+    int ret = -1;
+    uint32_t voice = 0;
+    if (mixer_play_tone(mixer, 1000.0, 0.5f, &voice) != 0 || voice == 0)
+    {
+        goto out_destroy_mixer;
+    }
+    synth_osc osc = { 0 };
+    synth_osc_set_frequency(&osc, 1000.0, SAMPLE_RATE);
+
+    // Fades in over the first buffer, then holds.
+    for (int buffer = 0; buffer < 2; ++buffer)
+    {
+        mixer_mix(mixer, out, FRAMES);
+        for (size_t i = 0; i < FRAMES; ++i)
+        {
+            double const gain = (buffer == 0) ? 0.5 * (double)i / FRAMES : 0.5;
+            double const y = (double)synth_sine(osc.phase + ((uint32_t)i * osc.increment)) * gain;
+            if (!near(out[CHANNELS * i], y) || out[CHANNELS * i] != out[(CHANNELS * i) + 1])
+            {
+                (void)fprintf(stderr, "tone: buffer %d frame %zu is %g, expected %g\n", buffer, i, (double)out[CHANNELS * i], y);
+                goto out_destroy_mixer;
+            }
+        }
+        osc.phase += FRAMES * osc.increment;
+    }
+    if (mixer_active_voices(mixer) != 1)
+    {
+        goto out_destroy_mixer;
+    }
+
+    // Fades out over one buffer, then is gone.
+    if (mixer_stop(mixer, voice) != 0)
+    {
+        goto out_destroy_mixer;
+    }
+    mixer_mix(mixer, out, FRAMES);
+    if (!near(out[0], (double)synth_sine(osc.phase) * 0.5) || fabs(out[CHANNELS * (FRAMES - 1)]) > 0.5 / FRAMES
+        || mixer_active_voices(mixer) != 0)
+    {
+        goto out_destroy_mixer;
+    }
+    mixer_mix(mixer, out, FRAMES);
+    if (check_silent(0, FRAMES) != 0)
+    {
+        goto out_destroy_mixer;
+    }
+
+    // Commands for voices that have stopped are ignored.
+    if (mixer_set_gain(mixer, voice, 1.0f) != 0 || mixer_set_frequency(mixer, voice, 10.0) != 0)
+    {
+        goto out_destroy_mixer;
+    }
+    mixer_mix(mixer, out, FRAMES);
+    if (check_silent(0, FRAMES) != 0 || mixer_active_voices(mixer) != 0)
+    {
+        goto out_destroy_mixer;
+    }
+    ret = 0;
+out_destroy_mixer:
+    mixer_destroy(mixer);
+    return ret;
+}
+
+static int check_samples(void)
+{
+    for (size_t i = 0; i < SAMPLE_FRAMES; ++i)
+    {
+        samples[CHANNELS * i] = (float)i / SAMPLE_FRAMES;
+        samples[(CHANNELS * i) + 1] = -(float)i / SAMPLE_FRAMES;
+    }
+    struct mixer *mixer = mixer_create(SAMPLE_RATE, 4, 16);
+    if (mixer == NULL)
+    {
+        return -1;
+    }
+
+    int ret = -1;
+    uint32_t once = 0;
+    if (mixer_play_samples(mixer, samples, SAMPLE_FRAMES, 0.5f, 0, &once) != 0)
+    {
+        goto out_destroy_mixer;
+    }
+    mixer_mix(mixer, out, FRAMES);
+    for (size_t i = 0; i < CHANNELS * SAMPLE_FRAMES; ++i)
+    {
+        if (!near(out[i], (double)samples[i] * 0.5))
+        {
+            (void)fprintf(stderr, "samples: sample %zu is %g, expected %g\n", i, (double)out[i], (double)samples[i] * 0.5);
+            goto out_destroy_mixer;
+        }
+    }
+    if (check_silent(SAMPLE_FRAMES, FRAMES) != 0 || mixer_active_voices(mixer) != 0)
+    {
+        goto out_destroy_mixer;
+    }
+
+    uint32_t loop = 0;
+    if (mixer_play_samples(mixer, samples, SAMPLE_FRAMES, 1.0f, 1, &loop) != 0 || loop == once)
+    {
+        goto out_destroy_mixer;
+    }
+    for (int buffer = 0; buffer < 3; ++buffer)
+    {
+        mixer_mix(mixer, out, FRAMES);
+        for (size_t i = 0; i < FRAMES; ++i)
+        {
+            size_t const j = ((size_t)buffer * FRAMES + i) % SAMPLE_FRAMES;
+            if (out[CHANNELS * i] != samples[CHANNELS * j] || out[(CHANNELS * i) + 1] != samples[(CHANNELS * j) + 1])
+            {
+                (void)fprintf(stderr, "samples: looped buffer %d frame %zu differs\n", buffer, i);
+                goto out_destroy_mixer;
+            }
+        }
+    }
+    if (mixer_active_voices(mixer) != 1)
+    {
+        goto out_destroy_mixer;
+    }
+    ret = 0;
+out_destroy_mixer:
+    mixer_destroy(mixer);
+    return ret;
+}
+
+static int check_limits(void)
+{
+    // Two voices, and room for at least four commands.
+    struct mixer *mixer = mixer_create(SAMPLE_RATE, 2, 4);
+    if (mixer == NULL)
+    {
+        return -1;
+    }
+
+    int ret = -1;
+    uint32_t voice = 0;
+    for (int i = 0; i < 3; ++i)
+    {
+        if (mixer_play_tone(mixer, 440.0, 0.1f, &voice) != 0)
+        {
+            goto out_destroy_mixer;
+        }
+    }
+    mixer_mix(mixer, out, FRAMES);
+    if (mixer_active_voices(mixer) != 2 || mixer_dropped_voices(mixer) != 1)
+    {
+        goto out_destroy_mixer;
+    }
+
+    // Fill the ring.  A command that does not fit leaves the handle alone.
+    int sent = 0;
+    int rc = 0;
+    while ((rc = mixer_set_gain(mixer, voice, 0.2f)) == 0)
+    {
+        ++sent;
+    }
+    uint32_t const last = voice;
+    if (rc != 1 || sent < 4 || mixer_play_tone(mixer, 440.0, 0.1f, &voice) != 1 || voice != last)
+    {
+        goto out_destroy_mixer;
+    }
+    mixer_mix(mixer, out, FRAMES);
+    if (mixer_set_gain(mixer, voice, 0.2f) != 0)
+    {
+        goto out_destroy_mixer;
+    }
+    ret = 0;
+out_destroy_mixer:
+    mixer_destroy(mixer);
+    return ret;
+}
+
+static int check_many(void)
+{
+    struct mixer *mixer = mixer_create(SAMPLE_RATE, MANY_VOICES, MANY_VOICES);
+    if (mixer == NULL)
+    {
+        return -1;
+    }
+
+    int ret = -1;
+    for (size_t i = 0; i < MANY_VOICES; ++i)
+    {
+        uint32_t voice = 0;
+        if (mixer_play_samples(mixer, samples, SAMPLE_FRAMES, 0.01f, 1, &voice) != 0)
+        {
+            goto out_destroy_mixer;
+        }
+    }
+    mixer_mix(mixer, out, FRAMES);
+    for (size_t i = 0; i < CHANNELS * SAMPLE_FRAMES; ++i)
+    {
+        if (!near(out[i], (double)samples[i] * 0.01 * MANY_VOICES))
+        {
+            goto out_destroy_mixer;
+        }
+    }
+    if (mixer_active_voices(mixer) != MANY_VOICES || mixer_dropped_voices(mixer) != 0)
+    {
+        goto out_destroy_mixer;
+    }
+    ret = 0;
+out_destroy_mixer:
+    mixer_destroy(mixer);
+    return ret;
+}
+
+int main(void)
+{
+    if (check_tone() != 0 || check_samples() != 0 || check_limits() != 0 || check_many() != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
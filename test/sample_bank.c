@@ -0,0 +1,265 @@
+/// Test for the sample_bank functions.
+///
+/// This test writes WAV files, loads them whole and as streams, and checks
+/// that both give the same sound converted to 48 kHz float stereo, that a
+/// looping stream wraps around without a gap, and that files that are not WAV
+/// files are rejected.
+///
+/// @see sample_bank_load()
+/// @see sample_bank_open_stream()
+/// @see sample_stream_read()
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "sample_bank.h"
+
+#define eprintf(...) (void)fprintf(stderr, __VA_ARGS__)
+
+enum
+{
+    CHANNELS = 2,
+    SAMPLE_RATE = 48000,
+    TONE_RATE = 24000,
+    TONE_FRAMES = TONE_RATE, // One second
+    LOOP_FRAMES = 1000,
+    CHUNK = 256,
+    EDGE = 64, // Frames at each end that the resampler may smooth
+};
+
+static double const TONE_FREQUENCY = 300.0;
+static double const TONE_AMPLITUDE = 0.5;
+static double const TOLERANCE = 0.05;
+
+static void put16(FILE *file, uint16_t v)
+{
+    uint8_t const b[2] = { (uint8_t)v, (uint8_t)(v >> 8) };
+    (void)fwrite(b, sizeof(b), 1, file);
+}
+
+static void put32(FILE *file, uint32_t v)
+{
+    uint8_t const b[4] = { (uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24) };
+    (void)fwrite(b, sizeof(b), 1, file);
+}
+
+/// Writes a WAV file with a format chunk, a chunk to skip, and a data chunk.
+static int write_wav(char const *path, uint16_t tag, uint16_t channels, uint32_t rate, uint16_t bits, void const *data,
+                     uint32_t size)
+{
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        return -1;
+    }
+    uint16_t const block_align = (uint16_t)(channels * (bits / 8));
+    (void)fwrite("RIFF", 4, 1, file);
+    put32(file, 4 + (8 + 16) + (8 + 2) + (8 + size));
+    (void)fwrite("WAVE", 4, 1, file);
+    (void)fwrite("fmt ", 4, 1, file);
+    put32(file, 16);
+    put16(file, tag);
+    put16(file, channels);
+    put32(file, rate);
+    put32(file, rate * block_align);
+    put16(file, block_align);
+    put16(file, bits);
+    (void)fwrite("LIST", 4, 1, file);
+    put32(file, 2);
+    put16(file, 0);
+    (void)fwrite("data", 4, 1, file);
+    put32(file, size);
+    (void)fwrite(data, size, 1, file);
+    return (fclose(file) == 0) ? 0 : -1;
+}
+
+static double tone(size_t frame)
+{
+    return TONE_AMPLITUDE * sin(2.0 * M_PI * TONE_FREQUENCY * (double)frame / SAMPLE_RATE);
+}
+
+/// Checks converted tone frames, away from the ends of the tone.
+static int check_tone_frames(char const *name, float const *samples, size_t first, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        size_t const frame = first + i;
+        if (frame < EDGE || frame + EDGE >= 2 * TONE_FRAMES)
+        {
+            continue;
+        }
+        float const left = samples[CHANNELS * i];
+        if (fabs((double)left - tone(frame)) > TOLERANCE || samples[(CHANNELS * i) + 1] != left)
+        {
+            eprintf("%s: frame %zu is %g, expected %g\n", name, frame, (double)left, tone(frame));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int check_tone(char const *path)
+{
+    // Mono 16-bit at half the output rate.
+    int16_t *pcm = calloc(TONE_FRAMES, sizeof(*pcm));
+    if (pcm == NULL)
+    {
+        return -1;
+    }
+    for (size_t i = 0; i < TONE_FRAMES; ++i)
+    {
+        pcm[i] = (int16_t)lround(32767.0 * TONE_AMPLITUDE * sin(2.0 * M_PI * TONE_FREQUENCY * (double)i / TONE_RATE));
+    }
+    int rc = write_wav(path, 1, 1, TONE_RATE, 16, pcm, TONE_FRAMES * sizeof(*pcm));
+    free(pcm);
+    if (rc != 0)
+    {
+        return -1;
+    }
+
+    struct sample_bank *bank = sample_bank_create(SAMPLE_RATE);
+    if (bank == NULL)
+    {
+        return -1;
+    }
+
+    int ret = -1;
+    struct sample const *sample = sample_bank_load(bank, path);
+    if (sample == NULL || sample->frames < (2 * TONE_FRAMES) - EDGE || sample->frames > (2 * TONE_FRAMES) + EDGE
+        || check_tone_frames("sample_bank_load", sample->samples, 0, sample->frames) != 0)
+    {
+        goto out_destroy_bank;
+    }
+
+    // Read the stream at roughly the pace of an audio device.
+    struct sample_stream *stream = sample_bank_open_stream(bank, path, 0);
+    if (stream == NULL)
+    {
+        goto out_destroy_bank;
+    }
+    static float chunk[CHUNK * CHANNELS];
+    size_t total = 0;
+    for (size_t got = CHUNK; got == CHUNK; total += got)
+    {
+        got = sample_stream_read(stream, chunk, CHUNK);
+        if (check_tone_frames("sample_stream_read", chunk, total, got) != 0)
+        {
+            goto out_destroy_bank;
+        }
+        SDL_Delay(1);
+    }
+    if (total < (2 * TONE_FRAMES) - EDGE || total > (2 * TONE_FRAMES) + EDGE || sample_stream_underruns(stream) != 0
+        || sample_stream_read(stream, chunk, CHUNK) != 0)
+    {
+        eprintf("sample_stream_read: %zu frames, %u underruns\n", total, sample_stream_underruns(stream));
+        goto out_destroy_bank;
+    }
+    ret = 0;
+out_destroy_bank:
+    sample_bank_destroy(bank);
+    return ret;
+}
+
+static int check_loop(char const *path)
+{
+    // Already in the output format, so nothing is resampled.
+    static float pcm[LOOP_FRAMES * CHANNELS];
+    for (size_t i = 0; i < LOOP_FRAMES * CHANNELS; ++i)
+    {
+        pcm[i] = (float)i / (LOOP_FRAMES * CHANNELS);
+    }
+    if (write_wav(path, 3, CHANNELS, SAMPLE_RATE, 32, pcm, sizeof(pcm)) != 0)
+    {
+        return -1;
+    }
+
+    struct sample_bank *bank = sample_bank_create(SAMPLE_RATE);
+    if (bank == NULL)
+    {
+        return -1;
+    }
+
+    int ret = -1;
+    struct sample const *sample = sample_bank_load(bank, path);
+    if (sample == NULL || sample->frames != LOOP_FRAMES || memcmp(sample->samples, pcm, sizeof(pcm)) != 0)
+    {
+        goto out_destroy_bank;
+    }
+
+    struct sample_stream *stream = sample_bank_open_stream(bank, path, 1);
+    if (stream == NULL)
+    {
+        goto out_destroy_bank;
+    }
+    static float chunk[CHUNK * CHANNELS];
+    for (size_t total = 0; total < 20 * LOOP_FRAMES; total += CHUNK)
+    {
+        if (sample_stream_read(stream, chunk, CHUNK) != CHUNK)
+        {
+            goto out_destroy_bank;
+        }
+        for (size_t i = 0; i < CHUNK * CHANNELS; ++i)
+        {
+            if (chunk[i] != pcm[((total * CHANNELS) + i) % (LOOP_FRAMES * CHANNELS)])
+            {
+                eprintf("looping stream: sample %zu differs\n", (total * CHANNELS) + i);
+                goto out_destroy_bank;
+            }
+        }
+        SDL_Delay(1);
+    }
+    if (sample_stream_underruns(stream) != 0)
+    {
+        goto out_destroy_bank;
+    }
+    ret = 0;
+out_destroy_bank:
+    sample_bank_destroy(bank);
+    return ret;
+}
+
+static int check_invalid(char const *path)
+{
+    FILE *file = fopen(path, "wb");
+    if (file == NULL || fputs("RIFF\x04\0\0\0AVI ", file) == EOF || fclose(file) != 0)
+    {
+        return -1;
+    }
+
+    struct sample_bank *bank = sample_bank_create(SAMPLE_RATE);
+    if (bank == NULL)
+    {
+        return -1;
+    }
+    int const ret = (sample_bank_load(bank, path) == NULL && sample_bank_open_stream(bank, path, 0) == NULL
+                     && sample_bank_open_stream(bank, "does-not-exist.wav", 0) == NULL)
+                      ? 0
+                      : -1;
+    sample_bank_destroy(bank);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        eprintf("Usage: %s FILE\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    char const *scratch_file = argv[1];
+
+    int ret = EXIT_SUCCESS;
+    if (check_tone(scratch_file) != 0 || check_loop(scratch_file) != 0 || check_invalid(scratch_file) != 0)
+    {
+        ret = EXIT_FAILURE;
+    }
+
+    remove(scratch_file);
+    return ret;
+}
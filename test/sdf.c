@@ -0,0 +1,109 @@
+/// Test for the sdf_generate() function.
+///
+/// This test computes distance fields of pseudo-random masks of several sizes
+/// and densities, including empty and full ones, and checks every value
+/// against a brute-force search for the nearest pixel on the other side of
+/// the edge.
+///
+/// @see sdf_generate()
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sdf.h"
+
+enum
+{
+    MAX_WIDTH = 29,
+    MAX_HEIGHT = 23,
+};
+
+static double const SPREAD = 4.0;
+
+static uint32_t state = 0x12345678;
+
+static uint32_t next(void)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+/// Computes the expected value of one pixel by brute force.
+static uint8_t expected_value(uint8_t const *mask, size_t width, size_t height, size_t x, size_t y)
+{
+    int const inside = mask[(y * width) + x] != 0;
+    double best = HUGE_VAL;
+    for (size_t j = 0; j < height; ++j)
+    {
+        for (size_t i = 0; i < width; ++i)
+        {
+            if ((mask[(j * width) + i] != 0) == inside)
+                continue;
+            double const dx = (double)i - (double)x;
+            double const dy = (double)j - (double)y;
+            double const d = (dx * dx) + (dy * dy);
+            best = (d < best) ? d : best;
+        }
+    }
+    double const distance = inside ? sqrt(best) - 0.5 : 0.5 - sqrt(best);
+    double const value = SDF_EDGE + (distance * 127.0 / SPREAD);
+    return (value <= 0.0) ? 0 : (value >= 255.0) ? 255 : (uint8_t)lround(value);
+}
+
+static int check(size_t width, size_t height, unsigned density)
+{
+    static uint8_t mask[MAX_WIDTH * MAX_HEIGHT];
+    static uint8_t field[MAX_WIDTH * MAX_HEIGHT];
+    for (size_t i = 0; i < width * height; ++i)
+    {
+        mask[i] = (next() % 100) < density;
+    }
+    if (sdf_generate(field, mask, width, height, SPREAD) != 0)
+    {
+        return -1;
+    }
+    for (size_t y = 0; y < height; ++y)
+    {
+        for (size_t x = 0; x < width; ++x)
+        {
+            uint8_t const want = expected_value(mask, width, height, x, y);
+            if (field[(y * width) + x] != want)
+            {
+                (void)fprintf(stderr, "sdf: %zux%zu density %u differs at (%zu, %zu): %u != %u\n",
+                              width, height, density, x, y, field[(y * width) + x], want);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    static unsigned const densities[] = { 0, 3, 30, 70, 100 };
+    for (size_t d = 0; d < sizeof(densities) / sizeof(densities[0]); ++d)
+    {
+        for (size_t height = 1; height <= MAX_HEIGHT; height += 11)
+        {
+            for (size_t width = 1; width <= MAX_WIDTH; width += 7)
+            {
+                if (check(width, height, densities[d]) != 0)
+                {
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+    }
+
+    uint8_t out = 0;
+    uint8_t const in = 1;
+    if (sdf_generate(&out, &in, 1, 1, 0.0) == 0 || sdf_generate(&out, &in, 0, 1, SPREAD) == 0)
+    {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
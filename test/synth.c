@@ -0,0 +1,156 @@
+/// Test for the synth kernels.
+///
+/// This test checks the sine polynomial against libm, runs every kernel
+/// supported by the CPU over pseudo-random oscillators and lengths, and checks
+/// that the output is identical to the scalar kernel, that both channels carry
+/// the same sample, and that splitting a buffer across calls does not change
+/// it.
+///
+/// @see synth_get_kernels()
+/// @see synth_sine()
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "synth.h"
+
+enum
+{
+    MAX_FRAMES = 67,
+    MAX_OFFSET = 4,
+    BUFFER_SIZE = (2 * MAX_FRAMES) + MAX_OFFSET,
+    ROUNDS = 20,
+};
+
+static double const MAX_ERROR = 1e-6;
+
+static uint32_t state = 0x12345678;
+
+static uint32_t next(void)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static int check_accuracy(void)
+{
+    double worst = 0.0;
+    for (uint64_t phase = 0; phase < (UINT64_C(1) << 32); phase += 0x1003)
+    {
+        double const expected = sin(2.0 * M_PI * (double)phase / 4294967296.0);
+        double const error = fabs((double)synth_sine((uint32_t)phase) - expected);
+        worst = (error > worst) ? error : worst;
+    }
+    if (worst > MAX_ERROR)
+    {
+        (void)fprintf(stderr, "synth_sine: error %g exceeds %g\n", worst, MAX_ERROR);
+        return -1;
+    }
+
+    // The quarter points are exact.
+    if (synth_sine(0) != 0.0f || synth_sine(0x40000000u) != 1.0f || synth_sine(0x80000000u) != 0.0f
+        || synth_sine(0xC0000000u) != -1.0f)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+static int check_frequency(void)
+{
+    synth_osc osc = { .phase = 123 };
+    synth_osc_set_frequency(&osc, 440.0, 48000);
+    if (osc.increment != 39370534 || osc.phase != 123)
+    {
+        return -1;
+    }
+    synth_osc_set_frequency(&osc, 12000.0, 48000);
+    if (osc.increment != 0x40000000u)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+static int check(cpu_isa isa, synth_kernels const *scalar, synth_kernels const *kernels)
+{
+    static float expected[BUFFER_SIZE];
+    static float actual[BUFFER_SIZE];
+
+    for (int round = 0; round < ROUNDS; ++round)
+    {
+        synth_osc const osc = {
+            .phase = next(),
+            .increment = next() >> (next() % 32),
+            .gain = (float)(next() % 1000) / 1000.0f,
+        };
+        for (size_t n = 0; n <= MAX_FRAMES; ++n)
+        {
+            for (size_t offset = 0; offset < MAX_OFFSET; ++offset)
+            {
+                synth_osc e = osc;
+                synth_osc a = osc;
+                memset(expected, 0, sizeof(expected));
+                memset(actual, 0, sizeof(actual));
+                scalar->sine_stereo(&expected[offset], n, &e);
+                kernels->sine_stereo(&actual[offset], n, &a);
+                if (memcmp(expected, actual, sizeof(expected)) != 0 || e.phase != a.phase
+                    || a.phase != osc.phase + ((uint32_t)n * osc.increment))
+                {
+                    (void)fprintf(stderr, "sine_stereo: isa %d differs from scalar (n = %zu, offset = %zu)\n", isa, n, offset);
+                    return -1;
+                }
+                for (size_t i = 0; i < n; ++i)
+                {
+                    float const y = synth_sine(osc.phase + ((uint32_t)i * osc.increment)) * osc.gain;
+                    if (actual[offset + (2 * i)] != y || actual[offset + (2 * i) + 1] != y)
+                    {
+                        (void)fprintf(stderr, "sine_stereo: isa %d sample %zu is wrong (n = %zu)\n", isa, i, n);
+                        return -1;
+                    }
+                }
+
+                // The same frames in two calls
+                size_t const split = n / 3;
+                a = osc;
+                memset(actual, 0, sizeof(actual));
+                kernels->sine_stereo(&actual[offset], split, &a);
+                kernels->sine_stereo(&actual[offset + (2 * split)], n - split, &a);
+                if (memcmp(expected, actual, sizeof(expected)) != 0 || e.phase != a.phase)
+                {
+                    (void)fprintf(stderr, "sine_stereo: isa %d differs when split (n = %zu, split = %zu)\n", isa, n, split);
+                    return -1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    if (check_accuracy() != 0 || check_frequency() != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    synth_kernels const *scalar = synth_get_kernels(CPU_ISA_SCALAR);
+    if (scalar == NULL || synth_best_kernels() == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+    for (int isa = CPU_ISA_SCALAR; isa < CPU_ISA_MAX; ++isa)
+    {
+        synth_kernels const *kernels = synth_get_kernels((cpu_isa)isa);
+        if (kernels != NULL && check((cpu_isa)isa, scalar, kernels) != 0)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
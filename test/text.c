@@ -0,0 +1,189 @@
+/// Test for the text_layout_init() function.
+///
+/// This test lays out strings against a metrics table of fixed-width glyph
+/// cells and checks quad positions, texture coordinates, line breaks, the
+/// extent of the layout, and the fallback for missing codepoints and invalid
+/// UTF-8.
+///
+/// @see text_layout_init()
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atlas.h"
+#include "text.h"
+
+enum
+{
+    GLYPH_COUNT = 95, // Space and printable ASCII
+    CELL_WIDTH = 10,
+    CELL_HEIGHT = 20,
+    ASCENT = 16,
+    ATLAS_WIDTH = 1024,
+    ATLAS_HEIGHT = 32,
+};
+
+static atlas_glyph glyphs[GLYPH_COUNT];
+
+static atlas_metrics const metrics = {
+    .width = ATLAS_WIDTH,
+    .height = ATLAS_HEIGHT,
+    .line_height = CELL_HEIGHT,
+    .ascent = ASCENT,
+    .count = GLYPH_COUNT,
+    .glyphs = glyphs,
+};
+
+static void init_glyphs(void)
+{
+    // Space is empty, every other glyph fills its cell and hangs 4 pixels below the baseline.
+    glyphs[0] = (atlas_glyph){ .code = ' ', .advance = CELL_WIDTH };
+    for (size_t i = 1; i < GLYPH_COUNT; ++i)
+    {
+        glyphs[i] = (atlas_glyph){
+            .code = (uint32_t)(' ' + i),
+            .x = (uint16_t)(i * CELL_WIDTH),
+            .width = CELL_WIDTH,
+            .height = CELL_HEIGHT,
+            .bearing_y = ASCENT,
+            .advance = CELL_WIDTH,
+        };
+    }
+}
+
+/// Checks that quad q of a layout is the glyph for code with its top-left corner at x, y.
+static int check_quad(struct text_layout const *layout, size_t q, uint32_t code, float x, float y)
+{
+    if (q >= layout->count)
+    {
+        return -1;
+    }
+
+    SDL_Vertex const *v = &layout->vertices[q * 4];
+    float const u = (float)((code - ' ') * CELL_WIDTH) / ATLAS_WIDTH;
+    float const du = (float)CELL_WIDTH / ATLAS_WIDTH;
+    float const dv = (float)CELL_HEIGHT / ATLAS_HEIGHT;
+    if (v[0].position.x != x || v[0].position.y != y || v[3].position.x != x + CELL_WIDTH
+        || v[3].position.y != y + CELL_HEIGHT || v[1].position.x != x + CELL_WIDTH || v[2].position.y != y + CELL_HEIGHT)
+    {
+        return -1;
+    }
+
+    if (v[0].tex_coord.x != u || v[0].tex_coord.y != 0.0f || v[3].tex_coord.x != u + du || v[3].tex_coord.y != dv)
+    {
+        return -1;
+    }
+
+    for (size_t i = 0; i < 4; ++i)
+    {
+        if (v[i].color.r != 0xFF || v[i].color.g != 0xFF || v[i].color.b != 0xFF || v[i].color.a != 0xFF)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int layout(struct text_layout *out, char const *str)
+{
+    return text_layout_init(out, &metrics, str, strlen(str));
+}
+
+static int check_line(void)
+{
+    struct text_layout l;
+    if (layout(&l, "Hi there") != 0)
+    {
+        return -1;
+    }
+
+    int ret = 0;
+    if (l.count != 7 || l.width != 8 * CELL_WIDTH || l.height != CELL_HEIGHT || check_quad(&l, 0, 'H', 0, 0) != 0
+        || check_quad(&l, 1, 'i', CELL_WIDTH, 0) != 0 || check_quad(&l, 2, 't', 3 * CELL_WIDTH, 0) != 0
+        || check_quad(&l, 6, 'e', 7 * CELL_WIDTH, 0) != 0)
+    {
+        ret = -1;
+    }
+
+    text_layout_free(&l);
+    return ret;
+}
+
+static int check_lines(void)
+{
+    struct text_layout l;
+    if (layout(&l, "abc\nd\n\nef") != 0)
+    {
+        return -1;
+    }
+
+    int ret = 0;
+    if (l.count != 6 || l.width != 3 * CELL_WIDTH || l.height != 4 * CELL_HEIGHT || check_quad(&l, 3, 'd', 0, CELL_HEIGHT) != 0
+        || check_quad(&l, 4, 'e', 0, 3 * CELL_HEIGHT) != 0 || check_quad(&l, 5, 'f', CELL_WIDTH, 3 * CELL_HEIGHT) != 0)
+    {
+        ret = -1;
+    }
+
+    text_layout_free(&l);
+    return ret;
+}
+
+static int check_fallback(void)
+{
+    struct text_layout l;
+    // A missing codepoint, a stray continuation byte, a truncated sequence and an overlong encoding
+    if (layout(&l, "a\xC3\xA9" "b\x80" "c\xE2\x82" "d\xC0\xAF") != 0)
+    {
+        return -1;
+    }
+
+    int ret = 0;
+    if (l.count != 10 || check_quad(&l, 0, 'a', 0, 0) != 0 || check_quad(&l, 1, '?', CELL_WIDTH, 0) != 0
+        || check_quad(&l, 2, 'b', 2 * CELL_WIDTH, 0) != 0 || check_quad(&l, 3, '?', 3 * CELL_WIDTH, 0) != 0
+        || check_quad(&l, 4, 'c', 4 * CELL_WIDTH, 0) != 0 || check_quad(&l, 5, '?', 5 * CELL_WIDTH, 0) != 0
+        || check_quad(&l, 6, '?', 6 * CELL_WIDTH, 0) != 0 || check_quad(&l, 7, 'd', 7 * CELL_WIDTH, 0) != 0
+        || check_quad(&l, 9, '?', 9 * CELL_WIDTH, 0) != 0)
+    {
+        ret = -1;
+    }
+
+    text_layout_free(&l);
+    return ret;
+}
+
+static int check_empty(void)
+{
+    struct text_layout l;
+    if (layout(&l, "") != 0)
+    {
+        return -1;
+    }
+
+    int ret = 0;
+    if (l.count != 0 || l.width != 0.0f || l.height != CELL_HEIGHT)
+    {
+        ret = -1;
+    }
+
+    text_layout_free(&l);
+
+    atlas_metrics const empty = { 0 };
+    if (text_layout_init(&l, &empty, "a", 1) == 0)
+    {
+        ret = -1;
+    }
+
+    return ret;
+}
+
+int main(void)
+{
+    init_glyphs();
+    if (check_line() != 0 || check_lines() != 0 || check_fallback() != 0 || check_empty() != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
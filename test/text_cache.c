@@ -0,0 +1,250 @@
+/// Test for the text_cache functions.
+///
+/// This test looks strings up in layout caches and checks that repeated
+/// strings are hits, that strings differing in digits patch the cached layout
+/// into the same quads a fresh layout has, that a layout drawn in the current
+/// frame is left alone, and that the least recently used layouts are evicted
+/// to stay within the budget.
+///
+/// @see text_cache_get()
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atlas.h"
+#include "text.h"
+#include "text_cache.h"
+
+enum
+{
+    GLYPH_COUNT = 95, // Space and printable ASCII
+    CELL_WIDTH = 10,
+    CELL_HEIGHT = 20,
+    ASCENT = 16,
+    ATLAS_WIDTH = 1024,
+    ATLAS_HEIGHT = 32,
+    BUDGET = 64 * 1024,
+};
+
+static atlas_glyph glyphs[GLYPH_COUNT];
+static atlas_glyph proportional_glyphs[GLYPH_COUNT];
+
+static atlas_metrics const font = {
+    .width = ATLAS_WIDTH,
+    .height = ATLAS_HEIGHT,
+    .line_height = CELL_HEIGHT,
+    .ascent = ASCENT,
+    .count = GLYPH_COUNT,
+    .glyphs = glyphs,
+};
+
+/// The same glyphs as font, except that '1' is narrower.
+static atlas_metrics const proportional_font = {
+    .width = ATLAS_WIDTH,
+    .height = ATLAS_HEIGHT,
+    .line_height = CELL_HEIGHT,
+    .ascent = ASCENT,
+    .count = GLYPH_COUNT,
+    .glyphs = proportional_glyphs,
+};
+
+static void init_glyphs(void)
+{
+    glyphs[0] = (atlas_glyph){ .code = ' ', .advance = CELL_WIDTH };
+    for (size_t i = 1; i < GLYPH_COUNT; ++i)
+    {
+        // Digits differ in size and bearings, but not in advance.
+        uint32_t const code = (uint32_t)(' ' + i);
+        int const digit = (code >= '0' && code <= '9') ? (int)(code - '0') : 0;
+        glyphs[i] = (atlas_glyph){
+            .code = code,
+            .x = (uint16_t)(i * CELL_WIDTH),
+            .width = (uint16_t)(CELL_WIDTH - (digit % 3)),
+            .height = (uint16_t)(CELL_HEIGHT - (digit % 4)),
+            .bearing_x = (int16_t)(digit % 3),
+            .bearing_y = (int16_t)(ASCENT - (digit % 2)),
+            .advance = CELL_WIDTH,
+        };
+    }
+    memcpy(proportional_glyphs, glyphs, sizeof(glyphs));
+    proportional_glyphs['1' - ' '].advance = CELL_WIDTH / 2;
+}
+
+/// Checks that a layout has the same quads as a fresh layout of str.
+static int check_same(struct text_layout const *layout, atlas_metrics const *metrics, char const *str)
+{
+    struct text_layout fresh;
+    if (text_layout_init(&fresh, metrics, str, strlen(str)) != 0)
+    {
+        return -1;
+    }
+    int ret = 0;
+    if (layout->count != fresh.count || layout->width != fresh.width || layout->height != fresh.height
+        || memcmp(layout->vertices, fresh.vertices, fresh.count * 4 * sizeof(*fresh.vertices)) != 0
+        || memcmp(layout->offsets, fresh.offsets, fresh.count * sizeof(*fresh.offsets)) != 0)
+    {
+        ret = -1;
+    }
+    text_layout_free(&fresh);
+    return ret;
+}
+
+static struct text_layout const *get(struct text_cache *cache, atlas_metrics const *metrics, char const *str)
+{
+    return text_cache_get(cache, metrics, str, strlen(str));
+}
+
+static int check_stats(struct text_cache const *cache, uint64_t hits, uint64_t patches, uint64_t misses)
+{
+    struct text_cache_stats stats;
+    text_cache_get_stats(cache, &stats);
+    return (stats.hits == hits && stats.patches == patches && stats.misses == misses) ? 0 : -1;
+}
+
+static int check_patch(void)
+{
+    struct text_cache *cache = text_cache_create(BUDGET);
+    if (cache == NULL)
+    {
+        return -1;
+    }
+
+    int ret = -1;
+    struct text_layout const *a = get(cache, &font, "fps 60.0");
+    struct text_layout const *b = get(cache, &font, "fps 60.0");
+    if (a == NULL || b != a || check_same(a, &font, "fps 60.0") != 0 || check_stats(cache, 1, 0, 1) != 0)
+    {
+        goto out_destroy_cache;
+    }
+
+    // The layout was drawn this frame, so another counter value gets its own layout.
+    uint64_t const version = a->version;
+    struct text_layout const *c = get(cache, &font, "fps 59.5");
+    if (c == NULL || c == a || check_same(c, &font, "fps 59.5") != 0 || check_stats(cache, 1, 0, 2) != 0)
+    {
+        goto out_destroy_cache;
+    }
+
+    text_cache_next_frame(cache);
+    struct text_layout const *d = get(cache, &font, "fps 61.7");
+    if ((d != a && d != c) || d->version == version || check_same(d, &font, "fps 61.7") != 0
+        || check_stats(cache, 1, 1, 2) != 0)
+    {
+        goto out_destroy_cache;
+    }
+
+    // Digits that move the glyphs after them are laid out again.
+    struct text_layout const *e = get(cache, &proportional_font, "fps 60.0");
+    text_cache_next_frame(cache);
+    struct text_layout const *f = get(cache, &proportional_font, "fps 61.0");
+    if (e == NULL || f == NULL || f == e || check_same(f, &proportional_font, "fps 61.0") != 0
+        || check_stats(cache, 1, 1, 4) != 0)
+    {
+        goto out_destroy_cache;
+    }
+
+    // Other characters never match.
+    if (get(cache, &font, "fps 60.0!") == NULL || get(cache, &font, "fpS 60.0") == NULL || check_stats(cache, 1, 1, 6) != 0)
+    {
+        goto out_destroy_cache;
+    }
+    ret = 0;
+out_destroy_cache:
+    text_cache_destroy(cache);
+    return ret;
+}
+
+static int check_eviction(void)
+{
+    // Learn the size of one entry, then fit three of them.
+    struct text_cache_stats stats;
+    struct text_cache *cache = text_cache_create(BUDGET);
+    if (cache == NULL || get(cache, &font, "aaaa") == NULL)
+    {
+        text_cache_destroy(cache);
+        return -1;
+    }
+    text_cache_get_stats(cache, &stats);
+    text_cache_destroy(cache);
+
+    size_t const budget = (stats.size * 3) + (stats.size / 2);
+    cache = text_cache_create(budget);
+    if (cache == NULL)
+    {
+        return -1;
+    }
+
+    int ret = -1;
+    if (get(cache, &font, "aaaa") == NULL || get(cache, &font, "bbbb") == NULL || get(cache, &font, "cccc") == NULL
+        || get(cache, &font, "aaaa") == NULL || get(cache, &font, "dddd") == NULL)
+    {
+        goto out_destroy_cache;
+    }
+    text_cache_get_stats(cache, &stats);
+    if (stats.entries != 3 || stats.evictions != 1 || stats.size > budget || check_stats(cache, 1, 0, 4) != 0)
+    {
+        goto out_destroy_cache;
+    }
+
+    // "bbbb" was the least recently used.
+    if (get(cache, &font, "aaaa") == NULL || get(cache, &font, "cccc") == NULL || check_stats(cache, 3, 0, 4) != 0
+        || get(cache, &font, "bbbb") == NULL || check_stats(cache, 3, 0, 5) != 0)
+    {
+        goto out_destroy_cache;
+    }
+
+    // A string larger than the budget is still laid out.
+    struct text_layout const *big = get(cache, &font, "a string much longer than the budget allows");
+    text_cache_get_stats(cache, &stats);
+    if (big == NULL || check_same(big, &font, "a string much longer than the budget allows") != 0 || stats.size > budget)
+    {
+        goto out_destroy_cache;
+    }
+    ret = 0;
+out_destroy_cache:
+    text_cache_destroy(cache);
+    return ret;
+}
+
+static int check_many(void)
+{
+    // Enough strings to grow the table several times.
+    struct text_cache *cache = text_cache_create(BUDGET);
+    if (cache == NULL)
+    {
+        return -1;
+    }
+    int ret = 0;
+    char str[8];
+    for (int round = 0; ret == 0 && round < 2; ++round)
+    {
+        for (int i = 0; ret == 0 && i < 200; ++i)
+        {
+            str[0] = (char)('A' + (i % 26));
+            str[1] = (char)('a' + (i / 26));
+            str[2] = '\0';
+            struct text_layout const *l = get(cache, &font, str);
+            if (l == NULL || check_same(l, &font, str) != 0)
+            {
+                ret = -1;
+            }
+        }
+    }
+    if (ret == 0 && check_stats(cache, 200, 0, 200) != 0)
+    {
+        ret = -1;
+    }
+    text_cache_destroy(cache);
+    return ret;
+}
+
+int main(void)
+{
+    init_glyphs();
+    if (check_patch() != 0 || check_eviction() != 0 || check_many() != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}